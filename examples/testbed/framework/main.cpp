@@ -282,9 +282,13 @@ static void Interface()
 	ImGui::SliderInt("##Velocity Iterations", &g_settings.velocityIterations, 0, 50);
 	ImGui::Text("Position Iterations");
 	ImGui::SliderInt("#Position Iterations", &g_settings.positionIterations, 0, 50);
+	ImGui::Text("Threads");
+	ImGui::SliderInt("##Threads", &g_settings.threadCount, 1, 8);
 	ImGui::Checkbox("Sleep", &g_settings.sleep);
 	ImGui::Checkbox("Convex Cache", &g_settings.convexCache);
 	ImGui::Checkbox("Warm Start", &g_settings.warmStart);
+	ImGui::Checkbox("Constraint Coloring", &g_settings.constraintColoring);
+	ImGui::Checkbox("Sweep and Prune", &g_settings.sweepAndPrune);
 
 	if (ImGui::Button("Play/Pause", buttonSize))
 	{
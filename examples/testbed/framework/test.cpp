@@ -17,11 +17,12 @@
 */
 
 #include <testbed/tests/test.h>
+#include <bounce/common/thread/atomic.h>
 
-extern u32 b3_allocCalls, b3_maxAllocCalls;
-extern u32 b3_gjkCalls, b3_gjkIters, b3_gjkMaxIters;
+extern b3Counter b3_allocCalls, b3_maxAllocCalls;
+extern b3Counter b3_gjkCalls, b3_gjkIters, b3_gjkMaxIters;
 extern bool b3_convexCache;
-extern u32 b3_convexCalls, b3_convexCacheHits;
+extern b3Counter b3_convexCalls, b3_convexCacheHits;
 extern b3Draw* b3_debugDraw;
 
 extern Settings g_settings;
@@ -181,6 +182,9 @@ void Test::Step()
 
 	m_world.SetSleeping(g_settings.sleep);
 	m_world.SetWarmStart(g_settings.warmStart);
+	m_world.SetConstraintColoring(g_settings.constraintColoring);
+	m_world.SetBroadPhaseType(g_settings.sweepAndPrune ? e_sweepAndPruneBroadPhase : e_dynamicTreeBroadPhase);
+	m_world.SetThreadCount(g_settings.threadCount);
 	m_world.Step(dt, g_settings.velocityIterations, g_settings.positionIterations);
 
 	ProfileEnd();
@@ -240,8 +244,8 @@ void Test::Step()
 			avgGjkIters = float32(b3_gjkIters) / float32(b3_gjkCalls);
 		}
 
-		ImGui::Text("GJK Calls %d", b3_gjkCalls);
-		ImGui::Text("GJK Iterations %d (%d) (%f)", b3_gjkIters, b3_gjkMaxIters, avgGjkIters);
+		ImGui::Text("GJK Calls %d", u32(b3_gjkCalls));
+		ImGui::Text("GJK Iterations %d (%d) (%f)", u32(b3_gjkIters), u32(b3_gjkMaxIters), avgGjkIters);
 
 		float32 convexCacheHitRatio = 0.0f;
 		if (b3_convexCalls > 0)
@@ -249,9 +253,9 @@ void Test::Step()
 			convexCacheHitRatio = float32(b3_convexCacheHits) / float32(b3_convexCalls);
 		}
 
-		ImGui::Text("Convex Calls %d", b3_convexCalls);
-		ImGui::Text("Convex Cache Hits %d (%f)", b3_convexCacheHits, convexCacheHitRatio);
-		ImGui::Text("Frame Allocations %d (%d)", b3_allocCalls, b3_maxAllocCalls);
+		ImGui::Text("Convex Calls %d", u32(b3_convexCalls));
+		ImGui::Text("Convex Cache Hits %d (%f)", u32(b3_convexCacheHits), convexCacheHitRatio);
+		ImGui::Text("Frame Allocations %d (%d)", u32(b3_allocCalls), u32(b3_maxAllocCalls));
 	}
 
 	if (g_settings.drawProfile)
@@ -56,9 +56,12 @@
 #include <testbed/tests/varying_friction.h>
 #include <testbed/tests/varying_restitution.h>
 #include <testbed/tests/tumbler.h>
+#include <testbed/tests/bullet_pile.h>
 #include <testbed/tests/single_pendulum.h>
 #include <testbed/tests/multiple_pendulum.h>
 #include <testbed/tests/cloth_test.h>
+#include <testbed/tests/cloth_collision.h>
+#include <testbed/tests/cloth_system_test.h>
 #include <testbed/tests/rope_test.h>
 //#include <testbed/tests/tree_test.h>
 
@@ -101,10 +104,13 @@ TestEntry g_tests[] =
 	{ "Varying Friction", &VaryingFriction::Create },
 	{ "Varying Restitution", &VaryingRestitution::Create },
 	{ "Tumbler", &Tumbler::Create },
+	{ "Bullet Pile", &BulletPile::Create },
 	{ "Initial Overlap", &InitialOverlap::Create },
 	{ "Single Pendulum", &SinglePendulum::Create },
 	{ "Multiple Pendulum", &MultiplePendulum::Create },
 	{ "Cloth", &Cloth::Create },
+	{ "Cloth Collision", &ClothCollision::Create },
+	{ "Cloth System", &ClothSystemTest::Create },
 	{ "Rope", &Rope::Create },
 	//{ "Tree", &Tree::Create },
 	{ NULL, NULL }
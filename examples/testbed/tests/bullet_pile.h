@@ -0,0 +1,93 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BULLET_PILE_H
+#define BULLET_PILE_H
+
+// Bullets dropped into a pile.
+// The bullets come to rest on top of each other and the ground.
+class BulletPile : public Test
+{
+public:
+	BulletPile()
+	{
+		{
+			b3BodyDef bd;
+			b3Body* ground = m_world.CreateBody(bd);
+
+			b3HullShape hs;
+			hs.m_hull = &m_groundHull;
+
+			b3ShapeDef sd;
+			sd.shape = &hs;
+			sd.friction = 0.5f;
+
+			ground->CreateShape(sd);
+		}
+
+		u32 count = 0;
+		for (u32 i = 0; i < 4; ++i)
+		{
+			for (u32 j = 0; j < 4; ++j)
+			{
+				for (u32 k = 0; k < 4; ++k)
+				{
+					b3BodyDef bd;
+					bd.type = e_dynamicBody;
+					bd.bullet = true;
+					bd.position.x = 2.2f * float32(j) - 3.3f + 0.3f * float32((i + k) % 2);
+					bd.position.y = 3.0f + 3.0f * float32(i);
+					bd.position.z = 2.2f * float32(k) - 3.3f + 0.3f * float32((i + j) % 2);
+					bd.linearVelocity.Set(0.0f, -10.0f, 0.0f);
+
+					b3Body* body = m_world.CreateBody(bd);
+
+					b3SphereShape ss;
+					ss.m_center.SetZero();
+					ss.m_radius = 1.0f;
+
+					b3HullShape hs;
+					hs.m_hull = &m_boxHull;
+
+					b3ShapeDef sd;
+					sd.density = 1.0f;
+					sd.friction = 0.5f;
+					if (count % 2 == 0)
+					{
+						sd.shape = &ss;
+					}
+					else
+					{
+						sd.shape = &hs;
+					}
+
+					body->CreateShape(sd);
+
+					++count;
+				}
+			}
+		}
+	}
+
+	static Test* Create()
+	{
+		return new BulletPile();
+	}
+};
+
+#endif
\ No newline at end of file
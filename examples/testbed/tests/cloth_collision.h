@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CLOTH_COLLISION_H
+#define CLOTH_COLLISION_H
+
+extern DebugDraw* g_debugDraw;
+extern Camera g_camera;
+extern Settings g_settings;
+
+class ClothCollision : public Test
+{
+public:
+	ClothCollision()
+	{
+		g_camera.m_zoom = 25.0f;
+
+		{
+			b3BodyDef bd;
+			bd.type = e_staticBody;
+			bd.position.Set(0.0f, -6.0f, 0.0f);
+			b3Body* ground = m_world.CreateBody(bd);
+
+			b3MeshShape ms;
+			ms.m_mesh = m_meshes + e_gridMesh;
+
+			b3ShapeDef sd;
+			sd.shape = &ms;
+			sd.friction = 0.5f;
+
+			ground->CreateShape(sd);
+		}
+
+		{
+			b3BodyDef bd;
+			bd.type = e_staticBody;
+			bd.position.Set(0.0f, -3.0f, 0.0f);
+			b3Body* body = m_world.CreateBody(bd);
+
+			b3SphereShape ss;
+			ss.m_center.SetZero();
+			ss.m_radius = 2.0f;
+
+			b3ShapeDef sd;
+			sd.shape = &ss;
+			sd.friction = 0.5f;
+
+			body->CreateShape(sd);
+		}
+
+		b3ClothDef def;
+		def.mesh = m_meshes + e_clothMesh;
+		def.density = 0.2f;
+		def.gravity.Set(0.0f, -10.0f, 0.0f);
+		def.k1 = 0.9f;
+		def.k2 = 0.1f;
+		def.kd = 0.1f;
+		def.r = 0.05f;
+		def.world = &m_world;
+		def.selfCollision = true;
+
+		m_cloth.Initialize(def);
+	}
+
+	void Step()
+	{
+		Test::Step();
+
+		float32 dt = g_settings.hertz > 0.0f ? 1.0f / g_settings.hertz : 0.0f;
+
+		if (g_settings.pause)
+		{
+			dt = 0.0f;
+		}
+
+		m_cloth.Step(dt, g_settings.positionIterations);
+		m_cloth.Draw(g_debugDraw);
+	}
+
+	static Test* Create()
+	{
+		return new ClothCollision();
+	}
+
+	b3Cloth m_cloth;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CLOTH_SYSTEM_TEST_H
+#define CLOTH_SYSTEM_TEST_H
+
+extern DebugDraw* g_debugDraw;
+extern Camera g_camera;
+extern Settings g_settings;
+
+class ClothSystemTest : public Test
+{
+public:
+	enum
+	{
+		e_rowCount = 5,
+		e_columnCount = 5,
+		e_flagCount = e_rowCount * e_columnCount
+	};
+
+	ClothSystemTest()
+	{
+		g_camera.m_zoom = 80.0f;
+
+		m_system.SetSleeping(true);
+
+		const b3Mesh* source = m_meshes + e_clothMesh;
+
+		for (u32 i = 0; i < e_rowCount; ++i)
+		{
+			for (u32 j = 0; j < e_columnCount; ++j)
+			{
+				b3Vec3 offset;
+				offset.x = 12.0f * (float32(i) - 0.5f * float32(e_rowCount - 1));
+				offset.y = 0.0f;
+				offset.z = 12.0f * (float32(j) - 0.5f * float32(e_columnCount - 1));
+
+				// Each flag has its own copy of the cloth mesh.
+				b3Mesh* mesh = m_flagMeshes + i * e_columnCount + j;
+				mesh->vertexCount = source->vertexCount;
+				mesh->vertices = (b3Vec3*)b3Alloc(mesh->vertexCount * sizeof(b3Vec3));
+				for (u32 k = 0; k < mesh->vertexCount; ++k)
+				{
+					mesh->vertices[k] = source->vertices[k] + offset;
+				}
+				mesh->triangleCount = source->triangleCount;
+				mesh->triangles = source->triangles;
+
+				b3ClothDef def;
+				def.mesh = mesh;
+				def.density = 0.2f;
+				def.gravity.Set(0.0f, -10.0f, 0.0f);
+				def.k1 = 0.9f;
+				def.k2 = 0.1f;
+				def.kd = 1.0f;
+
+				b3Cloth* cloth = m_system.CreateCloth(def);
+
+				// Pin the flag to its pole.
+				const b3Vec3* ps = cloth->GetPositions();
+				for (u32 k = 0; k < cloth->GetVertexCount(); ++k)
+				{
+					if (ps[k].x <= offset.x - 4.5f)
+					{
+						cloth->SetInverseMass(k, 0.0f);
+					}
+				}
+			}
+		}
+	}
+
+	~ClothSystemTest()
+	{
+		for (u32 i = 0; i < e_flagCount; ++i)
+		{
+			b3Free(m_flagMeshes[i].vertices);
+		}
+	}
+
+	void Step()
+	{
+		float32 dt = g_settings.hertz > 0.0f ? 1.0f / g_settings.hertz : 0.0f;
+
+		if (g_settings.pause)
+		{
+			if (g_settings.singleStep)
+			{
+				g_settings.singleStep = false;
+			}
+			else
+			{
+				dt = 0.0f;
+			}
+		}
+
+		m_system.SetThreadCount(g_settings.threadCount);
+		m_system.Step(dt, g_settings.positionIterations);
+		m_system.Draw(g_debugDraw);
+
+		u32 awakeCount = 0;
+		for (b3Cloth* c = m_system.GetClothList().m_head; c; c = c->GetNext())
+		{
+			if (c->IsAwake())
+			{
+				++awakeCount;
+			}
+		}
+
+		b3Color color(1.0f, 1.0f, 1.0f);
+		g_debugDraw->DrawString("Awake flags = %d/%d", color, awakeCount, e_flagCount);
+	}
+
+	static Test* Create()
+	{
+		return new ClothSystemTest();
+	}
+
+	b3Mesh m_flagMeshes[e_flagCount];
+	b3ClothSystem m_system;
+};
+
+#endif
\ No newline at end of file
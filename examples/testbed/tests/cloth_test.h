@@ -44,12 +44,12 @@ public:
 		m_aabb.m_lower.Set(-5.0f, -1.0f, -6.0f);
 		m_aabb.m_upper.Set(5.0f, 1.0f, -4.0f);
 
-		b3Particle* vs = m_cloth.GetVertices();
+		const b3Vec3* ps = m_cloth.GetPositions();
 		for (u32 i = 0; i < m_cloth.GetVertexCount(); ++i)
 		{
-			if (m_aabb.Contains(vs[i].p))
+			if (m_aabb.Contains(ps[i]))
 			{
-				vs[i].im = 0.0f;
+				m_cloth.SetInverseMass(i, 0.0f);
 			}
 		}
 	}
@@ -92,7 +92,7 @@ inline b3Vec3 ComputeCentroid(const b3Hull& h)
 struct Pair
 {
 	void* key;
-	u8 value;
+	u16 value;
 };
 
 struct Map
@@ -118,13 +118,11 @@ struct Map
 	b3StackArray<Pair, 256> m_pairs;
 };
 
-#define NULL_FEATURE 0xFF
-
 inline b3Hull ConvertHull(const qhHull& hull)
 {
-	u8 V = 0;
-	u8 E = 0;
-	u8 F = 0;
+	u32 V = 0;
+	u32 E = 0;
+	u32 F = 0;
 
 	qhFace* face = hull.m_faceList.head;
 	while (face)
@@ -141,11 +139,11 @@ inline b3Hull ConvertHull(const qhHull& hull)
 		face = face->next;
 	}
 
-	u8 vertexCount = 0;
+	u32 vertexCount = 0;
 	b3Vec3* vertices = (b3Vec3*)b3Alloc(V * sizeof(b3Vec3));
-	u8 edgeCount = 0;
+	u32 edgeCount = 0;
 	b3HalfEdge* edges = (b3HalfEdge*)b3Alloc(E * sizeof(b3HalfEdge));
-	u8 faceCount = 0;
+	u32 faceCount = 0;
 	b3Face* faces = (b3Face*)b3Alloc(F * sizeof(b3Face));
 	b3Plane* planes = (b3Plane*)b3Alloc(F * sizeof(b3Plane));
 
@@ -156,14 +154,14 @@ inline b3Hull ConvertHull(const qhHull& hull)
 	while (face)
 	{
 		B3_ASSERT(faceCount < F);
-		u8 iface = faceCount;
+		u16 iface = u16(faceCount);
 		b3Face* f = faces + faceCount;
 		b3Plane* plane = planes + faceCount;
 		++faceCount;
 
 		*plane = face->plane;
 
-		b3StackArray<u8, 32> faceEdges;
+		b3StackArray<u16, 32> faceEdges;
 
 		qhHalfEdge* edge = face->edge;
 		do
@@ -176,7 +174,7 @@ inline b3Hull ConvertHull(const qhHull& hull)
 			Pair* mv1 = vertexMap.Find(v1);
 			Pair* mv2 = vertexMap.Find(v2);
 
-			u8 iv1;
+			u16 iv1;
 			if (mv1)
 			{
 				iv1 = mv1->value;
@@ -184,13 +182,13 @@ inline b3Hull ConvertHull(const qhHull& hull)
 			else
 			{
 				B3_ASSERT(vertexCount < V);
-				iv1 = vertexCount;
+				iv1 = u16(vertexCount);
 				vertices[iv1] = v1->position;
 				vertexMap.Add({ v1, iv1 });
 				++vertexCount;
 			}
 
-			u8 iv2;
+			u16 iv2;
 			if (mv2)
 			{
 				iv2 = mv2->value;
@@ -198,7 +196,7 @@ inline b3Hull ConvertHull(const qhHull& hull)
 			else
 			{
 				B3_ASSERT(vertexCount < V);
-				iv2 = vertexCount;
+				iv2 = u16(vertexCount);
 				vertices[iv2] = v2->position;
 				vertexMap.Add({ v2, iv2 });
 				++vertexCount;
@@ -206,21 +204,21 @@ inline b3Hull ConvertHull(const qhHull& hull)
 
 			if (mte)
 			{
-				u8 ie2 = mte->value;
+				u16 ie2 = mte->value;
 				b3HalfEdge* e2 = edges + ie2;
-				B3_ASSERT(e2->face == NULL_FEATURE);
+				B3_ASSERT(e2->face == B3_NULL_HULL_FEATURE);
 				e2->face = iface;
 				faceEdges.PushBack(ie2);
 			}
 			else
 			{
 				B3_ASSERT(edgeCount < E);
-				u8 ie1 = edgeCount;
+				u16 ie1 = u16(edgeCount);
 				b3HalfEdge* e1 = edges + edgeCount;
 				++edgeCount;
 
 				B3_ASSERT(edgeCount < E);
-				u8 ie2 = edgeCount;
+				u16 ie2 = u16(edgeCount);
 				b3HalfEdge* e2 = edges + edgeCount;
 				++edgeCount;
 
@@ -228,7 +226,7 @@ inline b3Hull ConvertHull(const qhHull& hull)
 				e1->origin = iv1;
 				e1->twin = ie2;
 
-				e2->face = NULL_FEATURE;
+				e2->face = B3_NULL_HULL_FEATURE;
 				e2->origin = iv2;
 				e2->twin = ie1;
 
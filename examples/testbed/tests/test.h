@@ -42,8 +42,11 @@ struct Settings
 		hertz = 60.0f;
 		velocityIterations = 8;
 		positionIterations = 2;
+		threadCount = 1;
 		sleep = false;
 		warmStart = true;
+		constraintColoring = false;
+		sweepAndPrune = false;
 		convexCache = true;
 		drawCenterOfMasses = false;
 		drawVerticesEdges = true;
@@ -71,8 +74,11 @@ struct Settings
 	float32 hertz;
 	int velocityIterations;
 	int positionIterations;
+	int threadCount;
 	bool sleep;
 	bool warmStart;
+	bool constraintColoring;
+	bool sweepAndPrune;
 	bool convexCache;
 	
 	bool drawCenterOfMasses;
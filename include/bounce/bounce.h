@@ -23,6 +23,7 @@
 
 #include <bounce/common/settings.h>
 #include <bounce/common/time.h>
+#include <bounce/common/memory/mapped_file.h>
 #include <bounce/common/draw.h>
 
 #include <bounce/common/math/math.h>
@@ -56,6 +57,7 @@
 
 #include <bounce/dynamics/rope/rope.h>
 #include <bounce/dynamics/cloth/cloth.h>
+#include <bounce/dynamics/cloth/cloth_system.h>
 #include <bounce/dynamics/body.h>
 
 //#include <bounce/dynamics/tree/joints/tree_weld_joint.h>
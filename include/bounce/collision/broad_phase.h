@@ -20,7 +20,8 @@
 #define B3_BROAD_PHASE_H
 
 #include <bounce/collision/trees/dynamic_tree.h>
-#include <algorithm>
+#include <bounce/collision/sweep_and_prune.h>
+#include <bounce/common/thread/thread_pool.h>
 
 // A pair of broad-phase proxies.
 struct b3Pair
@@ -29,6 +30,26 @@ struct b3Pair
 	i32 proxy2;
 };
 
+// A buffer of overlapping pairs.
+struct b3PairBuffer
+{
+	b3Pair* pairs;
+	u32 count;
+	u32 capacity;
+};
+
+// The broad-phase algorithms.
+enum b3BroadPhaseType
+{
+	// A dynamic AABB tree. 
+	// This is a good default for scenes with large static geometry.
+	e_dynamicTreeBroadPhase,
+
+	// A SIMD sort and sweep along the x axis. 
+	// This is often faster for many similarly sized moving proxies.
+	e_sweepAndPruneBroadPhase
+};
+
 // The broad-phase interface. 
 // It is used to perform ray casts, volume queries, and overlapping queries 
 // against AABBs.
@@ -38,6 +59,13 @@ public:
 	b3BroadPhase();
 	~b3BroadPhase();
 
+	// Set the broad-phase algorithm.
+	// The broad-phase must not contain proxies.
+	void SetType(b3BroadPhaseType type);
+
+	// Get the broad-phase algorithm.
+	b3BroadPhaseType GetType() const;
+
 	// Create a proxy and return a index to it.
 	i32 CreateProxy(const b3AABB3& aabb, void* userData);
 	
@@ -73,124 +101,136 @@ public:
 
 	// Notify the client callback the AABB pairs that are overlapping.
 	// The client must store the notified pairs.
+	// The moved proxies are queried on the thread pool if one is given.
+	// The pairs are reported in the same order for any number of threads.
 	template<class T>
-	void FindNewPairs(T* callback);
+	void FindNewPairs(T* callback, b3ThreadPool* threadPool = NULL);
+
+	// Rebuild the dynamic tree with the surface area heuristic.
+	// This restores the query performance after many proxy updates.
+	// This does nothing if the broad-phase isn't a dynamic tree.
+	void Rebuild();
+
+	// Get the dynamic tree.
+	const b3DynamicTree& GetTree() const;
 
 	// Draw the proxy AABBs.
 	void Draw(b3Draw* draw) const;
 private :
-	friend class b3DynamicTree;
-	
-	// The client callback used to add an overlapping pair
-	// to the overlapping pair buffer.
-	bool Report(i32 proxyId);
+	friend struct b3FindPairsTask;
 	
+	// Query the moved proxies and store the unique overlapping pairs 
+	// sorted by proxy IDs.
+	void FindPairs(b3ThreadPool* threadPool);
+
+	// Remove a proxy from the list of moved proxies.
+	void UnBufferMove(i32 proxyId);
+
+	// The broad-phase algorithm.
+	b3BroadPhaseType m_type;
+
+	// The number of proxies.
+	u32 m_proxyCount;
+
 	// The dynamic tree.
 	b3DynamicTree m_tree;
 
-	// The current proxy being queried for overlap with another proxies. 
-	// It is used to avoid a proxy overlap with itself.
-	i32 m_queryProxyId;
+	// The sort and sweep.
+	b3SweepAndPrune m_sap;
 
 	// The objects that have moved in a step.
 	i32* m_moveBuffer;
 	u32 m_moveBufferCount;
 	u32 m_moveBufferCapacity;
 
+	// The (duplicated) overlapping pairs found by each thread.
+	b3PairBuffer m_threadPairs[b3_maxThreads];
+
 	// The buffer holding the unique overlapping AABB pairs.
 	b3Pair* m_pairs;
 	u32 m_pairCapacity;
 	u32 m_pairCount;
+
+	// Temporary buffer for sorting the pairs.
+	b3Pair* m_sortPairs;
 };
 
-inline const b3AABB3& b3BroadPhase::GetAABB(i32 proxyId) const 
+inline b3BroadPhaseType b3BroadPhase::GetType() const
 {
-	return m_tree.GetAABB(proxyId);
+	return m_type;
 }
 
-inline void* b3BroadPhase::GetUserData(i32 proxyId) const 
+inline void b3BroadPhase::Rebuild()
 {
-	return m_tree.GetUserData(proxyId);
+	if (m_type == e_dynamicTreeBroadPhase)
+	{
+		m_tree.RebuildSAH();
+	}
 }
 
-template<class T>
-inline void b3BroadPhase::QueryAABB(T* callback, const b3AABB3& aabb) const 
+inline const b3DynamicTree& b3BroadPhase::GetTree() const
 {
-	return m_tree.QueryAABB(callback, aabb);
+	return m_tree;
 }
 
-template<class T>
-inline void b3BroadPhase::RayCast(T* callback, const b3RayCastInput& input) const 
+inline const b3AABB3& b3BroadPhase::GetAABB(i32 proxyId) const 
 {
-	return m_tree.RayCast(callback, input);
+	if (m_type == e_sweepAndPruneBroadPhase)
+	{
+		return m_sap.GetAABB(proxyId);
+	}
+	return m_tree.GetAABB(proxyId);
 }
 
-inline bool operator<(const b3Pair& pair1, const b3Pair& pair2) 
+inline void* b3BroadPhase::GetUserData(i32 proxyId) const 
 {
-	if (pair1.proxy1 < pair2.proxy1) 
+	if (m_type == e_sweepAndPruneBroadPhase)
 	{
-		return true;
+		return m_sap.GetUserData(proxyId);
 	}
+	return m_tree.GetUserData(proxyId);
+}
 
-	if (pair1.proxy1 == pair2.proxy1) 
+template<class T>
+inline void b3BroadPhase::QueryAABB(T* callback, const b3AABB3& aabb) const 
+{
+	if (m_type == e_sweepAndPruneBroadPhase)
 	{
-		return pair1.proxy2 < pair2.proxy2;
+		return m_sap.QueryAABB(callback, aabb);
 	}
-
-	return false;
+	return m_tree.QueryAABB(callback, aabb);
 }
 
 template<class T>
-inline void b3BroadPhase::FindNewPairs(T* callback) 
+inline void b3BroadPhase::RayCast(T* callback, const b3RayCastInput& input) const 
 {
-	// Reset the overlapping pairs buffer count for the current step.
-	m_pairCount = 0;
-
-	// Notifying this class with QueryCallback(), gets the (duplicated) overlapping pair buffer.
-	for (u32 i = 0; i < m_moveBufferCount; ++i) 
+	if (m_type == e_sweepAndPruneBroadPhase)
 	{
-		// Keep the current queried proxy ID to avoid self overlapping.
-		m_queryProxyId = m_moveBuffer[i];
-		if (m_queryProxyId == NULL_NODE) 
-		{
-			continue;
-		}
-
-		const b3AABB3& aabb = m_tree.GetAABB(m_queryProxyId);
-		m_tree.QueryAABB(this, aabb);
+		return m_sap.RayCast(callback, input);
 	}
+	return m_tree.RayCast(callback, input);
+}
 
-	// Reset the move buffer for the next step.
-	m_moveBufferCount = 0;
-
-	// Sort the (duplicated) overlapping pair buffer to prune duplicated pairs.
-	std::sort(m_pairs, m_pairs + m_pairCount);
+template<class T>
+inline void b3BroadPhase::FindNewPairs(T* callback, b3ThreadPool* threadPool) 
+{
+	FindPairs(threadPool);
 
-	// Skip duplicated overlapping pairs.
-	u32 index = 0;
-	while (index < m_pairCount) 
+	// Report the unique overlapping pairs to the client.
+	for (u32 i = 0; i < m_pairCount; ++i)
 	{
-		const b3Pair* primaryPair = m_pairs + index;
-
-		// Report an unique overlapping pair to the client.
-		callback->AddPair(m_tree.GetUserData(primaryPair->proxy1), m_tree.GetUserData(primaryPair->proxy2));
-
-		// Skip all duplicated pairs until an unique pair is found.
-		++index;
-		while (index < m_pairCount) 
-		{
-			const b3Pair* secondaryPair = m_pairs + index;
-			if (secondaryPair->proxy1 != primaryPair->proxy1 || secondaryPair->proxy2 != primaryPair->proxy2) 
-			{
-				break;
-			}
-			++index;
-		}
+		const b3Pair* pair = m_pairs + i;
+		callback->AddPair(GetUserData(pair->proxy1), GetUserData(pair->proxy2));
 	}
 }
 
 inline void b3BroadPhase::Draw(b3Draw* draw) const
 {
+	if (m_type == e_sweepAndPruneBroadPhase)
+	{
+		m_sap.Draw(draw);
+		return;
+	}
 	m_tree.Draw(draw);
 }
 
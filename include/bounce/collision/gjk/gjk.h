@@ -87,8 +87,8 @@ struct b3SimplexCache
 	float32 metric; // distance or area or volume
 	u32 iterations; // number of GJK iterations
 	u16 count; // number of support vertices
-	u8 index1[4]; // support vertices on proxy 1
-	u8 index2[4]; // support vertices on proxy 2
+	u16 index1[4]; // support vertices on proxy 1
+	u16 index2[4]; // support vertices on proxy 2
 };
 
 // A feature pair contains the vertices of the features associated 
@@ -114,4 +114,52 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 	const b3Transform& xf2, const b3GJKProxy& proxy2,
 	bool applyRadius, b3SimplexCache* cache);
 
-#endif
\ No newline at end of file
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The output of a linear shape cast. 
+// It contains the fraction of the translation where the proxies 
+// start touching, the contact point on proxy 1 and 
+// the surface normal on proxy 1 pointing towards proxy 2.
+struct b3GJKShapeCastOutput
+{
+	float32 t; // fraction of the translation
+	b3Vec3 point; // contact point on proxy 1
+	b3Vec3 normal; // contact normal on proxy 1
+	u32 iterations; // number of advancement iterations
+};
+
+// Find the first time proxy 2 touches proxy 1 when proxy 2 is 
+// translated from its transform by a given translation. 
+// The search stops at the given fraction of the translation.
+// The time is found by conservative advancement with the GJK distance, 
+// so the proxies stop within a small tolerance before touching.
+// If the proxies are overlapping initially then the time is zero and 
+// the normal opposes the translation.
+// Return true if the proxies touch.
+bool b3GJKShapeCast(b3GJKShapeCastOutput* output,
+	const b3Transform& xf1, const b3GJKProxy& proxy1,
+	const b3Transform& xf2, const b3GJKProxy& proxy2, 
+	const b3Vec3& translation2, float32 maxFraction);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The output of a time of impact query.
+struct b3GJKTOIOutput
+{
+	float32 t; // time of impact
+	u32 iterations; // number of advancement iterations
+};
+
+// Find the first time two proxies touch when they move along their sweeps. 
+// The proxy vertices are relative to the sweep frames. 
+// The time is relative to the initial sweep states and the search stops at the given time.
+// The time is found by conservative advancement with the GJK distance. 
+// The proxies stop when they overlap by a few slops so that contact points 
+// can be created at the time of impact.
+// Return true if the proxies touch before the given time. 
+// Return false if they don't or they are overlapping initially.
+bool b3GJKTimeOfImpact(b3GJKTOIOutput* output,
+	const b3Sweep& sweep1, const b3GJKProxy& proxy1,
+	const b3Sweep& sweep2, const b3GJKProxy& proxy2, float32 tMax);
+
+#endif
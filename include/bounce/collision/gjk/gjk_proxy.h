@@ -20,12 +20,13 @@
 #define B3_GJK_PROXY_H
 
 #include <bounce/common/math/vec3.h>
+#include <bounce/collision/shapes/hull.h>
 
 // A GJK proxy encapsulates any convex hull to be used by the GJK.
 class b3GJKProxy
 {
 public:
-	b3GJKProxy() : m_vertices(NULL), m_count(0), m_radius(0.0f) { }
+	b3GJKProxy() : m_vertices(NULL), m_count(0), m_radius(0.0f), m_hull(NULL) { }
 
 	// Get the number of vertices in this proxy.
 	u32 GetVertexCount() const;
@@ -44,6 +45,7 @@ public:
 	u32 m_count; // number of vertices
 	float32 m_radius; // shape radius
 	b3Vec3 m_buffer[3]; // vertices from a child shape
+	const b3Hull* m_hull; // optional hull owning the vertices, used for faster support queries
 };
 
 inline u32 b3GJKProxy::GetVertexCount() const
@@ -59,6 +61,12 @@ inline const b3Vec3& b3GJKProxy::GetVertex(u32 index) const
 
 inline u32 b3GJKProxy::GetSupportIndex(const b3Vec3& d) const
 {
+	if (m_hull)
+	{
+		B3_ASSERT(m_hull->vertices == m_vertices);
+		return m_hull->GetSupportVertex(d);
+	}
+
 	u32 maxIndex = 0;
 	float32 maxProjection = b3Dot(d, m_vertices[maxIndex]);
 	for (u32 i = 1; i < m_count; ++i)
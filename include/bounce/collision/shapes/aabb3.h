@@ -231,6 +231,24 @@ inline b3AABB3 b3Combine(const b3AABB3& a, const b3AABB3& b)
 	return aabb;
 }
 
+// Compute an AABB that encloses a transformed AABB.
+inline b3AABB3 b3TransformAABB(const b3Transform& xf, const b3AABB3& aabb)
+{
+	b3Vec3 c = b3Mul(xf, aabb.Centroid());
+	b3Vec3 h = 0.5f * (aabb.m_upper - aabb.m_lower);
+
+	const b3Mat33& R = xf.rotation;
+	b3Vec3 r;
+	r.x = b3Abs(R.x.x) * h.x + b3Abs(R.y.x) * h.y + b3Abs(R.z.x) * h.z;
+	r.y = b3Abs(R.x.y) * h.x + b3Abs(R.y.y) * h.y + b3Abs(R.z.y) * h.z;
+	r.z = b3Abs(R.x.z) * h.x + b3Abs(R.y.z) * h.y + b3Abs(R.z.z) * h.z;
+
+	b3AABB3 out;
+	out.m_lower = c - r;
+	out.m_upper = c + r;
+	return out;
+}
+
 // Test if two AABBs are overlapping.
 inline bool b3TestOverlap(const b3AABB3& a, const b3AABB3& b) 
 {
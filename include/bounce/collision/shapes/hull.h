@@ -21,17 +21,23 @@
 
 #include <bounce/common/geometry.h>
 
+// The maximum number of vertices, half-edges, or faces in a hull.
+#define B3_MAX_HULL_FEATURES (0xFFFF)
+
+// A null feature index.
+#define B3_NULL_HULL_FEATURE (0xFFFF)
+
 struct b3Face
 {
-	u8 edge;
+	u16 edge;
 };
 
 struct b3HalfEdge
 {
-	u8 origin;
-	u8 twin;
-	u8 face;
-	u8 next;
+	u16 origin;
+	u16 twin;
+	u16 face;
+	u16 next;
 };
 
 struct b3Hull
@@ -50,6 +56,8 @@ struct b3Hull
 	const b3Face* GetFace(u32 index) const;
 	const b3Plane& GetPlane(u32 index) const;
 
+	// Get the support vertex index in a given direction.
+	// Large hulls are searched by hill-climbing over the vertex adjacency.
 	u32 GetSupportVertex(const b3Vec3& direction) const;
 	//u32 GetSupportEdge(const b3Vec3& direction) const;
 	u32 GetSupportFace(const b3Vec3& direction) const;
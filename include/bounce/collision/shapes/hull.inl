@@ -1,10 +1,14 @@
 inline b3HalfEdge b3MakeEdge(u32 origin, u32 twin, u32 face, u32 next)
 {
 	b3HalfEdge edge;
-	edge.origin = u8(origin);
-	edge.twin = u8(twin);
-	edge.face = u8(face);
-	edge.next = u8(next);
+	B3_ASSERT(origin < B3_MAX_HULL_FEATURES);
+	B3_ASSERT(twin < B3_MAX_HULL_FEATURES);
+	B3_ASSERT(face < B3_MAX_HULL_FEATURES);
+	B3_ASSERT(next < B3_MAX_HULL_FEATURES);
+	edge.origin = u16(origin);
+	edge.twin = u16(twin);
+	edge.face = u16(face);
+	edge.next = u16(next);
 	return edge;
 }
 
@@ -28,20 +32,61 @@ inline const b3Plane& b3Hull::GetPlane(u32 index) const
 	return planes[index];
 }
 
+// Hulls with fewer vertices than this are searched linearly.
+const u32 b3_hullClimbingVertexCount = 100;
+
 inline u32 b3Hull::GetSupportVertex(const b3Vec3& direction) const
 {
-	u32 maxIndex = 0;
-	float32 maxProjection = b3Dot(direction, vertices[maxIndex]);
-	for (u32 i = 1; i < vertexCount; ++i)
+	if (vertexCount < b3_hullClimbingVertexCount)
 	{
-		float32 projection = b3Dot(direction, vertices[i]);
-		if (projection > maxProjection)
+		u32 maxIndex = 0;
+		float32 maxProjection = b3Dot(direction, vertices[maxIndex]);
+		for (u32 i = 1; i < vertexCount; ++i)
 		{
-			maxIndex = i;
-			maxProjection = projection;
+			float32 projection = b3Dot(direction, vertices[i]);
+			if (projection > maxProjection)
+			{
+				maxIndex = i;
+				maxProjection = projection;
+			}
 		}
+		return maxIndex;
 	}
-	return maxIndex;
+
+	// Walk to the neighbour with the largest projection until no neighbour improves it.
+	// A vertex of a convex polyhedron that has no better neighbour is a global maximum.
+	// The walk keeps a half-edge leaving the current vertex.
+	u32 edgeIndex = 0;
+	float32 maxProjection = b3Dot(direction, vertices[edges[edgeIndex].origin]);
+	for (;;)
+	{
+		u32 maxEdgeIndex = edgeIndex;
+
+		// Visit the edges leaving the current vertex.
+		const b3HalfEdge* begin = edges + edgeIndex;
+		const b3HalfEdge* edge = begin;
+		do
+		{
+			const b3HalfEdge* twin = edges + edge->twin;
+			
+			float32 projection = b3Dot(direction, vertices[twin->origin]);
+			if (projection > maxProjection)
+			{
+				maxEdgeIndex = edge->twin;
+				maxProjection = projection;
+			}
+
+			edge = edges + twin->next;
+		} while (edge != begin);
+
+		if (maxEdgeIndex == edgeIndex)
+		{
+			break;
+		}
+
+		edgeIndex = maxEdgeIndex;
+	}
+	return edges[edgeIndex].origin;
 }
 
 inline u32 b3Hull::GetSupportFace(const b3Vec3& direction) const
@@ -52,7 +52,26 @@ struct b3Mesh
 
 	b3AABB3 GetTriangleAABB(u32 index) const;
 
-	void BuildTree();
+	// Build the triangle tree. 
+	// The triangle AABBs and the subtrees are computed in parallel if a thread pool is given.
+	// The tree can be collapsed afterwards for faster queries or compressed for 
+	// smaller memory usage.
+	void BuildTree(b3ThreadPool* threadPool = NULL);
+
+	// Get the size in bytes of the binary image of this mesh.
+	u32 GetBlobSize() const;
+
+	// Write the vertices, the triangles and the built tree to a buffer 
+	// of GetBlobSize() bytes aligned to 16 bytes.
+	void WriteBlob(void* blob) const;
+
+	// Use a binary image written by WriteBlob in place. 
+	// The vertices, the triangles and the tree point into the image, so 
+	// no memory is copied and the tree doesn't need to be built. 
+	// A memory mapped file can be used as the image. 
+	// The image must outlive this mesh. 
+	// Return false and keep the mesh unchanged if the image is invalid.
+	bool ReadBlob(const void* blob, u32 size);
 };
 
 inline const b3Vec3& b3Mesh::GetVertex(u32 index) const
@@ -89,15 +108,44 @@ inline b3AABB3 b3Mesh::GetTriangleAABB(u32 index) const
 	return aabb;
 }
 
-inline void b3Mesh::BuildTree()
+// The number of triangle AABBs computed per task.
+const u32 b3_triangleGrainSize = 4096;
+
+// Computes the triangle AABBs on a thread.
+struct b3ComputeTriangleAABBsTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			aabbs[i] = mesh->GetTriangleAABB(i);
+		}
+	}
+
+	const b3Mesh* mesh;
+	b3AABB3* aabbs;
+};
+
+inline void b3Mesh::BuildTree(b3ThreadPool* threadPool)
 {
 	b3AABB3* aabbs = (b3AABB3*)b3Alloc(triangleCount * sizeof(b3AABB3));
-	for (u32 i = 0; i < triangleCount; ++i)
+	
+	b3ComputeTriangleAABBsTask task;
+	task.mesh = this;
+	task.aabbs = aabbs;
+
+	if (threadPool)
+	{
+		threadPool->ParallelFor(&task, triangleCount, b3_triangleGrainSize);
+	}
+	else
 	{
-		aabbs[i] = GetTriangleAABB(i);
+		task.Execute(0, triangleCount, 0);
 	}
 
-	tree.Build(aabbs, triangleCount);
+	tree.Build(aabbs, triangleCount, 4, threadPool);
 
 	b3Free(aabbs);
 }
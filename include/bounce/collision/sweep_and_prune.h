@@ -0,0 +1,356 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SWEEP_AND_PRUNE_H
+#define B3_SWEEP_AND_PRUNE_H
+
+#include <bounce/common/draw.h>
+#include <bounce/common/math/simd.h>
+#include <bounce/collision/shapes/aabb3.h>
+#include <bounce/collision/collision.h>
+
+#ifndef NULL_NODE
+#define NULL_NODE (-1)
+#endif
+
+// Sort and sweep for dynamic AABBs.
+// The proxies are sorted along the x axis and swept in order. 
+// The y and z axes of several proxies are tested at once using SIMD.
+class b3SweepAndPrune
+{
+public:
+	b3SweepAndPrune();
+	~b3SweepAndPrune();
+
+	// Insert a proxy and return its ID.
+	i32 InsertProxy(const b3AABB3& aabb, void* userData);
+
+	// Remove a proxy.
+	void RemoveProxy(i32 proxyId);
+
+	// Update a proxy AABB.
+	void UpdateProxy(i32 proxyId, const b3AABB3& aabb);
+
+	// Get the (fat) AABB of a given proxy.
+	const b3AABB3& GetAABB(i32 proxyId) const;
+
+	// Get the data associated with a given proxy.
+	void* GetUserData(i32 proxyId) const;
+
+	// Check if two proxy AABBs are overlapping.
+	bool TestOverlap(i32 proxy1, i32 proxy2) const;
+
+	// Mark a proxy as moved. 
+	// Only pairs with at least one moved proxy are reported by QueryPairs.
+	void SetMoved(i32 proxyId);
+
+	// Sort the proxies along the x axis.
+	// This must be called after the proxies were updated and before QueryPairs.
+	// The moved flags are captured by the sort and then cleared.
+	void Sort();
+
+	// Get the number of sorted proxies.
+	u32 GetSortedCount() const;
+
+	// Report the client callback the overlapping pairs that start 
+	// on the sorted proxies in the range [begin, end). 
+	// This is thread safe for disjoint ranges.
+	template<class T>
+	void QueryPairs(T* callback, u32 begin, u32 end) const;
+
+	// Keep reporting the client callback the AABBs that are overlapping with
+	// the given AABB. The client callback must return true to continue 
+	// the query or false to stop it.
+	template<class T>
+	void QueryAABB(T* callback, const b3AABB3& aabb) const;
+
+	// Keep reporting the client callback all AABBs that are overlapping with
+	// the given ray. The client callback must return the new intersection fraction.
+	// If the fraction == 0 then the query is cancelled immediately.
+	template<class T>
+	void RayCast(T* callback, const b3RayCastInput& input) const;
+
+	// Draw the proxy AABBs.
+	void Draw(b3Draw* draw) const;
+private:
+	struct b3Proxy
+	{
+		// The fattened AABB.
+		b3AABB3 aabb;
+
+		// The associated user data.
+		void* userData;
+
+		// The next free proxy.
+		i32 next;
+
+		// Is this proxy allocated?
+		bool allocated;
+
+		// Has this proxy moved since the last sort?
+		bool moved;
+	};
+
+	// Link the proxies starting from the given proxy into the free list.
+	void AddToFreeList(i32 proxy);
+
+	// The proxies stored in an array.
+	b3Proxy* m_proxies;
+	i32 m_proxyCount;
+	i32 m_proxyCapacity;
+	i32 m_freeList;
+
+	// Are the sorted arrays synchronized with the proxies?
+	bool m_sorted;
+
+	// The proxy AABBs in sorted order, stored as a structure of arrays. 
+	// Each array is padded with B3_SIMD_WIDTH lanes 
+	// so the last proxies can be loaded at once.
+	float32* m_lowerX;
+	float32* m_upperX;
+	float32* m_lowerY;
+	float32* m_upperY;
+	float32* m_lowerZ;
+	float32* m_upperZ;
+	
+	// The proxy IDs and moved flags in sorted order.
+	i32* m_sortedProxies;
+	bool* m_sortedMoved;
+	u32 m_sortedCount;
+	u32 m_sortedCapacity;
+
+	// Temporary buffer for sorting the proxies.
+	u64* m_sortKeys;
+};
+
+inline const b3AABB3& b3SweepAndPrune::GetAABB(i32 proxyId) const
+{
+	B3_ASSERT(proxyId != NULL_NODE && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+inline void* b3SweepAndPrune::GetUserData(i32 proxyId) const
+{
+	B3_ASSERT(proxyId != NULL_NODE && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline bool b3SweepAndPrune::TestOverlap(i32 proxy1, i32 proxy2) const
+{
+	B3_ASSERT(proxy1 != NULL_NODE && proxy1 < m_proxyCapacity);
+	B3_ASSERT(proxy2 != NULL_NODE && proxy2 < m_proxyCapacity);
+	return b3TestOverlap(m_proxies[proxy1].aabb, m_proxies[proxy2].aabb);
+}
+
+inline void b3SweepAndPrune::SetMoved(i32 proxyId)
+{
+	B3_ASSERT(proxyId != NULL_NODE && proxyId < m_proxyCapacity);
+	B3_ASSERT(m_proxies[proxyId].allocated);
+	m_proxies[proxyId].moved = true;
+}
+
+inline u32 b3SweepAndPrune::GetSortedCount() const
+{
+	return m_sortedCount;
+}
+
+// Get a mask with the lanes that hold one of the remaining proxies.
+inline u32 b3GetLaneMask(u32 remainingCount)
+{
+	return remainingCount < B3_SIMD_WIDTH ? (1 << remainingCount) - 1 : (1 << B3_SIMD_WIDTH) - 1;
+}
+
+template<class T>
+inline void b3SweepAndPrune::QueryPairs(T* callback, u32 begin, u32 end) const
+{
+	B3_ASSERT(m_sorted);
+	B3_ASSERT(begin <= end && end <= m_sortedCount);
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		i32 proxy1 = m_sortedProxies[i];
+		bool moved1 = m_sortedMoved[i];
+
+		b3FloatW upperX1(m_upperX[i]);
+		b3FloatW lowerY1(m_lowerY[i]), upperY1(m_upperY[i]);
+		b3FloatW lowerZ1(m_lowerZ[i]), upperZ1(m_upperZ[i]);
+
+		// Sweep the proxies that start after this proxy until one starts after its end.
+		for (u32 j = i + 1; j < m_sortedCount; j += B3_SIMD_WIDTH)
+		{
+			b3FloatW lowerX2, lowerY2, upperY2, lowerZ2, upperZ2;
+			lowerX2.Load(m_lowerX + j);
+			lowerY2.Load(m_lowerY + j);
+			upperY2.Load(m_upperY + j);
+			lowerZ2.Load(m_lowerZ + j);
+			upperZ2.Load(m_upperZ + j);
+
+			b3FloatW endMask = lowerX2 > upperX1;
+
+			b3FloatW separatedMask = endMask | 
+				(lowerY2 > upperY1) | (lowerY1 > upperY2) | 
+				(lowerZ2 > upperZ1) | (lowerZ1 > upperZ2);
+
+			u32 overlapBits = ~b3MoveMask(separatedMask) & b3GetLaneMask(m_sortedCount - j);
+			for (u32 k = 0; overlapBits != 0; ++k, overlapBits >>= 1)
+			{
+				if (overlapBits & 1)
+				{
+					// Skip pairs of resting proxies.
+					if (moved1 || m_sortedMoved[j + k])
+					{
+						callback->ReportPair(proxy1, m_sortedProxies[j + k]);
+					}
+				}
+			}
+
+			if (b3MoveMask(endMask) != 0)
+			{
+				// The remaining proxies start after this proxy.
+				break;
+			}
+		}
+	}
+}
+
+template<class T>
+inline void b3SweepAndPrune::QueryAABB(T* callback, const b3AABB3& aabb) const
+{
+	if (m_sorted == false)
+	{
+		// Test all proxies.
+		for (i32 i = 0; i < m_proxyCapacity; ++i)
+		{
+			const b3Proxy* proxy = m_proxies + i;
+			if (proxy->allocated && b3TestOverlap(proxy->aabb, aabb))
+			{
+				if (callback->Report(i) == false)
+				{
+					return;
+				}
+			}
+		}
+		return;
+	}
+
+	b3FloatW upperX1(aabb.m_upper.x), lowerX1(aabb.m_lower.x);
+	b3FloatW lowerY1(aabb.m_lower.y), upperY1(aabb.m_upper.y);
+	b3FloatW lowerZ1(aabb.m_lower.z), upperZ1(aabb.m_upper.z);
+
+	for (u32 j = 0; j < m_sortedCount; j += B3_SIMD_WIDTH)
+	{
+		b3FloatW lowerX2, upperX2, lowerY2, upperY2, lowerZ2, upperZ2;
+		lowerX2.Load(m_lowerX + j);
+		upperX2.Load(m_upperX + j);
+		lowerY2.Load(m_lowerY + j);
+		upperY2.Load(m_upperY + j);
+		lowerZ2.Load(m_lowerZ + j);
+		upperZ2.Load(m_upperZ + j);
+
+		b3FloatW endMask = lowerX2 > upperX1;
+
+		b3FloatW separatedMask = endMask | (lowerX1 > upperX2) |
+			(lowerY2 > upperY1) | (lowerY1 > upperY2) |
+			(lowerZ2 > upperZ1) | (lowerZ1 > upperZ2);
+
+		u32 overlapBits = ~b3MoveMask(separatedMask) & b3GetLaneMask(m_sortedCount - j);
+		for (u32 k = 0; overlapBits != 0; ++k, overlapBits >>= 1)
+		{
+			if (overlapBits & 1)
+			{
+				if (callback->Report(m_sortedProxies[j + k]) == false)
+				{
+					return;
+				}
+			}
+		}
+
+		if (b3MoveMask(endMask) != 0)
+		{
+			// The remaining proxies start after the AABB.
+			return;
+		}
+	}
+}
+
+template<class T>
+inline void b3SweepAndPrune::RayCast(T* callback, const b3RayCastInput& input) const
+{
+	b3Vec3 p1 = input.p1;
+	b3Vec3 p2 = input.p2;
+	b3Vec3 d = p2 - p1;
+	float32 maxFraction = input.maxFraction;
+
+	// Ensure non-degenerate segment.
+	B3_ASSERT(b3Dot(d, d) > B3_EPSILON * B3_EPSILON);
+
+	// The sorted proxies that start after the segment can't be hit.
+	b3Vec3 end = p1 + maxFraction * d;
+	float32 upperX = b3Max(p1.x, end.x);
+
+	u32 count = m_sorted ? m_sortedCount : u32(m_proxyCapacity);
+	for (u32 i = 0; i < count; ++i)
+	{
+		i32 proxyId;
+		if (m_sorted)
+		{
+			if (m_lowerX[i] > upperX)
+			{
+				return;
+			}
+
+			proxyId = m_sortedProxies[i];
+		}
+		else
+		{
+			if (m_proxies[i].allocated == false)
+			{
+				continue;
+			}
+
+			proxyId = i32(i);
+		}
+
+		float32 minFraction = 0.0f;
+		if (m_proxies[proxyId].aabb.TestRay(p1, p2, maxFraction, minFraction) == true)
+		{
+			b3RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			float32 newFraction = callback->Report(subInput, proxyId);
+
+			if (newFraction == 0.0f)
+			{
+				// The client has stopped the query.
+				return;
+			}
+
+			if (newFraction < maxFraction)
+			{
+				// Clip the segment.
+				maxFraction = newFraction;
+				end = p1 + maxFraction * d;
+				upperX = b3Max(p1.x, end.x);
+			}
+		}
+	}
+}
+
+#endif
\ No newline at end of file
@@ -63,6 +63,25 @@ public :
 	template<class T>
 	void RayCast(T* callback, const b3RayCastInput& input) const;
 
+	// Rebuild the tree top-down using a binned surface area heuristic (SAH).
+	// This gives the best query performance but it is slower than a bottom-up rebuild.
+	// The proxy IDs are kept.
+	void RebuildSAH();
+
+	// Rebuild the tree bottom-up by sorting the leaves along a space-filling curve 
+	// and repeatedly merging the nodes with their best nearby node.
+	// The proxy IDs are kept.
+	void RebuildBottomUp();
+
+	// Get the height of the tree. 
+	// This is the maximum number of internal nodes from the root to a leaf.
+	i32 GetHeight() const;
+
+	// Get the sum of the surface areas of the internal nodes.
+	// This is proportional to the expected cost of a query and can be used 
+	// to decide when to rebuild the tree.
+	float32 GetTotalArea() const;
+
 	// Validate a given node of this tree.
 	void Validate(i32 node) const;
 
@@ -105,6 +124,17 @@ private :
 
 	// Rebuild the hierarchy starting from the given node.
 	void WalkBackNodeAndCombineVolumes(i32 node);
+
+	// Swap a child of a node with a grandchild if this reduces the surface area 
+	// of the other child.
+	void Rotate(i32 node);
+
+	// Free the internal nodes and return the leaves. 
+	// The leaves buffer must have space for all nodes.
+	u32 GatherLeaves(i32* leaves);
+
+	// Build a subtree from the given leaves and return its root.
+	i32 BuildSAH(i32* leaves, u32 count);
 	
 	// Find the best node that can be merged with a given AABB.
 	i32 FindBest(const b3AABB3& aabb) const;
@@ -141,6 +171,15 @@ inline void* b3DynamicTree::GetUserData(i32 proxyId) const
 	return m_nodes[proxyId].userData;
 }
 
+inline i32 b3DynamicTree::GetHeight() const
+{
+	if (m_root == NULL_NODE)
+	{
+		return 0;
+	}
+	return m_nodes[m_root].height;
+}
+
 inline bool b3DynamicTree::TestOverlap(i32 proxy1, i32 proxy2) const 
 {
 	B3_ASSERT(proxy1 != NULL_NODE && proxy1 < m_nodeCapacity);
@@ -228,6 +267,12 @@ inline void b3DynamicTree::RayCast(T* callback, const b3RayCastInput& input) con
 					// The client has stopped the query.
 					return;
 				}
+
+				if (newFraction < maxFraction)
+				{
+					// Clip the segment.
+					maxFraction = newFraction;
+				}
 			}
 			else 
 			{
@@ -23,10 +23,22 @@
 #include <bounce/common/template/stack.h>
 #include <bounce/collision/shapes/aabb3.h>
 #include <bounce/collision/collision.h>
+#include <bounce/common/thread/thread_pool.h>
+#include <bounce/common/math/simd.h>
 
-#define NULL_NODE_S (0xFFFFFFFF)
+// Statistics of a static tree build.
+struct b3StaticTreeStats
+{
+	u32 nodeCount; // number of nodes
+	u32 leafCount; // number of leaves
+	u32 height; // maximum number of internal nodes from the root to a leaf
+	float32 cost; // surface area heuristic cost relative to the root. Lower is better
+	float64 buildTime; // build time in milliseconds
+};
 
 // AABB tree for static AABBs.
+// The tree is built top-down using a binned surface area heuristic (SAH). 
+// Each leaf holds a small number of AABBs.
 class b3StaticTree 
 {
 public:
@@ -34,17 +46,21 @@ public:
 	~b3StaticTree();
 
 	// Build this tree from a list of AABBs.
-	void Build(const b3AABB3* aabbs, u32 count);
+	// Each leaf holds at most the given number of AABBs. 
+	// The subtrees are built in parallel if a thread pool is given. 
+	// The tree doesn't depend on the number of threads.
+	void Build(const b3AABB3* aabbs, u32 count, u32 maxObjectsPerLeaf = 4, b3ThreadPool* threadPool = NULL);
 
 	// Get the AABB of a given proxy.
 	const b3AABB3& GetAABB(u32 proxyId) const;
 
 	// Get the user data associated with a given proxy.
+	// This is the index of the proxy AABB in the list passed to Build.
 	u32 GetUserData(u32 proxyId) const;
 
 	// Report the client callback all AABBs that are overlapping with
-	// the given AABB. The client callback must return true if the query 
-	// must be stopped or false to continue looking for more overlapping pairs.
+	// the given AABB. The client callback must return true to continue 
+	// looking for more overlapping AABBs or false to stop the query.
 	template<class T>
 	void QueryAABB(T* callback, const b3AABB3& aabb) const;
 
@@ -54,48 +70,284 @@ public:
 	template<class T>
 	void RayCast(T* callback, const b3RayCastInput& input) const;
 
+	// Report the client callback all pairs of AABBs of another tree and this tree 
+	// that are overlapping. The given transform takes the other tree to the frame 
+	// of this tree and the AABBs of the other tree are extended by the given radius.
+	// The client callback receives the proxy of the other tree and the proxy of this tree.
+	// It must return true to continue looking for more pairs or false to stop the query.
+	// The trees can use any node format.
+	template<class T>
+	void QueryTree(T* callback, const b3StaticTree& treeA, const b3Transform& xfA, float32 radiusA) const;
+
+	// Convert the nodes of this tree to a compact format.
+	// Each node bounds are quantized to 16 bits relative to its parent,
+	// which halves the node memory at the cost of decoding the bounds 
+	// during the queries. The quantized bounds are conservative, 
+	// so queries report the same proxies.
+	// The tree must not be empty. 
+	// Return false and keep the tree unchanged if a leaf holds more than 16 AABBs.
+	bool Compress();
+
+	// Is this tree using the compact node format?
+	bool IsCompressed() const;
+
+	// Convert the nodes of this tree to a wide format.
+	// The binary tree is collapsed so that each node holds up to B3_SIMD_WIDTH 
+	// children whose bounds are stored in SIMD form. The queries test all 
+	// the children of a node at once. 
+	// The tree must not be empty or compressed.
+	void Collapse();
+
+	// Is this tree using the wide node format?
+	bool IsCollapsed() const;
+
+	// Get the number of proxies in this tree.
+	u32 GetProxyCount() const;
+
+	// Get the size in bytes of the binary image of this tree.
+	u32 GetBlobSize() const;
+
+	// Write the binary image of this tree to a buffer of GetBlobSize() bytes.
+	// The buffer must be aligned to 16 bytes. 
+	// The image stores offsets instead of pointers, so it can be used at any address.
+	// The build time isn't stored, so the images of the same tree are identical.
+	void WriteBlob(void* blob) const;
+
+	// Use a binary image written by WriteBlob in place without copying it.
+	// The image must outlive this tree or the next build.
+	// Return false and keep the tree unchanged if the image is invalid.
+	bool ReadBlob(const void* blob, u32 size);
+
+	// Get the statistics of the last build.
+	const b3StaticTreeStats& GetStats() const;
+
 	// Draw this tree.
 	void Draw(b3Draw* draw) const;
 
 	u32 GetSize() const;
 private :
 	// A node in a static tree.
+	// The nodes are stored in depth-first order, so the first child 
+	// of an internal node is the next node.
 	struct b3Node
 	{
+		// The AABB enclosing the children or the proxies.
 		b3AABB3 aabb;
-		u32 child1;
+		
 		union
 		{
 			u32 child2;
 			u32 index;
 		};
 
+		// The number of proxies in a leaf. Zero if this is an internal node.
+		u32 count;
+
 		// Is this node a leaf?
 		bool IsLeaf() const
 		{
-			return child1 == NULL_NODE_S;
+			return count > 0;
+		}
+	};
+
+	// A node in the compact format.
+	// The bounds are quantized relative to the bounds of the parent.
+	// The lower bounds are measured from the parent lower bounds and 
+	// the upper bounds from the parent upper bounds. 
+	struct b3QuantizedNode
+	{
+		u16 lower[3];
+		u16 upper[3];
+
+		// The second child of an internal node or the leaf proxies.
+		// A leaf has the highest bit set, the number of proxies minus one 
+		// in the next four bits and the first proxy in the remaining bits.
+		u32 data;
+
+		// Is this node a leaf?
+		bool IsLeaf() const
+		{
+			return (data & 0x80000000) != 0;
+		}
+
+		// Get the second child of this internal node.
+		u32 GetChild2() const
+		{
+			return data;
+		}
+
+		// Get the first proxy of this leaf.
+		u32 GetIndex() const
+		{
+			return data & 0x07FFFFFF;
 		}
+
+		// Get the number of proxies of this leaf.
+		u32 GetCount() const
+		{
+			return ((data >> 27) & 0xF) + 1;
+		}
+	};
+
+	// A node in the wide format.
+	// The children bounds are stored in structure of arrays form.
+	// Unused children are at the end and have a null child index.
+	struct b3WideNode
+	{
+		float32 lowerX[B3_SIMD_WIDTH];
+		float32 lowerY[B3_SIMD_WIDTH];
+		float32 lowerZ[B3_SIMD_WIDTH];
+		float32 upperX[B3_SIMD_WIDTH];
+		float32 upperY[B3_SIMD_WIDTH];
+		float32 upperZ[B3_SIMD_WIDTH];
+
+		// The child nodes or the first proxy of the leaf children.
+		u32 children[B3_SIMD_WIDTH];
+
+		// The number of proxies of the leaf children. Zero if the child is a node.
+		u32 counts[B3_SIMD_WIDTH];
 	};
 
-	// 
-	void Build(const b3AABB3* set, b3Node* node, u32* indices, u32 count, u32 minObjectsPerLeaf, u32 nodeCapacity, u32& leafCount, u32& internalCount);
+	// A node to visit and its decoded bounds.
+	struct b3QuantizedEntry
+	{
+		u32 index;
+		b3AABB3 aabb;
+	};
+
+	// A node to visit in any node format.
+	struct b3TreeEntry
+	{
+		u32 index; // the node index or the first proxy of a leaf
+		u32 count; // the number of proxies of a leaf, zero if this is a node
+		b3AABB3 aabb; // the decoded bounds
+	};
+
+	// A pair of overlapping entries of a tree versus tree query.
+	struct b3TreeEntryPair
+	{
+		b3TreeEntry entryA;
+		b3AABB3 aabbA; // the bounds of the entry A in the frame of this tree
+		b3TreeEntry entryB;
+	};
+
+	friend struct b3StaticTreeBuilder;
+
+	// Compute the statistics of the built tree.
+	void ComputeStats();
+
+	// Free the arrays of this tree if it owns them.
+	void Free();
+
+	// Check that the children and the leaf proxies of the nodes of an image 
+	// are inside the node and proxy arrays and that the children come after their parent.
+	static bool ValidateNodes(const b3Node* nodes, u32 nodeCount, u32 proxyCount);
+	static bool ValidateNodes(const b3QuantizedNode* nodes, u32 nodeCount, u32 proxyCount);
+	static bool ValidateNodes(const b3WideNode* nodes, u32 nodeCount, u32 proxyCount);
+
+	// Get the size of a node in the current format.
+	u32 GetNodeSize() const;
+
+	// Get the size of a quantization step inside the decoded bounds of a parent.
+	static b3Vec3 GetQuantizationStep(const b3AABB3& parent);
+
+	// Decode the bounds of a compact node given the decoded bounds of its parent.
+	static b3AABB3 Decode(const b3AABB3& parent, const b3Vec3& step, const b3QuantizedNode* node);
+
+	template<class T>
+	void QueryQuantizedAABB(T* callback, const b3AABB3& aabb) const;
+
+	template<class T>
+	void RayCastQuantized(T* callback, const b3RayCastInput& input) const;
+
+	// Collapse the binary subtree of a given node into wide nodes.
+	// Return the index of the wide node.
+	u32 CollapseNode(u32 nodeIndex);
+
+	template<class T>
+	void QueryWideAABB(T* callback, const b3AABB3& aabb) const;
+
+	template<class T>
+	void RayCastWide(T* callback, const b3RayCastInput& input) const;
+
+	// Get the root of this tree.
+	b3TreeEntry GetRootEntry() const;
+
+	// Get the children of a node entry. 
+	// Return the number of children. 
+	u32 GetChildEntries(b3TreeEntry children[B3_SIMD_WIDTH], const b3TreeEntry& entry) const;
 
 	// The nodes of this tree stored in an array.
+	// Only one of the arrays is used depending on the node format.
 	u32 m_nodeCount;
 	b3Node* m_nodes;
+	b3QuantizedNode* m_quantizedNodes;
+	b3WideNode* m_wideNodes;
+
+	// The bounds of the root node.
+	b3AABB3 m_root;
+
+	// The proxy AABBs and user data stored in leaf order.
+	u32 m_proxyCount;
+	b3AABB3* m_aabbs;
+	u32* m_ids;
+
+	// The statistics of the last build.
+	b3StaticTreeStats m_stats;
+
+	// Does this tree own its arrays? 
+	// A tree read from a binary image doesn't.
+	bool m_ownsMemory;
 };
 
 inline const b3AABB3& b3StaticTree::GetAABB(u32 proxyId) const
 {
-	B3_ASSERT(proxyId < m_nodeCount);
-	return m_nodes[proxyId].aabb;
+	B3_ASSERT(proxyId < m_proxyCount);
+	return m_aabbs[proxyId];
+}
+
+inline u32 b3StaticTree::GetProxyCount() const
+{
+	return m_proxyCount;
 }
 
 inline u32 b3StaticTree::GetUserData(u32 proxyId) const
 {
-	B3_ASSERT(proxyId < m_nodeCount);
-	B3_ASSERT(m_nodes[proxyId].IsLeaf());
-	return m_nodes[proxyId].index;
+	B3_ASSERT(proxyId < m_proxyCount);
+	return m_ids[proxyId];
+}
+
+inline bool b3StaticTree::IsCompressed() const
+{
+	return m_quantizedNodes != NULL;
+}
+
+inline bool b3StaticTree::IsCollapsed() const
+{
+	return m_wideNodes != NULL;
+}
+
+inline const b3StaticTreeStats& b3StaticTree::GetStats() const
+{
+	return m_stats;
+}
+
+inline b3Vec3 b3StaticTree::GetQuantizationStep(const b3AABB3& parent)
+{
+	const float32 inv = 1.0f / 65535.0f;
+	return inv * (parent.m_upper - parent.m_lower);
+}
+
+inline b3AABB3 b3StaticTree::Decode(const b3AABB3& parent, const b3Vec3& step, const b3QuantizedNode* node)
+{
+	b3AABB3 aabb;
+	aabb.m_lower.x = parent.m_lower.x + float32(node->lower[0]) * step.x;
+	aabb.m_lower.y = parent.m_lower.y + float32(node->lower[1]) * step.y;
+	aabb.m_lower.z = parent.m_lower.z + float32(node->lower[2]) * step.z;
+	aabb.m_upper.x = parent.m_upper.x - float32(65535 - node->upper[0]) * step.x;
+	aabb.m_upper.y = parent.m_upper.y - float32(65535 - node->upper[1]) * step.y;
+	aabb.m_upper.z = parent.m_upper.z - float32(65535 - node->upper[2]) * step.z;
+	return aabb;
 }
 
 template<class T>
@@ -106,6 +358,18 @@ inline void b3StaticTree::QueryAABB(T* callback, const b3AABB3& aabb) const
 		return;
 	}
 
+	if (m_quantizedNodes)
+	{
+		QueryQuantizedAABB(callback, aabb);
+		return;
+	}
+
+	if (m_wideNodes)
+	{
+		QueryWideAABB(callback, aabb);
+		return;
+	}
+
 	u32 root = 0;
 
 	b3Stack<u32, 256> stack;
@@ -114,12 +378,6 @@ inline void b3StaticTree::QueryAABB(T* callback, const b3AABB3& aabb) const
 	while (stack.IsEmpty() == false) 
 	{
 		u32 nodeIndex = stack.Top();
-
-		if (nodeIndex == NULL_NODE_S)
-		{
-			continue;
-		}
-
 		stack.Pop();
 
 		const b3Node* node = m_nodes + nodeIndex;
@@ -128,15 +386,21 @@ inline void b3StaticTree::QueryAABB(T* callback, const b3AABB3& aabb) const
 		{
 			if (node->IsLeaf() == true) 
 			{
-				if (callback->Report(nodeIndex) == false) 
+				for (u32 i = node->index; i < node->index + node->count; ++i)
 				{
-					return;
+					if (b3TestOverlap(m_aabbs[i], aabb) == true)
+					{
+						if (callback->Report(i) == false)
+						{
+							return;
+						}
+					}
 				}
 			}
 			else 
 			{
-				stack.Push(node->child1);
 				stack.Push(node->child2);
+				stack.Push(nodeIndex + 1);
 			}
 		}
 	}
@@ -150,6 +414,18 @@ inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) cons
 		return;
 	}
 
+	if (m_quantizedNodes)
+	{
+		RayCastQuantized(callback, input);
+		return;
+	}
+
+	if (m_wideNodes)
+	{
+		RayCastWide(callback, input);
+		return;
+	}
+
 	b3Vec3 p1 = input.p1;
 	b3Vec3 p2 = input.p2;
 	b3Vec3 d = p2 - p1;
@@ -165,14 +441,9 @@ inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) cons
 
 	while (stack.IsEmpty() == false) 
 	{
-		i32 nodeIndex = stack.Top();	
+		u32 nodeIndex = stack.Top();	
 		stack.Pop();
 
-		if (nodeIndex == NULL_NODE_S)
-		{
-			continue;
-		}
-
 		const b3Node* node = m_nodes + nodeIndex;
 
 		float32 minFraction = 0.0f;
@@ -180,23 +451,470 @@ inline void b3StaticTree::RayCast(T* callback, const b3RayCastInput& input) cons
 		{
 			if (node->IsLeaf() == true) 
 			{
+				for (u32 i = node->index; i < node->index + node->count; ++i)
+				{
+					if (m_aabbs[i].TestRay(p1, p2, maxFraction, minFraction) == false)
+					{
+						continue;
+					}
+
+					b3RayCastInput subInput;
+					subInput.p1 = input.p1;
+					subInput.p2 = input.p2;
+					subInput.maxFraction = maxFraction;
+
+					float32 newFraction = callback->Report(subInput, i);
+
+					if (newFraction == 0.0f) 
+					{
+						// The client has stopped the query.
+						return;
+					}
+
+					if (newFraction < maxFraction)
+					{
+						// Clip the segment.
+						maxFraction = newFraction;
+					}
+				}
+			}
+			else 
+			{
+				stack.Push(node->child2);
+				stack.Push(nodeIndex + 1);
+			}
+		}
+	}
+}
+
+template<class T>
+inline void b3StaticTree::QueryTree(T* callback, const b3StaticTree& treeA, const b3Transform& xfA, float32 radiusA) const
+{
+	if (treeA.m_nodeCount == 0 || m_nodeCount == 0)
+	{
+		return;
+	}
+
+	b3TreeEntryPair root;
+	root.entryA = treeA.GetRootEntry();
+	root.aabbA = b3TransformAABB(xfA, root.entryA.aabb);
+	root.aabbA.Extend(radiusA);
+	root.entryB = GetRootEntry();
+
+	if (b3TestOverlap(root.aabbA, root.entryB.aabb) == false)
+	{
+		return;
+	}
+
+	// The children are tested before being pushed, 
+	// so every pair in the stack overlaps.
+	b3Stack<b3TreeEntryPair, 256> stack;
+	stack.Push(root);
+
+	b3TreeEntry children[B3_SIMD_WIDTH];
+
+	while (stack.IsEmpty() == false)
+	{
+		b3TreeEntryPair pair = stack.Top();
+		stack.Pop();
+
+		const b3TreeEntry& entryA = pair.entryA;
+		const b3TreeEntry& entryB = pair.entryB;
+
+		if (entryA.count > 0 && entryB.count > 0)
+		{
+			// Test the proxies of the two leaves.
+			for (u32 i = entryA.index; i < entryA.index + entryA.count; ++i)
+			{
+				b3AABB3 aabbA = b3TransformAABB(xfA, treeA.m_aabbs[i]);
+				aabbA.Extend(radiusA);
+
+				if (b3TestOverlap(aabbA, entryB.aabb) == false)
+				{
+					continue;
+				}
+
+				for (u32 j = entryB.index; j < entryB.index + entryB.count; ++j)
+				{
+					if (b3TestOverlap(aabbA, m_aabbs[j]) == true)
+					{
+						if (callback->Report(i, j) == false)
+						{
+							return;
+						}
+					}
+				}
+			}
+
+			continue;
+		}
+
+		// Descend into the node with the largest area unless it is a leaf.
+		bool descendA = entryB.count > 0 || (entryA.count == 0 && pair.aabbA.SurfaceArea() > entryB.aabb.SurfaceArea());
+
+		if (descendA)
+		{
+			u32 childCount = treeA.GetChildEntries(children, entryA);
+			for (u32 i = 0; i < childCount; ++i)
+			{
+				b3TreeEntryPair childPair;
+				childPair.entryA = children[i];
+				childPair.aabbA = b3TransformAABB(xfA, children[i].aabb);
+				childPair.aabbA.Extend(radiusA);
+				childPair.entryB = entryB;
+
+				if (b3TestOverlap(childPair.aabbA, entryB.aabb) == true)
+				{
+					stack.Push(childPair);
+				}
+			}
+		}
+		else
+		{
+			u32 childCount = GetChildEntries(children, entryB);
+			for (u32 i = 0; i < childCount; ++i)
+			{
+				b3TreeEntryPair childPair;
+				childPair.entryA = entryA;
+				childPair.aabbA = pair.aabbA;
+				childPair.entryB = children[i];
+
+				if (b3TestOverlap(pair.aabbA, children[i].aabb) == true)
+				{
+					stack.Push(childPair);
+				}
+			}
+		}
+	}
+}
+
+template<class T>
+inline void b3StaticTree::QueryQuantizedAABB(T* callback, const b3AABB3& aabb) const
+{
+	b3QuantizedEntry root;
+	root.index = 0;
+	root.aabb = Decode(m_root, GetQuantizationStep(m_root), m_quantizedNodes);
+
+	if (b3TestOverlap(root.aabb, aabb) == false)
+	{
+		return;
+	}
+
+	// The children are tested before being pushed, 
+	// so every node in the stack overlaps the AABB.
+	b3Stack<b3QuantizedEntry, 256> stack;
+	stack.Push(root);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3QuantizedEntry entry = stack.Top();
+		stack.Pop();
+
+		const b3QuantizedNode* node = m_quantizedNodes + entry.index;
+
+		if (node->IsLeaf() == true)
+		{
+			u32 index = node->GetIndex();
+			u32 count = node->GetCount();
+			for (u32 i = index; i < index + count; ++i)
+			{
+				if (b3TestOverlap(m_aabbs[i], aabb) == true)
+				{
+					if (callback->Report(i) == false)
+					{
+						return;
+					}
+				}
+			}
+		}
+		else
+		{
+			b3Vec3 step = GetQuantizationStep(entry.aabb);
+
+			b3QuantizedEntry child2;
+			child2.index = node->GetChild2();
+			child2.aabb = Decode(entry.aabb, step, m_quantizedNodes + child2.index);
+			
+			b3QuantizedEntry child1;
+			child1.index = entry.index + 1;
+			child1.aabb = Decode(entry.aabb, step, m_quantizedNodes + child1.index);
+
+			if (b3TestOverlap(child2.aabb, aabb) == true)
+			{
+				stack.Push(child2);
+			}
+
+			if (b3TestOverlap(child1.aabb, aabb) == true)
+			{
+				stack.Push(child1);
+			}
+		}
+	}
+}
+
+template<class T>
+inline void b3StaticTree::RayCastQuantized(T* callback, const b3RayCastInput& input) const
+{
+	b3Vec3 p1 = input.p1;
+	b3Vec3 p2 = input.p2;
+	b3Vec3 d = p2 - p1;
+	float32 maxFraction = input.maxFraction;
+
+	// Ensure non-degenerate segment.
+	B3_ASSERT(b3Dot(d, d) > B3_EPSILON * B3_EPSILON);
+
+	b3QuantizedEntry root;
+	root.index = 0;
+	root.aabb = Decode(m_root, GetQuantizationStep(m_root), m_quantizedNodes);
+
+	float32 minFraction = 0.0f;
+	if (root.aabb.TestRay(p1, p2, maxFraction, minFraction) == false)
+	{
+		return;
+	}
+
+	// The children are tested before being pushed, 
+	// so every node in the stack overlaps the ray.
+	b3Stack<b3QuantizedEntry, 256> stack;
+	stack.Push(root);
+
+	while (stack.IsEmpty() == false)
+	{
+		b3QuantizedEntry entry = stack.Top();
+		stack.Pop();
+
+		const b3QuantizedNode* node = m_quantizedNodes + entry.index;
+
+		if (node->IsLeaf() == true)
+		{
+			u32 index = node->GetIndex();
+			u32 count = node->GetCount();
+			for (u32 i = index; i < index + count; ++i)
+			{
+				if (m_aabbs[i].TestRay(p1, p2, maxFraction, minFraction) == false)
+				{
+					continue;
+				}
+
 				b3RayCastInput subInput;
 				subInput.p1 = input.p1;
 				subInput.p2 = input.p2;
 				subInput.maxFraction = maxFraction;
 
-				float32 newFraction = callback->Report(subInput, nodeIndex);
+				float32 newFraction = callback->Report(subInput, i);
 
-				if (newFraction == 0.0f) 
+				if (newFraction == 0.0f)
 				{
 					// The client has stopped the query.
 					return;
 				}
+
+				if (newFraction < maxFraction)
+				{
+					// Clip the segment.
+					maxFraction = newFraction;
+				}
 			}
-			else 
+		}
+		else
+		{
+			b3Vec3 step = GetQuantizationStep(entry.aabb);
+
+			b3QuantizedEntry child2;
+			child2.index = node->GetChild2();
+			child2.aabb = Decode(entry.aabb, step, m_quantizedNodes + child2.index);
+
+			b3QuantizedEntry child1;
+			child1.index = entry.index + 1;
+			child1.aabb = Decode(entry.aabb, step, m_quantizedNodes + child1.index);
+
+			if (child2.aabb.TestRay(p1, p2, maxFraction, minFraction) == true)
 			{
-				stack.Push(node->child1);
-				stack.Push(node->child2);
+				stack.Push(child2);
+			}
+
+			if (child1.aabb.TestRay(p1, p2, maxFraction, minFraction) == true)
+			{
+				stack.Push(child1);
+			}
+		}
+	}
+}
+
+// The index of an unused child of a wide node.
+const u32 b3_nullWideChild = 0xFFFFFFFF;
+
+// The bits of all the lanes of a SIMD mask.
+const u32 b3_wideLaneBits = (1 << B3_SIMD_WIDTH) - 1;
+
+template<class T>
+inline void b3StaticTree::QueryWideAABB(T* callback, const b3AABB3& aabb) const
+{
+	b3FloatW lowerX(aabb.m_lower.x), lowerY(aabb.m_lower.y), lowerZ(aabb.m_lower.z);
+	b3FloatW upperX(aabb.m_upper.x), upperY(aabb.m_upper.y), upperZ(aabb.m_upper.z);
+
+	b3Stack<u32, 256> stack;
+	stack.Push(0);
+
+	while (stack.IsEmpty() == false)
+	{
+		const b3WideNode* node = m_wideNodes + stack.Top();
+		stack.Pop();
+
+		b3FloatW nodeLowerX, nodeLowerY, nodeLowerZ;
+		nodeLowerX.Load(node->lowerX);
+		nodeLowerY.Load(node->lowerY);
+		nodeLowerZ.Load(node->lowerZ);
+
+		b3FloatW nodeUpperX, nodeUpperY, nodeUpperZ;
+		nodeUpperX.Load(node->upperX);
+		nodeUpperY.Load(node->upperY);
+		nodeUpperZ.Load(node->upperZ);
+
+		// Test all children at once.
+		b3FloatW separatedMask = (nodeLowerX > upperX) | (nodeLowerY > upperY) | (nodeLowerZ > upperZ) |
+			(lowerX > nodeUpperX) | (lowerY > nodeUpperY) | (lowerZ > nodeUpperZ);
+
+		u32 overlapBits = ~b3MoveMask(separatedMask) & b3_wideLaneBits;
+		
+		// Push the children in reverse order so the first child is visited first.
+		for (u32 k = B3_SIMD_WIDTH; k > 0; --k)
+		{
+			u32 i = k - 1;
+			
+			if ((overlapBits & (1 << i)) == 0 || node->children[i] == b3_nullWideChild)
+			{
+				continue;
+			}
+
+			u32 count = node->counts[i];
+			if (count == 0)
+			{
+				stack.Push(node->children[i]);
+				continue;
+			}
+
+			u32 index = node->children[i];
+			for (u32 j = index; j < index + count; ++j)
+			{
+				if (b3TestOverlap(m_aabbs[j], aabb) == true)
+				{
+					if (callback->Report(j) == false)
+					{
+						return;
+					}
+				}
+			}
+		}
+	}
+}
+
+template<class T>
+inline void b3StaticTree::RayCastWide(T* callback, const b3RayCastInput& input) const
+{
+	b3Vec3 p1 = input.p1;
+	b3Vec3 p2 = input.p2;
+	b3Vec3 d = p2 - p1;
+	float32 maxFraction = input.maxFraction;
+
+	// Ensure non-degenerate segment.
+	B3_ASSERT(b3Dot(d, d) > B3_EPSILON * B3_EPSILON);
+
+	// Use a large finite inverse for parallel axes to avoid 0 * inf.
+	b3Vec3 invD;
+	invD.x = d.x != 0.0f ? 1.0f / d.x : B3_MAX_FLOAT;
+	invD.y = d.y != 0.0f ? 1.0f / d.y : B3_MAX_FLOAT;
+	invD.z = d.z != 0.0f ? 1.0f / d.z : B3_MAX_FLOAT;
+
+	b3FloatW px(p1.x), py(p1.y), pz(p1.z);
+	b3FloatW invX(invD.x), invY(invD.y), invZ(invD.z);
+	b3FloatW zero(0.0f), maxFractionW(maxFraction);
+	
+	// The slab test multiplies by the inverse direction instead of dividing, 
+	// so it is made slightly conservative to never miss a child 
+	// hit by the exact test.
+	b3FloatW tolerance(1.0e-5f * maxFraction);
+
+	b3Stack<u32, 256> stack;
+	stack.Push(0);
+
+	while (stack.IsEmpty() == false)
+	{
+		const b3WideNode* node = m_wideNodes + stack.Top();
+		stack.Pop();
+
+		b3FloatW lower, upper;
+		
+		lower.Load(node->lowerX);
+		upper.Load(node->upperX);
+		b3FloatW t1 = (lower - px) * invX;
+		b3FloatW t2 = (upper - px) * invX;
+		b3FloatW tEnter = b3Max(b3Min(t1, t2), zero);
+		b3FloatW tExit = b3Min(b3Max(t1, t2), maxFractionW);
+
+		lower.Load(node->lowerY);
+		upper.Load(node->upperY);
+		t1 = (lower - py) * invY;
+		t2 = (upper - py) * invY;
+		tEnter = b3Max(tEnter, b3Min(t1, t2));
+		tExit = b3Min(tExit, b3Max(t1, t2));
+
+		lower.Load(node->lowerZ);
+		upper.Load(node->upperZ);
+		t1 = (lower - pz) * invZ;
+		t2 = (upper - pz) * invZ;
+		tEnter = b3Max(tEnter, b3Min(t1, t2));
+		tExit = b3Min(tExit, b3Max(t1, t2));
+
+		b3FloatW missMask = tEnter > tExit + tolerance;
+
+		u32 hitBits = ~b3MoveMask(missMask) & b3_wideLaneBits;
+
+		// Push the children in reverse order so the first child is visited first.
+		for (u32 k = B3_SIMD_WIDTH; k > 0; --k)
+		{
+			u32 i = k - 1;
+			
+			if ((hitBits & (1 << i)) == 0 || node->children[i] == b3_nullWideChild)
+			{
+				continue;
+			}
+
+			u32 count = node->counts[i];
+			if (count == 0)
+			{
+				stack.Push(node->children[i]);
+				continue;
+			}
+
+			u32 index = node->children[i];
+			for (u32 j = index; j < index + count; ++j)
+			{
+				float32 minFraction = 0.0f;
+				if (m_aabbs[j].TestRay(p1, p2, maxFraction, minFraction) == false)
+				{
+					continue;
+				}
+
+				b3RayCastInput subInput;
+				subInput.p1 = input.p1;
+				subInput.p2 = input.p2;
+				subInput.maxFraction = maxFraction;
+
+				float32 newFraction = callback->Report(subInput, j);
+
+				if (newFraction == 0.0f)
+				{
+					// The client has stopped the query.
+					return;
+				}
+
+				if (newFraction < maxFraction)
+				{
+					// Clip the segment.
+					maxFraction = newFraction;
+					maxFractionW = b3FloatW(maxFraction);
+				}
 			}
 		}
 	}
@@ -206,8 +924,10 @@ inline u32 b3StaticTree::GetSize() const
 {
 	u32 size = 0;
 	size += sizeof(b3StaticTree);
-	size += m_nodeCount * sizeof(b3Node);
+	size += m_nodeCount * GetNodeSize();
+	size += m_proxyCount * sizeof(b3AABB3);
+	size += m_proxyCount * sizeof(u32);
 	return size;
 }
 
-#endif
+#endif
\ No newline at end of file
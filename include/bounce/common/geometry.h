@@ -100,6 +100,35 @@ inline void b3BarycentricCoordinates(float32 out[3],
 	out[2] = divisor;
 }
 
+// Convert a point Q from Cartesian coordinates to Barycentric coordinates (u, v, w) 
+// with respect to a triangle ABC.
+// If Q isn't on the triangle plane then the coordinates are the ones of its projection.
+// The last output value is the divisor.
+inline void b3BarycentricCoordinates(float32 out[4], 
+	const b3Vec3& A, const b3Vec3& B, const b3Vec3& C,
+	const b3Vec3& Q)
+{
+	b3Vec3 AB = B - A;
+	b3Vec3 AC = C - A;
+
+	b3Vec3 QA = A - Q;
+	b3Vec3 QB = B - Q;
+	b3Vec3 QC = C - Q;
+
+	b3Vec3 QB_x_QC = b3Cross(QB, QC);
+	b3Vec3 QC_x_QA = b3Cross(QC, QA);
+	b3Vec3 QA_x_QB = b3Cross(QA, QB);
+
+	b3Vec3 AB_x_AC = b3Cross(AB, AC);
+
+	float32 divisor = b3Dot(AB_x_AC, AB_x_AC);
+
+	out[0] = b3Dot(QB_x_QC, AB_x_AC);
+	out[1] = b3Dot(QC_x_QA, AB_x_AC);
+	out[2] = b3Dot(QA_x_QB, AB_x_AC);
+	out[3] = divisor;
+}
+
 // Project a point onto a segment AB.
 inline b3Vec3 b3ClosestPointOnSegment(const b3Vec3& P, const b3Vec3& A, const b3Vec3& B)
 {
@@ -122,4 +151,76 @@ inline b3Vec3 b3ClosestPointOnSegment(const b3Vec3& P, const b3Vec3& A, const b3
 	return wA * A + wB * B;
 }
 
+// Project a point onto a triangle ABC.
+// See Real-Time Collision Detection, 5.1.5.
+inline b3Vec3 b3ClosestPointOnTriangle(const b3Vec3& P, const b3Vec3& A, const b3Vec3& B, const b3Vec3& C)
+{
+	b3Vec3 AB = B - A;
+	b3Vec3 AC = C - A;
+	
+	// Vertex region A
+	b3Vec3 AP = P - A;
+	float32 d1 = b3Dot(AB, AP);
+	float32 d2 = b3Dot(AC, AP);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return A;
+	}
+
+	// Vertex region B
+	b3Vec3 BP = P - B;
+	float32 d3 = b3Dot(AB, BP);
+	float32 d4 = b3Dot(AC, BP);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return B;
+	}
+
+	// Edge region AB
+	float32 vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		float32 v = d1 / (d1 - d3);
+		return A + v * AB;
+	}
+
+	// Vertex region C
+	b3Vec3 CP = P - C;
+	float32 d5 = b3Dot(AB, CP);
+	float32 d6 = b3Dot(AC, CP);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return C;
+	}
+
+	// Edge region AC
+	float32 vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		float32 w = d2 / (d2 - d6);
+		return A + w * AC;
+	}
+
+	// Edge region BC
+	float32 va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		float32 w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return B + w * (C - B);
+	}
+
+	// Face region
+	float32 denom = va + vb + vc;
+	if (denom <= 0.0f)
+	{
+		// Degenerate triangle
+		return A;
+	}
+
+	float32 s = 1.0f / denom;
+	float32 v = vb * s;
+	float32 w = vc * s;
+	return A + v * AB + w * AC;
+}
+
 #endif
@@ -0,0 +1,404 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SIMD_H
+#define B3_SIMD_H
+
+#include <bounce/common/math/mat33.h>
+
+// Wide numbers hold B3_SIMD_WIDTH lanes that are processed in parallel. 
+// SSE2 (4 lanes) or AVX (8 lanes) instructions are used if the compiler 
+// targets them. Otherwise the scalar fallback processes 4 lanes in a loop.
+// Define B3_NO_SIMD to force the scalar fallback.
+
+#if !defined(B3_NO_SIMD) && defined(__AVX__)
+	#define B3_SIMD_AVX
+#elif !defined(B3_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define B3_SIMD_SSE
+#endif
+
+#if defined(B3_SIMD_AVX)
+	#include <immintrin.h>
+	#define B3_SIMD_WIDTH 8
+#elif defined(B3_SIMD_SSE)
+	#include <emmintrin.h>
+	#define B3_SIMD_WIDTH 4
+#else
+	#define B3_SIMD_WIDTH 4
+#endif
+
+// The memory alignment of a wide number in bytes.
+#define B3_SIMD_ALIGNMENT (B3_SIMD_WIDTH * 4)
+
+// A wide floating point number. 
+struct b3FloatW
+{
+	// Does nothing for performance.
+	b3FloatW() { }
+
+	// Set all lanes to a scalar.
+	explicit b3FloatW(float32 s)
+	{
+#if defined(B3_SIMD_AVX)
+		v = _mm256_set1_ps(s);
+#elif defined(B3_SIMD_SSE)
+		v = _mm_set1_ps(s);
+#else
+		for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+		{
+			v[i] = s;
+		}
+#endif
+	}
+
+	// Load all lanes from an array of B3_SIMD_WIDTH scalars.
+	void Load(const float32* in)
+	{
+#if defined(B3_SIMD_AVX)
+		v = _mm256_loadu_ps(in);
+#elif defined(B3_SIMD_SSE)
+		v = _mm_loadu_ps(in);
+#else
+		for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+		{
+			v[i] = in[i];
+		}
+#endif
+	}
+
+	// Store all lanes to an array of B3_SIMD_WIDTH scalars.
+	void Store(float32* out) const
+	{
+#if defined(B3_SIMD_AVX)
+		_mm256_storeu_ps(out, v);
+#elif defined(B3_SIMD_SSE)
+		_mm_storeu_ps(out, v);
+#else
+		for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+		{
+			out[i] = v[i];
+		}
+#endif
+	}
+
+	// Read a lane. This is slow.
+	float32 GetLane(u32 i) const
+	{
+		B3_ASSERT(i < B3_SIMD_WIDTH);
+		float32 lanes[B3_SIMD_WIDTH];
+		Store(lanes);
+		return lanes[i];
+	}
+
+	// Write a lane. This is slow.
+	void SetLane(u32 i, float32 s)
+	{
+		B3_ASSERT(i < B3_SIMD_WIDTH);
+		float32 lanes[B3_SIMD_WIDTH];
+		Store(lanes);
+		lanes[i] = s;
+		Load(lanes);
+	}
+
+	void operator+=(const b3FloatW& b);
+	void operator-=(const b3FloatW& b);
+	void operator*=(const b3FloatW& b);
+
+#if defined(B3_SIMD_AVX)
+	__m256 v;
+#elif defined(B3_SIMD_SSE)
+	__m128 v;
+#else
+	float32 v[B3_SIMD_WIDTH];
+#endif
+};
+
+#if defined(B3_SIMD_AVX)
+
+inline b3FloatW b3MakeFloatW(__m256 v)
+{
+	b3FloatW r;
+	r.v = v;
+	return r;
+}
+
+inline b3FloatW operator+(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_add_ps(a.v, b.v)); }
+inline b3FloatW operator-(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_sub_ps(a.v, b.v)); }
+inline b3FloatW operator*(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_mul_ps(a.v, b.v)); }
+inline b3FloatW operator/(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_div_ps(a.v, b.v)); }
+inline b3FloatW operator-(const b3FloatW& a) { return b3MakeFloatW(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))); }
+inline b3FloatW b3Min(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_min_ps(a.v, b.v)); }
+inline b3FloatW b3Max(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_max_ps(a.v, b.v)); }
+inline b3FloatW b3Sqrt(const b3FloatW& a) { return b3MakeFloatW(_mm256_sqrt_ps(a.v)); }
+
+// Return a mask with the lanes where a > b.
+inline b3FloatW operator>(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+
+// Return a where the mask is set and b otherwise.
+inline b3FloatW b3Select(const b3FloatW& mask, const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+
+// Return the union of two masks.
+inline b3FloatW operator|(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm256_or_ps(a.v, b.v)); }
+
+// Return the lanes of a mask packed into the lower bits of an integer.
+inline u32 b3MoveMask(const b3FloatW& mask) { return u32(_mm256_movemask_ps(mask.v)); }
+
+#elif defined(B3_SIMD_SSE)
+
+inline b3FloatW b3MakeFloatW(__m128 v)
+{
+	b3FloatW r;
+	r.v = v;
+	return r;
+}
+
+inline b3FloatW operator+(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_add_ps(a.v, b.v)); }
+inline b3FloatW operator-(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_sub_ps(a.v, b.v)); }
+inline b3FloatW operator*(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_mul_ps(a.v, b.v)); }
+inline b3FloatW operator/(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_div_ps(a.v, b.v)); }
+inline b3FloatW operator-(const b3FloatW& a) { return b3MakeFloatW(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))); }
+inline b3FloatW b3Min(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_min_ps(a.v, b.v)); }
+inline b3FloatW b3Max(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_max_ps(a.v, b.v)); }
+inline b3FloatW b3Sqrt(const b3FloatW& a) { return b3MakeFloatW(_mm_sqrt_ps(a.v)); }
+
+// Return a mask with the lanes where a > b.
+inline b3FloatW operator>(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_cmpgt_ps(a.v, b.v)); }
+
+// Return a where the mask is set and b otherwise.
+inline b3FloatW b3Select(const b3FloatW& mask, const b3FloatW& a, const b3FloatW& b) 
+{ 
+	return b3MakeFloatW(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))); 
+}
+
+// Return the union of two masks.
+inline b3FloatW operator|(const b3FloatW& a, const b3FloatW& b) { return b3MakeFloatW(_mm_or_ps(a.v, b.v)); }
+
+// Return the lanes of a mask packed into the lower bits of an integer.
+inline u32 b3MoveMask(const b3FloatW& mask) { return u32(_mm_movemask_ps(mask.v)); }
+
+#else
+
+#define B3_SIMD_LANES(expression) b3FloatW r; for (u32 i = 0; i < B3_SIMD_WIDTH; ++i) { r.v[i] = expression; } return r
+
+inline b3FloatW operator+(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] + b.v[i]); }
+inline b3FloatW operator-(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] - b.v[i]); }
+inline b3FloatW operator*(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] * b.v[i]); }
+inline b3FloatW operator/(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] / b.v[i]); }
+inline b3FloatW operator-(const b3FloatW& a) { B3_SIMD_LANES(-a.v[i]); }
+inline b3FloatW b3Min(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+inline b3FloatW b3Max(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+inline b3FloatW b3Sqrt(const b3FloatW& a) { B3_SIMD_LANES(b3Sqrt(a.v[i])); }
+
+// Return a mask with the lanes where a > b. 
+// In the scalar fallback a set lane is one.
+inline b3FloatW operator>(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] > b.v[i] ? 1.0f : 0.0f); }
+
+// Return a where the mask is set and b otherwise.
+inline b3FloatW b3Select(const b3FloatW& mask, const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(mask.v[i] != 0.0f ? a.v[i] : b.v[i]); }
+
+// Return the union of two masks.
+inline b3FloatW operator|(const b3FloatW& a, const b3FloatW& b) { B3_SIMD_LANES(a.v[i] != 0.0f || b.v[i] != 0.0f ? 1.0f : 0.0f); }
+
+// Return the lanes of a mask packed into the lower bits of an integer.
+inline u32 b3MoveMask(const b3FloatW& mask)
+{
+	u32 bits = 0;
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		if (mask.v[i] != 0.0f)
+		{
+			bits |= 1 << i;
+		}
+	}
+	return bits;
+}
+
+#undef B3_SIMD_LANES
+
+#endif
+
+inline void b3FloatW::operator+=(const b3FloatW& b)
+{
+	*this = *this + b;
+}
+
+inline void b3FloatW::operator-=(const b3FloatW& b)
+{
+	*this = *this - b;
+}
+
+inline void b3FloatW::operator*=(const b3FloatW& b)
+{
+	*this = *this * b;
+}
+
+// Clamp a wide number to a range.
+inline b3FloatW b3Clamp(const b3FloatW& a, const b3FloatW& low, const b3FloatW& high)
+{
+	return b3Max(low, b3Min(a, high));
+}
+
+// Compute the arc tangent of y / x in the range [-pi, pi] for each lane.
+// This uses the polynomial of the Cephes atanf, so it is about as accurate as atan2f.
+inline b3FloatW b3Atan2(const b3FloatW& y, const b3FloatW& x)
+{
+	const b3FloatW zero(0.0f);
+	const b3FloatW one(1.0f);
+	
+	b3FloatW ax = b3Max(x, -x);
+	b3FloatW ay = b3Max(y, -y);
+
+	// Reduce to atan(z) with z in [0, 1].
+	b3FloatW num = b3Min(ax, ay);
+	b3FloatW den = b3Max(ax, ay);
+	den = b3Select(den > zero, den, one);
+	b3FloatW z = num / den;
+
+	// Reduce to [0, tan(pi / 8)] using atan(z) = pi / 4 + atan((z - 1) / (z + 1)).
+	b3FloatW large = z > b3FloatW(0.414213562f);
+	z = b3Select(large, (z - one) / (z + one), z);
+	
+	b3FloatW z2 = z * z;
+	b3FloatW r = b3FloatW(8.05374449538e-2f);
+	r = r * z2 + b3FloatW(-1.38776856032e-1f);
+	r = r * z2 + b3FloatW(1.99777106478e-1f);
+	r = r * z2 + b3FloatW(-3.33329491539e-1f);
+	r = r * z2 * z + z;
+	r = b3Select(large, b3FloatW(0.25f * B3_PI) + r, r);
+
+	// Undo the reduction.
+	r = b3Select(ay > ax, b3FloatW(0.5f * B3_PI) - r, r);
+	r = b3Select(zero > x, b3FloatW(B3_PI) - r, r);
+	r = b3Select(zero > y, -r, r);
+	return r;
+}
+
+// A wide 3D column vector.
+struct b3Vec3W
+{
+	// Does nothing for performance.
+	b3Vec3W() { }
+
+	// Set all lanes to a vector.
+	explicit b3Vec3W(const b3Vec3& v) : x(v.x), y(v.y), z(v.z) { }
+
+	// Read a lane. This is slow.
+	b3Vec3 GetLane(u32 i) const
+	{
+		return b3Vec3(x.GetLane(i), y.GetLane(i), z.GetLane(i));
+	}
+
+	// Write a lane. This is slow.
+	void SetLane(u32 i, const b3Vec3& v)
+	{
+		x.SetLane(i, v.x);
+		y.SetLane(i, v.y);
+		z.SetLane(i, v.z);
+	}
+
+	void operator+=(const b3Vec3W& b)
+	{
+		x += b.x;
+		y += b.y;
+		z += b.z;
+	}
+
+	void operator-=(const b3Vec3W& b)
+	{
+		x -= b.x;
+		y -= b.y;
+		z -= b.z;
+	}
+
+	b3FloatW x, y, z;
+};
+
+inline b3Vec3W operator+(const b3Vec3W& a, const b3Vec3W& b)
+{
+	b3Vec3W r;
+	r.x = a.x + b.x;
+	r.y = a.y + b.y;
+	r.z = a.z + b.z;
+	return r;
+}
+
+inline b3Vec3W operator-(const b3Vec3W& a, const b3Vec3W& b)
+{
+	b3Vec3W r;
+	r.x = a.x - b.x;
+	r.y = a.y - b.y;
+	r.z = a.z - b.z;
+	return r;
+}
+
+inline b3Vec3W operator-(const b3Vec3W& a)
+{
+	b3Vec3W r;
+	r.x = -a.x;
+	r.y = -a.y;
+	r.z = -a.z;
+	return r;
+}
+
+inline b3Vec3W operator*(const b3FloatW& s, const b3Vec3W& v)
+{
+	b3Vec3W r;
+	r.x = s * v.x;
+	r.y = s * v.y;
+	r.z = s * v.z;
+	return r;
+}
+
+inline b3FloatW b3Dot(const b3Vec3W& a, const b3Vec3W& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline b3Vec3W b3Cross(const b3Vec3W& a, const b3Vec3W& b)
+{
+	b3Vec3W r;
+	r.x = a.y * b.z - a.z * b.y;
+	r.y = a.z * b.x - a.x * b.z;
+	r.z = a.x * b.y - a.y * b.x;
+	return r;
+}
+
+// A wide 3-by-3 matrix stored in column-major order.
+struct b3Mat33W
+{
+	// Does nothing for performance.
+	b3Mat33W() { }
+
+	// Write a lane. This is slow.
+	void SetLane(u32 i, const b3Mat33& m)
+	{
+		x.SetLane(i, m.x);
+		y.SetLane(i, m.y);
+		z.SetLane(i, m.z);
+	}
+
+	b3Vec3W x, y, z;
+};
+
+// Multiply a wide matrix times a wide vector.
+inline b3Vec3W operator*(const b3Mat33W& A, const b3Vec3W& v)
+{
+	return v.x * A.x + v.y * A.y + v.z * A.z;
+}
+
+#endif
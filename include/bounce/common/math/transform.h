@@ -184,9 +184,11 @@ inline b3TransformQT b3Inverse(const b3TransformQT& T)
 struct b3Sweep
 {
 	// Get this sweep transform at a given time between [0, 1]
+	// The time is relative to the initial state.
 	b3Transform GetTransform(float32 t) const;
 
-	// Advance to a new initial state.
+	// Advance the initial state to a given fraction of the step.
+	// The final state is kept.
 	void Advance(float32 t);
 
 	b3Vec3 localCenter; // local center
@@ -214,11 +216,11 @@ inline b3Transform b3Sweep::GetTransform(float32 t) const
 
 inline void b3Sweep::Advance(float32 t)
 {
-	B3_ASSERT(t < 1.0f);
-	float32 dt = (t - t0) / (1.0f / t0);
-	worldCenter += dt * (worldCenter - worldCenter0);
-	orientation += dt * (orientation - orientation0);
-	orientation.Normalize();
+	B3_ASSERT(t0 < 1.0f);
+	float32 beta = (t - t0) / (1.0f - t0);
+	worldCenter0 += beta * (worldCenter - worldCenter0);
+	orientation0 += beta * (orientation - orientation0);
+	orientation0.Normalize();
 	t0 = t;
 }
 
@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_MAPPED_FILE_H
+#define B3_MAPPED_FILE_H
+
+#include <bounce/common/settings.h>
+
+// A read-only file mapped into memory.
+// The pages are shared between all processes mapping the same file.
+class b3MappedFile
+{
+public:
+	b3MappedFile();
+	~b3MappedFile();
+
+	// Map a file into memory. Return true if the file was mapped.
+	bool Open(const char* path);
+
+	// Unmap the file. 
+	// Any pointer into the file data is invalid after this call.
+	void Close();
+
+	// Get the file data or NULL if no file is mapped.
+	// The data is aligned to the page size.
+	const void* GetData() const;
+
+	// Get the file size in bytes.
+	u32 GetSize() const;
+private:
+	void* m_data;
+	u32 m_size;
+};
+
+inline const void* b3MappedFile::GetData() const
+{
+	return m_data;
+}
+
+inline u32 b3MappedFile::GetSize() const
+{
+	return m_size;
+}
+
+// Write a block of memory to a file. Return true on success.
+bool b3WriteFile(const char* path, const void* data, u32 size);
+
+#endif
\ No newline at end of file
@@ -21,11 +21,17 @@
 
 #include <bounce/common/settings.h>
 
-// Allocate 1 MiB from the stack. 
+// Initial stack size. 
 // Increase as you want.
 const u32 b3_maxStackSize = B3_MiB(1);
 
+// Alignment of the stack blocks.
+const u32 b3_stackAlignment = 16;
+
 // A stack allocator.
+// Blocks that don't fit on the stack are allocated with the parent allocator. 
+// When this happens the stack grows to the peak usage once it is empty, 
+// so later allocations of the same size don't touch the heap.
 class b3StackAllocator 
 {
 public :
@@ -47,7 +53,11 @@ private :
 	u32 m_blockCount;
 
 	u32 m_allocatedSize; // marker
-	u8 m_memory[b3_maxStackSize];
+	u32 m_requestedSize; // including the parent blocks
+	u32 m_maxRequestedSize;
+
+	u32 m_memoryCapacity;
+	u8* m_memory;
 };
 
 #endif
@@ -97,10 +97,33 @@ typedef float float32;
 // However values very close to 1 may lead to overshoot.
 #define B3_BAUMGARTE (0.1f)
 
+// This controls how faster overlaps are resolved in a time of impact sub-step.
+// The bodies are moved to the time of impact with a small overlap, so this 
+// is larger than the baumgarte of the discrete solver.
+#define B3_TOI_BAUMGARTE (0.75f)
+
+// The maximum number of times a contact can be sub-stepped in a step.
+#define B3_MAX_SUB_STEPS (8)
+
+// The number of position iterations used to separate the bodies of a time of impact.
+#define B3_TOI_POSITION_ITERATIONS (20)
+
+// The maximum number of contacts solved with a time of impact sub-step.
+#define B3_MAX_TOI_CONTACTS (32)
+
 // If the relative velocity of a contact point is below 
 // the threshold then restitution is not applied.
 #define B3_VELOCITY_THRESHOLD (1.0f)
 
+// The maximum number of colors used to batch the constraints of an island 
+// such that the constraints of a color don't share a dynamic body. 
+// The constraints that can't be colored are solved sequentially.
+#define B3_MAX_CONSTRAINT_COLORS (24)
+
+// The minimum number of constraints an island must have 
+// in order to be colored.
+#define B3_MIN_COLORED_CONSTRAINTS (256)
+
 // Sleep
 #define B3_TIME_TO_SLEEP (0.2f)
 #define B3_SLEEP_LINEAR_TOL (0.05f)
@@ -130,10 +153,17 @@ typedef float float32;
 
 #define B3_PROFILE(name) b3ProfileScope B3_UNIQUE_NAME(scope)(name)
 
+// Profile a scope only if the condition is true.
+// This is used to avoid calling the profiler from worker threads.
+#define B3_PROFILE_IF(condition, name) b3ProfileScope B3_UNIQUE_NAME(scope)(name, condition)
+
 // You should implement this function to use your own memory allocator.
+// If the world runs on more than one thread then this function must be thread-safe.
+// The default allocator is thread-safe.
 void* b3Alloc(u32 size);
 
 // You must implement this function if you have implemented b3Alloc.
+// If the world runs on more than one thread then this function must be thread-safe.
 void b3Free(void* block);
 
 // You should implement this function to visualize log messages coming 
@@ -148,9 +178,9 @@ void b3PopProfileScope();
 
 struct b3ProfileScope
 {
-	b3ProfileScope(const char* name)
+	b3ProfileScope(const char* name, bool enabled = true)
 	{
-		b = b3PushProfileScope(name);
+		b = enabled && b3PushProfileScope(name);
 	}
 
 	~b3ProfileScope()
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SORT_H
+#define B3_SORT_H
+
+#include <bounce/common/math/vec3.h>
+
+// Map a float to an unsigned integer with the same order.
+inline u32 b3GetSortKey(float32 x)
+{
+	u32 bits;
+	memcpy(&bits, &x, sizeof(u32));
+
+	// Flip all bits of negative numbers and the sign bit of positive numbers.
+	u32 mask = (bits & 0x80000000) ? 0xFFFFFFFF : 0x80000000;
+	return bits ^ mask;
+}
+
+// Spread the lower 10 bits of a number so there are two zero bits between them.
+inline u32 b3SpreadBits(u32 x)
+{
+	x &= 0x3FF;
+	x = (x | (x << 16)) & 0x030000FF;
+	x = (x | (x << 8)) & 0x0300F00F;
+	x = (x | (x << 4)) & 0x030C30C3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+// Compute the Morton code of a point in the unit cube.
+inline u32 b3GetMortonCode(const b3Vec3& p)
+{
+	u32 x = u32(b3Clamp(1024.0f * p.x, 0.0f, 1023.0f));
+	u32 y = u32(b3Clamp(1024.0f * p.y, 0.0f, 1023.0f));
+	u32 z = u32(b3Clamp(1024.0f * p.z, 0.0f, 1023.0f));
+	return (b3SpreadBits(x) << 2) | (b3SpreadBits(y) << 1) | b3SpreadBits(z);
+}
+
+// Sort 64-bit keys by their upper 32 bits with a least significant digit radix sort.
+// The sort is stable, so the lower 32 bits can hold an index that keeps 
+// the keys with the same upper bits in their initial order.
+// The temporary buffer must have the same size as the key buffer.
+void b3SortKeys(u64* keys, u64* temp, u32 count);
+
+#endif
\ No newline at end of file
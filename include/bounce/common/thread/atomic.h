@@ -0,0 +1,50 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_ATOMIC_H
+#define B3_ATOMIC_H
+
+#include <bounce/common/settings.h>
+#include <atomic>
+
+// A counter that can be updated from many threads.
+// The updates don't order other memory accesses.
+typedef std::atomic<u32> b3Counter;
+
+// Add a value to a counter.
+inline void b3Increment(b3Counter& counter, u32 value = 1)
+{
+	counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+// Subtract a value from a counter.
+inline void b3Decrement(b3Counter& counter, u32 value = 1)
+{
+	counter.fetch_sub(value, std::memory_order_relaxed);
+}
+
+// Raise a counter to a value if the value is larger.
+inline void b3RaiseTo(b3Counter& counter, u32 value)
+{
+	u32 current = counter.load(std::memory_order_relaxed);
+	while (current < value && counter.compare_exchange_weak(current, value, std::memory_order_relaxed) == false)
+	{
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_THREAD_POOL_H
+#define B3_THREAD_POOL_H
+
+#include <bounce/common/settings.h>
+
+// The maximum number of threads a thread pool can run, 
+// including the calling thread.
+const u32 b3_maxThreads = 32;
+
+struct b3ThreadPoolState;
+
+// A pool of worker threads that execute a task over a range of items.
+// The calling thread takes part in the execution. 
+// Therefore, a thread pool with a single thread executes every task 
+// serially on the calling thread and no worker thread is created.
+class b3ThreadPool
+{
+public:
+	b3ThreadPool();
+	~b3ThreadPool();
+
+	// Set the number of threads, including the calling thread.
+	// This destroys and creates worker threads.
+	// Must not be called while a task is running.
+	void SetThreadCount(u32 count);
+
+	// Get the number of threads, including the calling thread.
+	u32 GetThreadCount() const;
+
+	// Execute a task over the items in the range [0, count) and wait until
+	// all the items were processed.
+	// The range is split into chunks of at most grainSize items.
+	// Each chunk is reported to the task callback as
+	// void Execute(u32 begin, u32 end, u32 threadIndex)
+	// where threadIndex is in the range [0, thread count). 
+	// The calling thread always has index zero.
+	// Chunks may execute in any order and on any thread. 
+	template<class T>
+	void ParallelFor(T* task, u32 count, u32 grainSize);
+private:
+	typedef void(*b3TaskFcn)(void* task, u32 begin, u32 end, u32 threadIndex);
+
+	template<class T>
+	static void Execute(void* task, u32 begin, u32 end, u32 threadIndex)
+	{
+		((T*)task)->Execute(begin, end, threadIndex);
+	}
+
+	void Run(b3TaskFcn fcn, void* task, u32 count, u32 grainSize);
+
+	u32 m_threadCount;
+	b3ThreadPoolState* m_state;
+};
+
+inline u32 b3ThreadPool::GetThreadCount() const
+{
+	return m_threadCount;
+}
+
+template<class T>
+inline void b3ThreadPool::ParallelFor(T* task, u32 count, u32 grainSize)
+{
+	Run(&b3ThreadPool::Execute<T>, task, count, grainSize);
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include <bounce/common/math/transform.h>
 #include <bounce/common/template/list.h>
 #include <bounce/dynamics/time_step.h>
+#include <bounce/dynamics/island_manager.h>
 
 class b3World;
 class b3Shape;
@@ -50,6 +51,7 @@ struct b3BodyDef
 	{
 		type = e_staticBody;
 		awake = true;
+		bullet = false;
 		fixedRotationX = false;
 		fixedRotationY = false;
 		fixedRotationZ = false;
@@ -69,6 +71,11 @@ struct b3BodyDef
 	//
 	bool awake;
 	
+	// Is this a fast moving body that should be prevented from tunneling 
+	// through other bodies? 
+	// Bullets are solved with continuous collision, which increases processing time.
+	bool bullet;
+
 	//
 	bool fixedRotationX;
 	
@@ -257,6 +264,12 @@ public:
 	// Set the awake status of the body.
 	void SetAwake(bool flag);
 
+	// See if the body is treated as a bullet for continuous collision.
+	bool IsBullet() const;
+
+	// Treat the body as a bullet for continuous collision.
+	void SetBullet(bool flag);
+
 	// Get the user data associated with the body.
 	// The user data is usually a game entity.
 	void* GetUserData() const;
@@ -273,6 +286,7 @@ public:
 private:
 	friend class b3World;
 	friend class b3Island;
+	friend class b3IslandManager;
 
 	friend class b3Contact;
 	friend class b3ConvexContact;
@@ -299,6 +313,7 @@ private:
 		e_fixedRotationX = 0x0004,
 		e_fixedRotationY = 0x0008,
 		e_fixedRotationZ = 0x0010,
+		e_bulletFlag = 0x0020,
 	};
 
 	b3Body(const b3BodyDef& def, b3World* world);
@@ -316,6 +331,10 @@ private:
 	void SynchronizeTransform();
 	void SynchronizeShapes();
 
+	// Move the body to a fraction of the current step. 
+	// The broad-phase proxies aren't synchronized.
+	void Advance(float32 t);
+
 	// Check if this body should collide with another.
 	bool ShouldCollide(const b3Body* other) const;
 
@@ -330,6 +349,14 @@ private:
 	// Joint edges for this body joint graph.
 	b3List2<b3JointEdge> m_jointEdges;
 
+	// The persistent island of this body. 
+	// This is NULL if the body is static.
+	b3PersistentIsland* m_island;
+	b3IslandLink<b3Body> m_islandLink;
+
+	// Links to the world bullet list.
+	b3IslandLink<b3Body> m_bulletLink;
+
 	// User associated data (usually an entity).
 	void* m_userData;
 
@@ -497,25 +524,9 @@ inline bool b3Body::IsAwake() const
 	return (m_flags & e_awakeFlag) != 0;
 }
 
-inline void b3Body::SetAwake(bool flag) 
+inline bool b3Body::IsBullet() const
 {
-	if (flag) 
-	{
-		if (!IsAwake()) 
-		{
-			m_flags |= e_awakeFlag;
-			m_sleepTime = 0.0f;
-		}
-	}
-	else 
-	{
-		m_flags &= ~e_awakeFlag;
-		m_sleepTime = 0.0f;
-		m_force.SetZero();
-		m_torque.SetZero();
-		m_linearVelocity.SetZero();
-		m_angularVelocity.SetZero();		
-	}
+	return (m_flags & e_bulletFlag) != 0;
 }
 
 inline float32 b3Body::GetLinearDamping() const
@@ -20,10 +20,17 @@
 #define B3_CLOTH_H
 
 #include <bounce/common/math/vec3.h>
+#include <bounce/common/math/simd.h>
 #include <bounce/collision/collision.h>
+#include <bounce/collision/trees/dynamic_tree.h>
+#include <bounce/common/thread/thread_pool.h>
+#include <bounce/common/template/list.h>
 
 struct b3Mesh;
 class b3Draw;
+class b3World;
+class b3Shape;
+class b3ClothSystem;
 
 struct b3ClothDef
 {
@@ -36,6 +43,8 @@ struct b3ClothDef
 		k2 = 0.2f;
 		kd = 0.1f;
 		r = 0.0f;
+		world = NULL;
+		selfCollision = false;
 	}
 
 	// Cloth mesh
@@ -59,16 +68,17 @@ struct b3ClothDef
 
 	// Cloth thickness
 	float32 r;
-};
 
-struct b3Particle
-{
-	float32 im;
-	b3Vec3 p0;
-	b3Vec3 p;
-	b3Vec3 v;
+	// Optional world the cloth collides with.
+	// The bodies in the world aren't affected by the cloth.
+	const b3World* world;
+
+	// Keep the particles from passing through the cloth triangles.
+	// The cloth thickness must be positive.
+	bool selfCollision;
 };
 
+// A stretching constraint.
 struct b3C1
 {
 	float32 L;
@@ -76,6 +86,7 @@ struct b3C1
 	u32 i2;
 };
 
+// A bending constraint.
 struct b3C2
 {
 	float32 angle;
@@ -85,6 +96,54 @@ struct b3C2
 	u32 i4;
 };
 
+// A wide stretching constraint packs up to B3_SIMD_WIDTH stretching 
+// constraints of a color, one per lane, in structure of arrays form.
+struct b3WideC1
+{
+	float32 L[B3_SIMD_WIDTH];
+	u32 i1[B3_SIMD_WIDTH];
+	u32 i2[B3_SIMD_WIDTH];
+	u32 laneCount;
+};
+
+// A wide bending constraint packs up to B3_SIMD_WIDTH bending 
+// constraints of a color, one per lane, in structure of arrays form.
+struct b3WideC2
+{
+	float32 angle[B3_SIMD_WIDTH];
+	u32 i1[B3_SIMD_WIDTH];
+	u32 i2[B3_SIMD_WIDTH];
+	u32 i3[B3_SIMD_WIDTH];
+	u32 i4[B3_SIMD_WIDTH];
+	u32 laneCount;
+};
+
+// A contact between a particle and a shape in the world.
+struct b3ClothContact
+{
+	u32 p; // particle
+	b3Vec3 point; // closest point on the shape surface
+	b3Vec3 normal; // shape normal pointing to the particle
+	float32 friction; // shape friction
+};
+
+// A contact between a particle and a triangle of the same cloth.
+struct b3ClothSelfContact
+{
+	u32 p; // particle
+	u32 t; // triangle
+	float32 side; // side of the triangle the particle must stay on (1 or -1)
+};
+
+// The particle-triangle pairs found by a thread.
+// A pair key holds the triangle in the upper bits and the particle in the lower bits.
+struct b3ClothPairBuffer
+{
+	u64* keys;
+	u32 count;
+	u32 capacity;
+};
+
 class b3Cloth
 {
 public:
@@ -93,36 +152,138 @@ public:
 
 	void Initialize(const b3ClothDef& def);
 
-	void Step(float32 dt, u32 iterations);
+	// Step the cloth.
+	// The constraints of a color don't share particles. Therefore, if a thread pool 
+	// is given, each color is solved in parallel. The result doesn't depend 
+	// on the number of threads.
+	void Step(float32 dt, u32 iterations, b3ThreadPool* threadPool = NULL);
 
 	u32 GetVertexCount() const
 	{
 		return m_pCount;
 	}
 
-	const b3Particle* GetVertices() const
+	// Get the particle positions.
+	const b3Vec3* GetPositions() const
+	{
+		return m_x;
+	}
+
+	// Get the inverse mass of a particle.
+	float32 GetInverseMass(u32 index) const
+	{
+		B3_ASSERT(index < m_pCount);
+		return m_im[index];
+	}
+
+	// Set the inverse mass of a particle. 
+	// Set it to zero to pin the particle.
+	void SetInverseMass(u32 index, float32 invMass)
+	{
+		B3_ASSERT(index < m_pCount);
+		m_im[index] = invMass;
+	}
+
+	// Get the AABB enclosing the particles at the end of the last step.
+	const b3AABB3& GetAABB() const
+	{
+		return m_aabb;
+	}
+
+	// Is this cloth awake?
+	// A cloth system doesn't step a sleeping cloth.
+	bool IsAwake() const
 	{
-		return m_ps;
+		return m_awake;
 	}
 
-	b3Particle* GetVertices()
+	// Set the awake state of this cloth.
+	// Putting a cloth to sleep clears its particle velocities.
+	void SetAwake(bool flag);
+
+	// Get the next cloth in the cloth system list.
+	const b3Cloth* GetNext() const
+	{
+		return m_next;
+	}
+
+	b3Cloth* GetNext()
 	{
-		return m_ps;
+		return m_next;
 	}
 
 	void Draw(b3Draw* draw) const;
 private:
-	void SolveC1();
-	void SolveC2();
+	friend class b3ClothSystem;
+	friend class b3List2<b3Cloth>;
+	friend struct b3SolveWideC1Task;
+	friend struct b3SolveWideC2Task;
+	friend struct b3SolveContactsTask;
+	friend class b3ClothShapeQuery;
+	friend struct b3ClothParticleQuery;
+	friend struct b3FindSelfPairsTask;
+
+	// Initialize this cloth with particle buffers of at least 
+	// as many particles as mesh vertices.
+	// The buffers are owned by the caller.
+	void Initialize(const b3ClothDef& def, b3Vec3* x, b3Vec3* x0, b3Vec3* v, float32* im);
+
+	void SolveC1(u32 begin, u32 end);
+	void SolveC2(u32 begin, u32 end);
+
+	void SolveWideC1(u32 begin, u32 end);
+	void SolveWideC2(u32 begin, u32 end);
+
+	// Sort the constraints by color and pack each color into wide constraints.
+	void PackC1();
+	void PackC2();
+
+	// Move the particle proxies and return the AABB enclosing the particles.
+	b3AABB3 UpdateProxies();
+
+	// Find the contacts between the particles and the shapes in the world.
+	void UpdateContacts();
+
+	// Add a contact between a particle and a shape 
+	// if it is deeper than the current particle contact.
+	void AddContact(u32 particle, const b3Shape* shape);
+
+	void SolveContacts(u32 begin, u32 end);
+
+	// Hash the particles into a uniform grid.
+	void BuildHash();
+
+	// Find the particles close to a range of triangles.
+	void FindSelfPairs(u32 begin, u32 end, b3ClothPairBuffer* buffer) const;
+
+	// Find the contacts between the particles and the cloth triangles.
+	void UpdateSelfContacts(b3ThreadPool* threadPool);
 
-	b3Particle* m_ps;
+	void SolveSelfContacts();
+
+	// Particles
 	u32 m_pCount;
+	b3Vec3* m_x; // positions
+	b3Vec3* m_x0; // positions at the beginning of the step
+	b3Vec3* m_v; // velocities
+	float32* m_im; // inverse masses
 	
+	// Constraints sorted by color.
+	// The constraints that couldn't be colored are the last ones.
 	b3C1* m_c1s;
 	u32 m_c1Count;
+	u32 m_c1Colors[B3_MAX_CONSTRAINT_COLORS + 2];
 	
 	b3C2* m_c2s;
 	u32 m_c2Count;
+	u32 m_c2Colors[B3_MAX_CONSTRAINT_COLORS + 2];
+
+	// Colored constraints packed in wide constraints.
+	b3WideC1* m_wideC1s;
+	u32 m_wideC1Colors[B3_MAX_CONSTRAINT_COLORS + 1];
+
+	b3WideC2* m_wideC2s;
+	u32 m_wideC2Colors[B3_MAX_CONSTRAINT_COLORS + 1];
 
 	float32 m_k1;
 	float32 m_k2;
@@ -131,6 +292,60 @@ private:
 	b3Vec3 m_gravity;
 
 	const b3Mesh* m_mesh;
+
+	// The world the particles collide with.
+	const b3World* m_world;
+
+	// The particle AABBs. 
+	// Particle proxies are moved like the broadphase proxies.
+	b3DynamicTree m_tree;
+	i32* m_proxyIds;
+
+	// Particle contacts. 
+	// There is at most one contact per particle.
+	b3ClothContact* m_contacts;
+	u32 m_contactCount;
+	u32* m_particleContacts; // contact index of each particle
+
+	// Self-collision
+	bool m_selfCollision;
+
+	// The particles sorted by grid cell hash. 
+	// The particles of a hash bucket are contiguous.
+	float32 m_cellSize;
+	u32 m_hashSize; // power of two
+	u32* m_hashBuckets; // first particle of each bucket
+	u32* m_hashParticles;
+	b3Vec3* m_hashPositions; // particle positions in bucket order
+
+	// Each thread has its own pair buffer.
+	b3ClothPairBuffer m_threadPairs[b3_maxThreads];
+	
+	// The merged pairs.
+	u64* m_pairs;
+	u64* m_sortPairs;
+	u32 m_pairCapacity;
+
+	b3ClothSelfContact* m_selfContacts;
+	u32 m_selfContactCount;
+	u32 m_selfContactCapacity;
+
+	// The AABB enclosing the particles.
+	b3AABB3 m_aabb;
+
+	// Sleeping
+	bool m_awake;
+	float32 m_sleepTime;
+
+	// The cloth system owning the particle buffers or NULL.
+	// The particles of this cloth start at the given offset 
+	// in the system buffers.
+	b3ClothSystem* m_system;
+	u32 m_particleOffset;
+
+	// Links to the cloth system list.
+	b3Cloth* m_prev;
+	b3Cloth* m_next;
 };
 
 #endif
\ No newline at end of file
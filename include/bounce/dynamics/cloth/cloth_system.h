@@ -0,0 +1,138 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_CLOTH_SYSTEM_H
+#define B3_CLOTH_SYSTEM_H
+
+#include <bounce/dynamics/cloth/cloth.h>
+#include <bounce/common/memory/block_pool.h>
+
+// A cloth with at least this number of particles is stepped alone 
+// and its constraint colors are solved in parallel.
+// Smaller cloths are stepped in parallel, one cloth per task.
+const u32 b3_clothBatchParticleCount = 4096;
+
+// A cloth system steps many cloths in a single call.
+// The particles of all the cloths are stored in shared buffers,
+// so the cloths don't allocate their own particle memory.
+// The cloths that are at rest are put to sleep and the cloths 
+// outside of an optional view AABB aren't stepped.
+class b3ClothSystem
+{
+public:
+	b3ClothSystem();
+	~b3ClothSystem();
+
+	// Set the number of threads used to step the cloths, including the calling thread.
+	// The default is one thread. 
+	// The results don't depend on the number of threads.
+	void SetThreadCount(u32 count);
+
+	// Get the number of threads used to step the cloths.
+	u32 GetThreadCount() const;
+
+	// Enable or disable cloth sleeping.
+	// Disabling sleeping wakes up all the cloths.
+	void SetSleeping(bool flag);
+
+	// Is cloth sleeping enabled?
+	bool GetSleeping() const;
+
+	// Create a new cloth.
+	b3Cloth* CreateCloth(const b3ClothDef& def);
+
+	// Destroy an existing cloth.
+	void DestroyCloth(b3Cloth* cloth);
+
+	// Get the list of cloths in this system.
+	const b3List2<b3Cloth>& GetClothList() const;
+	b3List2<b3Cloth>& GetClothList();
+
+	// Get the number of particles of all the cloths.
+	u32 GetParticleCount() const;
+
+	// Step the awake cloths.
+	// If a view AABB is given, the cloths not overlapping it aren't stepped.
+	// A sleeping cloth colliding with a world is woken up when 
+	// an awake rigid body overlaps its AABB.
+	void Step(float32 dt, u32 iterations, const b3AABB3* view = NULL);
+
+	// Draw the cloths.
+	void Draw(b3Draw* draw) const;
+private:
+	friend struct b3StepClothsTask;
+
+	// Grow the particle buffers to hold a given number of particles.
+	void ReserveParticles(u32 count);
+
+	// Point the cloths to their particles in the buffers.
+	void RebaseCloths();
+
+	// Step a cloth and update its sleep time.
+	void StepCloth(b3Cloth* cloth, float32 dt, u32 iterations, b3ThreadPool* threadPool);
+
+	// Should a sleeping cloth be woken up by the bodies in its world?
+	bool ShouldWake(const b3Cloth* cloth) const;
+
+	b3BlockPool m_clothBlocks;
+	b3List2<b3Cloth> m_clothList;
+
+	b3ThreadPool m_threadPool;
+
+	bool m_sleeping;
+
+	// Particles of all the cloths.
+	// The particles of a cloth are contiguous.
+	u32 m_particleCount;
+	u32 m_particleCapacity;
+	b3Vec3* m_x;
+	b3Vec3* m_x0;
+	b3Vec3* m_v;
+	float32* m_im;
+
+	// The cloths to be stepped in the current step.
+	b3Cloth** m_stepCloths;
+	u32 m_stepCapacity;
+};
+
+inline u32 b3ClothSystem::GetThreadCount() const
+{
+	return m_threadPool.GetThreadCount();
+}
+
+inline bool b3ClothSystem::GetSleeping() const
+{
+	return m_sleeping;
+}
+
+inline const b3List2<b3Cloth>& b3ClothSystem::GetClothList() const
+{
+	return m_clothList;
+}
+
+inline b3List2<b3Cloth>& b3ClothSystem::GetClothList()
+{
+	return m_clothList;
+}
+
+inline u32 b3ClothSystem::GetParticleCount() const
+{
+	return m_particleCount;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_COLORING_H
+#define B3_COLORING_H
+
+#include <bounce/common/settings.h>
+
+// The maximum number of vertices of a colored constraint.
+const u32 b3_maxColorVertices = 4;
+
+// Sort constraints by color such that the constraints of a color don't share a vertex.
+// A vertex is a body or a particle. The constraints of a color can be solved in parallel.
+// The vertices functor writes the vertices of a constraint that can't be shared
+// and returns their number: u32 operator()(const T& constraint, u32* vertices).
+// The caller provides the temporary arrays: a mask per vertex, and a color
+// and a sorted copy per constraint.
+// The range of color i is [offsets[i], offsets[i + 1]).
+// The last color holds the constraints that couldn't be colored, so offsets
+// must hold B3_MAX_CONSTRAINT_COLORS + 2 values.
+template<class T, class V>
+void b3ColorConstraints(T* constraints, u32 count, const V& vertices,
+	u32* vertexMasks, u32 vertexCount, u8* colors, T* sorted, u32* offsets)
+{
+	// A color is a bit in the vertex masks.
+	B3_ASSERT(B3_MAX_CONSTRAINT_COLORS <= 32);
+	const u32 overflowColor = B3_MAX_CONSTRAINT_COLORS;
+
+	u32 colorCounts[B3_MAX_CONSTRAINT_COLORS + 1];
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	memset(vertexMasks, 0, vertexCount * sizeof(u32));
+
+	// Greedy coloring.
+	// Give each constraint the first color not used by its vertices.
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 is[b3_maxColorVertices];
+		u32 n = vertices(constraints[i], is);
+		B3_ASSERT(n <= b3_maxColorVertices);
+
+		u32 mask = 0;
+		for (u32 j = 0; j < n; ++j)
+		{
+			mask |= vertexMasks[is[j]];
+		}
+
+		u32 color = 0;
+		while (color < overflowColor && (mask & (1 << color)))
+		{
+			++color;
+		}
+
+		if (color < overflowColor)
+		{
+			for (u32 j = 0; j < n; ++j)
+			{
+				vertexMasks[is[j]] |= 1 << color;
+			}
+		}
+
+		colors[i] = u8(color);
+		++colorCounts[color];
+	}
+
+	offsets[0] = 0;
+	for (u32 i = 0; i <= overflowColor; ++i)
+	{
+		offsets[i + 1] = offsets[i] + colorCounts[i];
+	}
+
+	// Sort by color. Keep the relative order of the constraints of a color.
+	for (u32 i = 0; i <= overflowColor; ++i)
+	{
+		colorCounts[i] = offsets[i];
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		sorted[colorCounts[colors[i]]++] = constraints[i];
+	}
+
+	memcpy(constraints, sorted, count * sizeof(T));
+}
+
+#endif
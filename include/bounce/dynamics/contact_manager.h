@@ -27,6 +27,8 @@ class b3Shape;
 class b3Contact;
 class b3ContactFilter;
 class b3ContactListener;
+class b3StackAllocator;
+class b3ThreadPool;
 struct b3MeshContactLink;
 
 // Contact delegator for b3World.
@@ -42,9 +44,13 @@ public:
 	// synchronized body transforms.
 	void SynchronizeShapes();
 
-	void FindNewContacts();
+	// Find new contacts. The broad-phase runs on the thread pool.
+	void FindNewContacts(b3ThreadPool* threadPool);
 	
-	void UpdateContacts();
+	// Update the contacts. The narrow-phase runs on the thread pool using 
+	// one stack allocator per worker thread. The contact states are updated 
+	// and reported to the listener on the calling thread, in list order.
+	void UpdateContacts(b3StackAllocator* allocator, b3ThreadPool* threadPool, b3StackAllocator* threadAllocators);
 
 	b3Contact* Create(b3Shape* shapeA, b3Shape* shapeB);
 	void Destroy(b3Contact* c);
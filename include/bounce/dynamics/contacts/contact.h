@@ -23,11 +23,13 @@
 #include <bounce/common/template/list.h>
 #include <bounce/common/template/array.h>
 #include <bounce/dynamics/contacts/manifold.h>
+#include <bounce/dynamics/island_manager.h>
 
 class b3Shape;
 class b3Body;
 class b3Contact;
 class b3ContactListener;
+class b3StackAllocator;
 
 // A contact edge for the contact graph, 
 // where a shape is a vertex and a contact 
@@ -53,10 +55,11 @@ struct b3OverlappingPair
 	b3ContactEdge edgeB;
 };
 
-// todo
+// A time of impact event of a contact in the current step.
 struct b3TOIEvent
 {
-	float32 t;
+	float32 t; // time of impact as a fraction of the step
+	u32 count; // number of sub-steps of the contact in the step
 };
 
 enum b3ContactType
@@ -102,28 +105,43 @@ public:
 protected:
 	friend class b3World;
 	friend class b3Island;
+	friend class b3IslandManager;
 	friend class b3Shape;
 	friend class b3ContactManager;
 	friend class b3ContactSolver;
+	friend struct b3UpdateManifoldsTask;
 	friend class b3List2<b3Contact>;
 
 	enum b3ContactFlags 
 	{
 		e_overlapFlag = 0x0001,
 		e_islandFlag = 0x0002,
+		e_newOverlapFlag = 0x0004,
+		e_toiFlag = 0x0008,
 	};
 
 	b3Contact() { }
 	virtual ~b3Contact() { }
 
-	// Update the contact state.
-	void Update(b3ContactListener* listener);
+	// Update the contact manifolds and test if the shapes are overlapping.
+	// This doesn't change other contacts or the bodies, 
+	// so it can run in parallel with other contacts.
+	void UpdateManifolds(b3StackAllocator* allocator);
+
+	// Update the contact state from the last manifold update.
+	// This might wake the bodies and notify the listener.
+	void UpdateState(b3ContactListener* listener);
 
 	// Test if the shapes in this contact are overlapping.
 	virtual bool TestOverlap() = 0;
 
 	// Initialize contact constraits.
-	virtual void Collide() = 0;
+	virtual void Collide(b3StackAllocator* allocator) = 0;
+
+	// Compute the time the shapes first touch when the bodies move along their sweeps.
+	// The time is relative to the initial sweep states.
+	// Return one if the shapes don't touch.
+	virtual float32 ComputeTOI() = 0;
 
 	b3ContactType m_type;
 	u32 m_flags;
@@ -135,9 +153,20 @@ protected:
 	b3Manifold* m_manifolds;
 	u32 m_manifoldCount;
 
+	// Solver body indices. 
+	// These are set by the world when building the island.
+	u32 m_indexA;
+	u32 m_indexB;
+
+	// The persistent island of this contact. 
+	// This is NULL if the contact isn't touching.
+	b3PersistentIsland* m_island;
+	b3IslandLink<b3Contact> m_islandLink;
+
 	// Time of impact event from continuous collision
-	// to continuous physics.
-	//b3TOIEvent m_toi;
+	// to continuous physics. 
+	// The time is valid if the TOI flag is set.
+	b3TOIEvent m_toi;
 
 	// Links to the world contact list.
 	b3Contact* m_prev;
@@ -21,6 +21,7 @@
 
 #include <bounce/common/math/vec2.h>
 #include <bounce/common/math/mat22.h>
+#include <bounce/common/math/simd.h>
 #include <bounce/dynamics/time_step.h>
 #include <bounce/dynamics/contacts/manifold.h>
 
@@ -114,6 +115,59 @@ struct b3ContactVelocityConstraint
 	u32 manifoldCount;
 };
 
+// A wide velocity constraint point holds a point of each lane.
+struct b3WideVelocityConstraintPoint
+{
+	b3Vec3W rA;
+	b3Vec3W rB;
+
+	b3Vec3W normal;
+	b3FloatW normalMass;
+	b3FloatW normalImpulse;
+	b3FloatW velocityBias;
+};
+
+// A wide velocity constraint manifold holds a manifold of each lane.
+struct b3WideVelocityConstraintManifold
+{
+	b3Vec3W rA;
+	b3Vec3W rB;
+
+	b3Vec3W normal;
+	b3Vec3W tangent1;
+	b3Vec3W tangent2;
+
+	// Tangent mass columns
+	b3FloatW tangentMassXX, tangentMassXY;
+	b3FloatW tangentMassYX, tangentMassYY;
+	
+	b3FloatW tangentImpulseX, tangentImpulseY;
+	b3FloatW motorImpulse;
+	b3FloatW motorMass;
+
+	u32 pointIndex;
+	u32 pointCount;
+};
+
+// A wide contact velocity constraint packs up to B3_SIMD_WIDTH contact 
+// velocity constraints, one per lane, in structure of arrays form. 
+// Lanes that are not used hold zero constraints.
+struct b3WideContactVelocityConstraint
+{
+	b3FloatW invMassA;
+	b3Mat33W invIA;
+	b3FloatW invMassB;
+	b3Mat33W invIB;
+	b3FloatW friction;
+	
+	u32 manifoldIndex;
+	u32 manifoldCount;
+	
+	// The velocity constraints in the lanes.
+	u32 constraintIndex;
+	u32 laneCount;
+};
+
 struct b3ContactSolverDef 
 {
 	b3Position* positions;
@@ -134,9 +188,35 @@ public:
 	void WarmStart();
 	
 	void SolveVelocityConstraints();
+	
+	// Solve the velocity constraints in the range [begin, end).
+	// Static and kinematic bodies are not written to, therefore 
+	// constraints that only share those bodies can be solved in parallel.
+	void SolveVelocityConstraints(u32 begin, u32 end);
+	
 	void StoreImpulses();
 
+	// Clear the impulses copied from the manifolds.
+	// This is used when the constraints aren't warm started.
+	void ResetImpulses();
+
+	// Pack the velocity constraints into wide constraints of B3_SIMD_WIDTH lanes.
+	// The constraints in a range [offsets[i], offsets[i + 1]) for i < rangeCount 
+	// must not share a dynamic body. 
+	// The wide constraints of range i are written to [wideOffsets[i], wideOffsets[i + 1]).
+	void PackWideConstraints(const u32* offsets, u32 rangeCount, u32* wideOffsets);
+	
+	// Solve the wide velocity constraints in the range [begin, end). 
+	void SolveWideVelocityConstraints(u32 begin, u32 end);
+	
+	// Copy the wide constraint impulses to the velocity constraints.
+	void UnpackWideConstraints();
+
 	bool SolvePositionConstraints();
+
+	// Solve the position constraints of a time of impact sub-step.
+	// Only the bodies of the time of impact are moved.
+	bool SolveTOIPositionConstraints(u32 toiIndexA, u32 toiIndexB);
 protected:
 	b3Position* m_positions;
 	b3Velocity* m_velocities;
@@ -144,8 +224,23 @@ protected:
 	b3ContactPositionConstraint* m_positionConstraints;
 	b3ContactVelocityConstraint* m_velocityConstraints;
 	u32 m_count;
+	
+	// The manifolds and points of all constraints. 
+	// The constraints point to their ranges in these arrays.
+	b3PositionConstraintManifold* m_positionManifolds;
+	b3VelocityConstraintManifold* m_velocityManifolds;
+	u32 m_manifoldCount;
+	b3PositionConstraintPoint* m_positionPoints;
+	b3VelocityConstraintPoint* m_velocityPoints;
+	u32 m_pointCount;
 	float32 m_dt, m_invDt;
 	b3StackAllocator* m_allocator;
+
+	void* m_wideMemory;
+	b3WideContactVelocityConstraint* m_wideConstraints;
+	u32 m_wideCount;
+	b3WideVelocityConstraintManifold* m_wideManifolds;
+	b3WideVelocityConstraintPoint* m_widePoints;
 };
 
 #endif
@@ -34,7 +34,9 @@ private:
 
 	bool TestOverlap();
 
-	void Collide();
+	void Collide(b3StackAllocator* allocator);
+
+	float32 ComputeTOI();
 	
 	b3Manifold m_stackManifold;
 	b3ConvexCache m_cache;
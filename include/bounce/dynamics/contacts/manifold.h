@@ -32,7 +32,7 @@ struct b3ManifoldPoint
 	b3Vec3 localPoint2; // local point on the other shape without its radius
 
 	u32 triangleKey; // triangle identifier
-	u32 key; // point identifier
+	u64 key; // point identifier
 
 	float32 normalImpulse; // normal impulse
 	u32 persisting; // is this point persistent?
@@ -27,8 +27,10 @@
 // This structure helps replicate the convex contact per convex-triangle pair scenario, 
 // but efficiently. There is no need to store a manifold here since they're reduced 
 // by the cluster algorithm.
+// If the first shape is a mesh then this is a triangle pair.
 struct b3TriangleCache
 {
+	u32 indexA; // triangle index on the first shape or zero
 	u32 index; // triangle index
 	b3ConvexCache cache;
 };
@@ -48,6 +50,7 @@ class b3MeshContact : public b3Contact
 public:
 private:
 	friend class b3ContactManager;
+	friend class b3World;
 	friend class b3List2<b3MeshContact>;
 	friend class b3StaticTree;
 
@@ -56,24 +59,40 @@ private:
 
 	bool TestOverlap();
 
-	void Collide();
+	void Collide(b3StackAllocator* allocator);
 	
 	void CollideSphere();
 
+	float32 ComputeTOI();
+
 	void SynchronizeShapes();
 
 	bool MoveAABB(const b3AABB3& aabb, const b3Vec3& displacement);
 
+	// Did the mesh A move farther than the AABB extension since the last query?
+	bool MoveMesh(const b3Transform& xf);
+
 	void FindNewPairs();
 
+	void AddPair(u32 indexA, u32 indexB);
+
 	// Static tree callback. There is no midphase. 
 	bool Report(u32 proxyId);
 
+	// Static tree versus tree callback.
+	bool Report(u32 proxyIdA, u32 proxyIdB);
+
 	// Did the AABB move significantly?
 	bool m_aabbMoved;
 
 	// The AABB A relative to shape B's origin.
 	b3AABB3 m_aabbA; 
+
+	// If the shape A is a mesh, the transform of the mesh A 
+	// relative to shape B's origin at the last query and the 
+	// maximum distance of its vertices to its origin.
+	b3Transform m_xfA;
+	float32 m_radiusA;
 	
 	// Triangles potentially overlapping with the first shape.
 	u32 m_triangleCapacity;
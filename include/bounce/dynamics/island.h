@@ -22,6 +22,7 @@
 #include <bounce/common/math/vec3.h>
 
 class b3StackAllocator;
+class b3ThreadPool;
 class b3Contact;
 class b3Joint;
 class b3Body;
@@ -29,40 +30,60 @@ struct b3Velocity;
 struct b3Position;
 struct b3Profile;
 
+// An island is a set of bodies connected by contacts and joints.
+// Islands don't share non-static bodies, therefore they can be solved 
+// independently of each other.
+// The island doesn't own the body, contact, and joint arrays. These are 
+// filled by the world. The island solver data is allocated using the given allocator.
+// If the island is colored then its velocity constraints are solved 
+// in parallel using the given thread pool. The thread pool can be NULL.
 class b3Island 
 {
 public :
-	b3Island(b3StackAllocator* stack, u32 bodyCapacity, u32 contactCapacity, u32 jointCapacity);
+	b3Island(b3StackAllocator* allocator, b3ThreadPool* threadPool, 
+		b3Body** bodies, u32 bodyCount, 
+		b3Contact** contacts, u32 contactCount, 
+		b3Joint** joints, u32 jointCount);
 	~b3Island();
 
-	void Clear();
-	
-	void Add(b3Body* body);
-	void Add(b3Contact* contact);
-	void Add(b3Joint* joint);
-	
 	void Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations, u32 positionIterations, u32 flags);
+
+	// Solve the contacts of a time of impact sub-step. 
+	// The bodies must be at the time of impact and dt is the time left in the step.
+	// The overlap is resolved by moving the two bodies of the time of impact only.
+	void SolveTOI(float32 dt, u32 velocityIterations, u32 positionIterations, u32 toiIndexA, u32 toiIndexB);
 private :
 	enum b3IslandFlags
 	{
 		e_warmStartBit = 0x0001,
-		e_sleepBit = 0x0002
+		e_sleepBit = 0x0002,
+		e_profileBit = 0x0004,
+		e_colorBit = 0x0008
 	};
 
 	friend class b3World;
 
+	// Sort the constraints by color such that the constraints of a color don't share 
+	// a body. Static and kinematic bodies can be shared if shareStatic is true.
+	// The range of color i is [offsets[i], offsets[i + 1]).
+	// The last color holds the constraints that couldn't be colored.
+	template<class T>
+	void Color(T** constraints, u32 count, bool shareStatic, u32* offsets);
+
+	// Get the bodies of a constraint that the constraints of a color can't share.
+	template<class T>
+	struct b3ConstraintBodies;
+
 	b3StackAllocator* m_allocator;
+	b3ThreadPool* m_threadPool;
 	
 	b3Body** m_bodies;
-	u32 m_bodyCapacity;
 	u32 m_bodyCount;
 
 	b3Contact** m_contacts;
-	u32 m_contactCapacity;
 	u32 m_contactCount;
 
 	b3Joint** m_joints;
-	u32 m_jointCapacity;
 	u32 m_jointCount;
 	
 	b3Position* m_positions;
@@ -0,0 +1,105 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_ISLAND_MANAGER_H
+#define B3_ISLAND_MANAGER_H
+
+#include <bounce/common/memory/block_pool.h>
+#include <bounce/common/template/list.h>
+
+class b3StackAllocator;
+class b3Body;
+class b3Contact;
+class b3Joint;
+
+// Links a body, a contact, or a joint to the island it belongs to.
+template<class T>
+struct b3IslandLink
+{
+	T* m_item;
+	b3IslandLink* m_prev;
+	b3IslandLink* m_next;
+};
+
+// A persistent island is a connected component of the constraint graph. 
+// It holds non-static bodies and the touching contacts and joints connected to them.
+// Islands are merged when a constraint links two of them and 
+// split lazily when constraints were removed from them.
+struct b3PersistentIsland
+{
+	b3List2< b3IslandLink<b3Body> > m_bodies;
+	b3List2< b3IslandLink<b3Contact> > m_contacts;
+	b3List2< b3IslandLink<b3Joint> > m_joints;
+
+	// Number of constraints removed since the island was built.
+	// The island might need to be split if this is not zero.
+	u32 m_constraintRemoveCount;
+
+	// Is this island on the awake island list?
+	bool m_awake;
+
+	// Links to the island list.
+	b3PersistentIsland* m_prev;
+	b3PersistentIsland* m_next;
+};
+
+// Island delegator for b3World.
+class b3IslandManager
+{
+public:
+	b3IslandManager();
+	~b3IslandManager();
+
+	// Create an island for a non-static body.
+	void AddBody(b3Body* b);
+	
+	// Remove a body from its island. 
+	// The constraints connected to the body must have been removed.
+	void RemoveBody(b3Body* b);
+
+	// Link a touching contact to the islands of its bodies.
+	void AddContact(b3Contact* c);
+	void RemoveContact(b3Contact* c);
+
+	// Link a joint to the islands of its bodies.
+	void AddJoint(b3Joint* j);
+	void RemoveJoint(b3Joint* j);
+
+	// Move an island to the awake or sleeping island list.
+	void WakeIsland(b3PersistentIsland* island);
+	void SleepIsland(b3PersistentIsland* island);
+
+	// Split an island into its connected components.
+	// Components without awake bodies are put to sleep.
+	// The island flags of the bodies, contacts and joints are clear on return.
+	void SplitIsland(b3PersistentIsland* island, b3StackAllocator* allocator);
+
+	b3List2<b3PersistentIsland> m_awakeList;
+	b3List2<b3PersistentIsland> m_sleepingList;
+private:
+	b3PersistentIsland* CreateIsland(bool awake);
+	void DestroyIsland(b3PersistentIsland* island);
+
+	// Merge the islands of two bodies and return the resulting island.
+	b3PersistentIsland* Link(b3Body* bodyA, b3Body* bodyB);
+	void Merge(b3PersistentIsland* dst, b3PersistentIsland* src);
+
+	b3BlockPool m_islandBlocks;
+};
+
+#endif
\ No newline at end of file
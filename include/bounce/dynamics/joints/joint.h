@@ -23,6 +23,7 @@
 #include <bounce/common/math/mat.h>
 #include <bounce/common/template/list.h>
 #include <bounce/dynamics/time_step.h>
+#include <bounce/dynamics/island_manager.h>
 
 class b3Draw;
 class b3Body;
@@ -123,6 +124,7 @@ protected:
 	friend class b3Body;
 	friend class b3World;
 	friend class b3Island;
+	friend class b3IslandManager;
 	friend class b3JointManager;
 	friend class b3JointSolver;
 	friend class b3List2<b3Joint>;
@@ -151,6 +153,16 @@ protected:
 	void* m_userData;
 	bool m_collideLinked;
 
+	// Solver body indices. 
+	// These are set by the world when building the island.
+	u32 m_indexA;
+	u32 m_indexB;
+
+	// The persistent island of this joint. 
+	// This is NULL if both bodies are static.
+	b3PersistentIsland* m_island;
+	b3IslandLink<b3Joint> m_islandLink;
+
 	// Links to the world joint list.
 	b3Joint* m_prev;
 	b3Joint* m_next;
@@ -49,6 +49,9 @@ public :
 	void InitializeConstraints();
 	void WarmStart();
 	void SolveVelocityConstraints();	
+	
+	// Solve the velocity constraints in the range [begin, end).
+	void SolveVelocityConstraints(u32 begin, u32 end);
 	bool SolvePositionConstraints();
 private :
 	b3SolverData m_solverData;
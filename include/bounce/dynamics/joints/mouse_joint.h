@@ -77,7 +77,6 @@ private:
 	float32 m_maxForce;
 
 	// Solver temp
-	u32 m_indexB;
 	float32 m_mB;
 	b3Mat33 m_iB;
 	b3Vec3 m_localCenterB;
@@ -163,8 +163,6 @@ private:
 	float32 m_upperAngle;
 
 	// Solver temp
-	u32 m_indexA;
-	u32 m_indexB;
 	float32 m_mA;
 	float32 m_mB;
 	b3Mat33 m_iA;
@@ -70,8 +70,6 @@ private:
 	b3Vec3 m_localAnchorB;
 
 	// Solver temp
-	u32 m_indexA;
-	u32 m_indexB;
 	float32 m_mA;
 	float32 m_mB;
 	b3Mat33 m_iA;
@@ -115,8 +115,6 @@ private:
 	float32 m_dampingRatio;
 
 	// Solver temp
-	u32 m_indexA;
-	u32 m_indexB;
 	float32 m_mA;
 	float32 m_mB;
 	b3Mat33 m_iA;
@@ -76,8 +76,6 @@ private:
 	b3Quat m_referenceRotation;
 
 	// Solver temp
-	u32 m_indexA;
-	u32 m_indexB;
 	float32 m_mA;
 	float32 m_mB;
 	b3Mat33 m_iA;
@@ -39,6 +39,8 @@ public :
 
 	bool RayCast(b3RayCastOutput* output, const b3RayCastInput& input, const b3Transform& xf) const;
 
+	bool CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const;
+
 	const b3Hull* m_hull;
 };
 
@@ -41,6 +41,8 @@ public:
 
 	bool RayCast(b3RayCastOutput* output, const b3RayCastInput& input, const b3Transform& xf) const;
 
+	bool CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const;
+
 	bool RayCast(b3RayCastOutput* output, const b3RayCastInput& input, const b3Transform& xf, u32 childIndex) const;
 
 	const b3Mesh* m_mesh;
@@ -22,6 +22,7 @@
 #include <bounce/common/math/transform.h>
 #include <bounce/common/template/list.h>
 #include <bounce/collision/collision.h>
+#include <bounce/collision/shapes/sphere.h>
 
 struct b3ContactEdge;
 
@@ -69,6 +70,13 @@ struct b3MassData
 	b3Mat33 I;
 };
 
+// The contact between a sphere and a shape.
+struct b3SphereManifold
+{
+	b3Vec3 point; // closest point on the shape surface
+	b3Vec3 normal; // normal pointing from the shape to the sphere
+};
+
 class b3Shape
 {
 public:
@@ -93,6 +101,10 @@ public:
 
 	// Compute the ray intersection point, normal of surface, and fraction.
 	virtual bool RayCast(b3RayCastOutput* output, const b3RayCastInput& input, const b3Transform& xf) const = 0;
+
+	// Compute the contact between a world sphere and this shape.
+	// Return true if the sphere overlaps this shape.
+	virtual bool CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const = 0;
 	
 	// Set if this shape is a sensor.
 	void SetSensor(bool bit);
@@ -139,6 +151,7 @@ protected:
 	friend class b3Body;
 	friend class b3Contact;
 	friend class b3ContactManager;
+	friend class b3IslandManager;
 	friend class b3MeshContact;
 	friend class b3ContactSolver;
 	friend class b3List1<b3Shape>;
@@ -37,6 +37,8 @@ public :
 	
 	bool RayCast(b3RayCastOutput* output, const b3RayCastInput& input, const b3Transform& xf) const;
 
+	bool CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const;
+
 	b3Vec3 m_center;
 };
 
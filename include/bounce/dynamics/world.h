@@ -22,14 +22,18 @@
 #include <bounce/common/memory/stack_allocator.h>
 #include <bounce/common/memory/block_pool.h>
 #include <bounce/common/template/list.h>
+#include <bounce/common/thread/thread_pool.h>
+#include <bounce/common/thread/atomic.h>
 #include <bounce/dynamics/time_step.h>
 #include <bounce/dynamics/joint_manager.h>
 #include <bounce/dynamics/contact_manager.h>
+#include <bounce/dynamics/island_manager.h>
 
 struct b3BodyDef;
 class b3Body;
 class b3QueryListener;
 class b3RayCastListener;
+class b3ShapeCastListener;
 class b3ContactListener;
 class b3ContactFilter;
 
@@ -41,6 +45,14 @@ struct b3RayCastSingleOutput
 	float32 fraction; // time of intersection on segment
 };
 
+struct b3ShapeCastSingleOutput
+{
+	b3Shape* shape; // shape
+	b3Vec3 point; // contact point on the shape
+	b3Vec3 normal; // surface normal at the contact point
+	float32 fraction; // time of impact on the translation
+};
+
 // Use a physics world to create/destroy rigid bodies, execute ray cast and volume queries.
 class b3World
 {
@@ -62,11 +74,43 @@ public:
 	// Enable warm-starting for the constraint solvers. This improves stability significantly.
 	void SetWarmStart(bool flag);
 	
+	// Enable graph coloring for large islands. 
+	// The constraints of a large island are split into colors that 
+	// don't share a dynamic body and each color is solved in parallel. 
+	// This changes the constraint solving order, but the results still don't 
+	// depend on the number of threads.
+	void SetConstraintColoring(bool flag);
+
+	// Enable continuous collision for bullet bodies. 
+	// The bullets are moved to the time of impact of their contacts 
+	// and the rest of the step is solved in sub-steps.
+	void SetContinuousPhysics(bool flag);
+
+	// Set the broad-phase algorithm used to find new contacts.
+	// The existing shape proxies are moved to the new broad-phase.
+	void SetBroadPhaseType(b3BroadPhaseType type);
+
+	// Get the broad-phase algorithm used to find new contacts.
+	b3BroadPhaseType GetBroadPhaseType() const;
+
+	// Rebuild the broad-phase tree. 
+	// Call this periodically in long running simulations if 
+	// the tree quality has degraded.
+	void RebuildBroadPhase();
+
 	// Set the acceleration due to the gravity force between this world and each dynamic 
 	// body in the world. 
 	// The acceleration has units of m/s^2.
 	void SetGravity(const b3Vec3& gravity);
 
+	// Set the number of threads used to step the world, including the calling thread.
+	// The default is one thread. 
+	// The results don't depend on the number of threads.
+	void SetThreadCount(u32 count);
+
+	// Get the number of threads used to step the world.
+	u32 GetThreadCount() const;
+
 	// Create a new rigid body.
 	b3Body* CreateBody(const b3BodyDef& def);
 	
@@ -99,6 +143,28 @@ public:
 	// and the intersection fraction.
 	void RayCast(b3RayCastListener* listener, const b3Vec3& p1, const b3Vec3& p2) const;
 
+	// Perform a ray cast with the world for each segment in an array.
+	// The output of each segment is the closest intercepted shape or a NULL shape 
+	// if the segment doesn't intersect a shape in the world. 
+	// The segments are sorted so that nearby segments are traced together and 
+	// they are distributed over the worker threads of this world.
+	void RayCastBatch(b3RayCastSingleOutput* outputs, const b3RayCastInput* inputs, u32 count);
+
+	// Sweep a shape through the world.
+	// The shape starts at the given transform and is translated by the given translation. 
+	// If the shape doesn't touch a shape in the world then return false.
+	// The shape cast output is the first shape touched, the contact point on that shape 
+	// in world space, the surface normal at the point, and the fraction of the translation.
+	// The swept shape can be a sphere, capsule or hull. It is skipped if it belongs to the world.
+	bool ShapeCastSingle(b3ShapeCastSingleOutput* output, const b3Shape* shape, const b3Transform& xf, const b3Vec3& translation) const;
+
+	// Sweep a shape through the world.
+	// The given shape cast listener will be notified when the swept shape touches 
+	// a shape in the world. 
+	// The shape cast output is the touched shape, the contact point on that shape 
+	// in world space, the surface normal at the point, and the fraction of the translation.
+	void ShapeCast(b3ShapeCastListener* listener, const b3Shape* shape, const b3Transform& xf, const b3Vec3& translation) const;
+
 	// Perform a AABB query with the world.
 	// The query listener will be notified when two shape AABBs are overlapping.
 	// If the listener returns false then the query is stopped immediately.
@@ -117,6 +183,9 @@ public:
 	const b3List2<b3Contact>& GetContactList() const;
 	b3List2<b3Contact>& GetContactList();
 
+	// Get the broad-phase.
+	const b3BroadPhase& GetBroadPhase() const;
+
 	// Debug draw the physics entities that belong to this world.
 	// The user must implement the debug draw interface b3Draw and b3_debugDraw must have been 
 	// set to the user implementation.
@@ -137,11 +206,19 @@ private :
 	friend class b3ConvexContact;
 	friend class b3MeshContact;
 	friend class b3Joint;
+	friend class b3ContactManager;
+	friend class b3JointManager;
 
 	void Solve(float32 dt, u32 velocityIterations, u32 positionIterations);
+	void SolveTOI(float32 dt, u32 velocityIterations);
+
+	// Update a contact after its bodies were moved in a continuous step.
+	void UpdateTOIContact(b3Contact* contact);
 
 	bool m_sleeping;
 	bool m_warmStarting;
+	bool m_constraintColoring;
+	bool m_continuousPhysics;
 	u32 m_flags;
 	b3Vec3 m_gravity;
 	b3Draw* m_debugDraw;
@@ -149,6 +226,10 @@ private :
 	b3StackAllocator m_stackAllocator;
 	b3BlockPool m_bodyBlocks;
 
+	// Thread pool and one stack allocator per worker thread.
+	b3ThreadPool m_threadPool;
+	b3StackAllocator* m_threadAllocators;
+
 	// List of bodies
 	b3List2<b3Body> m_bodyList;
 	
@@ -157,6 +238,14 @@ private :
 	
 	// List of contacts
 	b3ContactManager m_contactMan;
+
+	// Persistent islands
+	b3IslandManager m_islandMan;
+
+	// List of bullets and the number of awake bullets.
+	// The continuous step is skipped if no bullet is awake.
+	b3List2< b3IslandLink<b3Body> > m_bulletList;
+	b3Counter m_awakeBulletCount;
 };
 
 inline void b3World::SetContactListener(b3ContactListener* listener)
@@ -174,6 +263,36 @@ inline void b3World::SetGravity(const b3Vec3& gravity)
 	m_gravity = gravity;
 }
 
+inline void b3World::SetConstraintColoring(bool flag)
+{
+	m_constraintColoring = flag;
+}
+
+inline void b3World::SetContinuousPhysics(bool flag)
+{
+	m_continuousPhysics = flag;
+}
+
+inline b3BroadPhaseType b3World::GetBroadPhaseType() const
+{
+	return m_contactMan.m_broadPhase.GetType();
+}
+
+inline void b3World::RebuildBroadPhase()
+{
+	m_contactMan.m_broadPhase.Rebuild();
+}
+
+inline const b3BroadPhase& b3World::GetBroadPhase() const
+{
+	return m_contactMan.m_broadPhase;
+}
+
+inline u32 b3World::GetThreadCount() const
+{
+	return m_threadPool.GetThreadCount();
+}
+
 inline void b3World::SetWarmStart(bool flag)
 {
 	m_warmStarting = flag;
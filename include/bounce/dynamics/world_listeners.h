@@ -48,6 +48,20 @@ public:
 	virtual float32 ReportShape(b3Shape* shape, const b3Vec3& point, const b3Vec3& normal, float32 fraction) = 0;
 };
 
+class b3ShapeCastListener 
+{
+public:	
+	// The user must return the new shape cast fraction.
+	// If fraction equals zero then the shape cast query will be canceled immediately.
+	virtual ~b3ShapeCastListener() { }
+
+	// Report that a shape was hit by the swept shape to this listener.
+	// The reported information are the shape hit, the contact point on the shape, 
+	// the surface normal at the point, and the fraction of the translation 
+	// where the swept shape touches the shape.
+	virtual float32 ReportShape(b3Shape* shape, const b3Vec3& point, const b3Vec3& normal, float32 fraction) = 0;
+};
+
 class b3ContactListener 
 {
 public:
@@ -219,6 +219,9 @@ solution (solution_name)
 		}
 
 		links { "bounce" }
+
+		configuration { "not windows", "not macosx" }
+			links { "pthread" }
 -- build
 if os.is "windows" then
 	
@@ -20,6 +20,9 @@
 
 b3BroadPhase::b3BroadPhase() 
 {
+	m_type = e_dynamicTreeBroadPhase;
+	m_proxyCount = 0;
+
 	m_moveBufferCapacity = 16;
 	m_moveBuffer = (i32*)b3Alloc(m_moveBufferCapacity * sizeof(i32));
 	memset(m_moveBuffer, 0, m_moveBufferCapacity * sizeof(i32));
@@ -29,14 +32,38 @@ b3BroadPhase::b3BroadPhase()
 	m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
 	memset(m_pairs, 0, m_pairCapacity * sizeof(b3Pair));
 	m_pairCount = 0;
+
+	m_sortPairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
+
+	for (u32 i = 0; i < b3_maxThreads; ++i)
+	{
+		b3PairBuffer* buffer = m_threadPairs + i;
+		buffer->pairs = NULL;
+		buffer->count = 0;
+		buffer->capacity = 0;
+	}
 }
 
 b3BroadPhase::~b3BroadPhase() 
 {
+	for (u32 i = 0; i < b3_maxThreads; ++i)
+	{
+		if (m_threadPairs[i].pairs)
+		{
+			b3Free(m_threadPairs[i].pairs);
+		}
+	}
 	b3Free(m_moveBuffer);
+	b3Free(m_sortPairs);
 	b3Free(m_pairs);
 }
 
+void b3BroadPhase::SetType(b3BroadPhaseType type)
+{
+	B3_ASSERT(m_proxyCount == 0);
+	m_type = type;
+}
+
 void b3BroadPhase::BufferMove(i32 proxyId) 
 {
 	// The proxy has been moved. Add it to the buffer of moved proxies.
@@ -57,8 +84,24 @@ void b3BroadPhase::BufferMove(i32 proxyId)
 	++m_moveBufferCount;
 }
 
+void b3BroadPhase::UnBufferMove(i32 proxyId)
+{
+	// The proxy ID might be reused before the pairs are found.
+	for (u32 i = 0; i < m_moveBufferCount; ++i)
+	{
+		if (m_moveBuffer[i] == proxyId)
+		{
+			m_moveBuffer[i] = NULL_NODE;
+		}
+	}
+}
+
 bool b3BroadPhase::TestOverlap(i32 proxy1, i32 proxy2) const 
 {
+	if (m_type == e_sweepAndPruneBroadPhase)
+	{
+		return m_sap.TestOverlap(proxy1, proxy2);
+	}
 	return m_tree.TestOverlap(proxy1, proxy2);
 }
 
@@ -70,19 +113,40 @@ i32 b3BroadPhase::CreateProxy(const b3AABB3& aabb, void* userData)
 	// so we can check later if the new (original) AABB is inside the old (fat) AABB.
 	b3AABB3 fatAABB = aabb;
 	fatAABB.Extend(B3_AABB_EXTENSION);	
-	i32 proxyId = m_tree.InsertNode(fatAABB, userData);
+	
+	i32 proxyId;
+	if (m_type == e_sweepAndPruneBroadPhase)
+	{
+		proxyId = m_sap.InsertProxy(fatAABB, userData);
+	}
+	else
+	{
+		proxyId = m_tree.InsertNode(fatAABB, userData);
+	}
+	++m_proxyCount;
+
 	BufferMove(proxyId);
 	return proxyId;
 }
 
 void b3BroadPhase::DestroyProxy(i32 proxyId) 
 {
-	return m_tree.RemoveNode(proxyId);
+	UnBufferMove(proxyId);
+	
+	B3_ASSERT(m_proxyCount > 0);
+	--m_proxyCount;
+
+	if (m_type == e_sweepAndPruneBroadPhase)
+	{
+		m_sap.RemoveProxy(proxyId);
+		return;
+	}
+	m_tree.RemoveNode(proxyId);
 }
 
 bool b3BroadPhase::MoveProxy(i32 proxyId, const b3AABB3& aabb, const b3Vec3& displacement)
 {
-	if (m_tree.GetAABB(proxyId).Contains(aabb))
+	if (GetAABB(proxyId).Contains(aabb))
 	{
 		// Do nothing if the new AABB is contained in the old AABB.
 		return false;
@@ -124,7 +188,14 @@ bool b3BroadPhase::MoveProxy(i32 proxyId, const b3AABB3& aabb, const b3Vec3& dis
 	}
 
 	// Update proxy with the extented AABB.
-	m_tree.UpdateNode(proxyId, fatAABB);
+	if (m_type == e_sweepAndPruneBroadPhase)
+	{
+		m_sap.UpdateProxy(proxyId, fatAABB);
+	}
+	else
+	{
+		m_tree.UpdateNode(proxyId, fatAABB);
+	}
 	
 	// Buffer the moved proxy.
 	BufferMove(proxyId);
@@ -133,31 +204,233 @@ bool b3BroadPhase::MoveProxy(i32 proxyId, const b3AABB3& aabb, const b3Vec3& dis
 	return true;
 }
 
-bool b3BroadPhase::Report(i32 proxyId) 
+// The number of moved proxies queried per task.
+const u32 b3_moveGrainSize = 64;
+
+// The number of sorted proxies swept per task.
+const u32 b3_sweepGrainSize = 256;
+
+// Tree query and sweep callback. 
+// Adds the overlapping pairs of a proxy to a pair buffer.
+struct b3PairQuery
 {
-	if (proxyId == m_queryProxyId) 
+	bool Report(i32 proxyId)
 	{
-		// The proxy can't overlap with itself.
+		if (proxyId == queryProxyId) 
+		{
+			// The proxy can't overlap with itself.
+			return true;
+		}
+
+		ReportPair(proxyId, queryProxyId);
+
+		// Keep looking for overlapping pairs.
 		return true;
 	}
 
-	// Check capacity.
-	if (m_pairCount == m_pairCapacity) 
+	void ReportPair(i32 proxy1, i32 proxy2)
 	{
-		// Duplicate capacity.
-		m_pairCapacity *= 2;
-		
-		b3Pair* oldPairs = m_pairs;
-		m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
-		memcpy(m_pairs, oldPairs, m_pairCount * sizeof(b3Pair));
-		b3Free(oldPairs);
+		// Check capacity.
+		if (buffer->count == buffer->capacity) 
+		{
+			// Duplicate capacity.
+			buffer->capacity = b3Max(2 * buffer->capacity, 16u);
+			
+			b3Pair* oldPairs = buffer->pairs;
+			buffer->pairs = (b3Pair*)b3Alloc(buffer->capacity * sizeof(b3Pair));
+			if (oldPairs)
+			{
+				memcpy(buffer->pairs, oldPairs, buffer->count * sizeof(b3Pair));
+				b3Free(oldPairs);
+			}
+		}
+
+		// Add overlapping pair to the pair buffer.
+		b3Pair* pair = buffer->pairs + buffer->count;
+		pair->proxy1 = b3Min(proxy1, proxy2);
+		pair->proxy2 = b3Max(proxy1, proxy2);
+		++buffer->count;
 	}
 
-	// Add overlapping pair to the pair buffer.
-	m_pairs[m_pairCount].proxy1 = b3Min(proxyId, m_queryProxyId);
-	m_pairs[m_pairCount].proxy2 = b3Max(proxyId, m_queryProxyId);
-	++m_pairCount;
+	i32 queryProxyId;
+	b3PairBuffer* buffer;
+};
 
-	// Keep looking for overlapping pairs.
-	return true;
+// Queries a range of moved proxies or sweeps a range of 
+// sorted proxies on a thread.
+struct b3FindPairsTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		// Each thread has its own pair buffer.
+		b3PairQuery query;
+		query.buffer = broadPhase->m_threadPairs + threadIndex;
+
+		if (broadPhase->m_type == e_sweepAndPruneBroadPhase)
+		{
+			broadPhase->m_sap.QueryPairs(&query, begin, end);
+			return;
+		}
+
+		const b3DynamicTree* tree = &broadPhase->m_tree;
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			// Keep the current queried proxy ID to avoid self overlapping.
+			query.queryProxyId = broadPhase->m_moveBuffer[i];
+			if (query.queryProxyId == NULL_NODE) 
+			{
+				continue;
+			}
+
+			const b3AABB3& aabb = tree->GetAABB(query.queryProxyId);
+			tree->QueryAABB(&query, aabb);
+		}
+	}
+
+	b3BroadPhase* broadPhase;
+};
+
+// Get a radix sort digit of a pair.
+// The pairs are sorted by proxy 1 and then by proxy 2.
+static inline u32 b3GetDigit(const b3Pair& pair, u32 pass)
+{
+	u32 key = pass < 4 ? u32(pair.proxy2) : u32(pair.proxy1);
+	return (key >> (8 * (pass % 4))) & 0xFF;
 }
+
+// Sort pairs with a least significant digit radix sort.
+static void b3SortPairs(b3Pair* pairs, b3Pair* temp, u32 count)
+{
+	b3Pair* src = pairs;
+	b3Pair* dst = temp;
+
+	for (u32 pass = 0; pass < 8; ++pass)
+	{
+		u32 offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			++offsets[b3GetDigit(src[i], pass)];
+		}
+
+		// Skip the pass if all the pairs have the same digit.
+		if (offsets[b3GetDigit(src[0], pass)] == count)
+		{
+			continue;
+		}
+
+		u32 offset = 0;
+		for (u32 i = 0; i < 256; ++i)
+		{
+			u32 digitCount = offsets[i];
+			offsets[i] = offset;
+			offset += digitCount;
+		}
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			dst[offsets[b3GetDigit(src[i], pass)]++] = src[i];
+		}
+
+		b3Swap(src, dst);
+	}
+
+	if (src != pairs)
+	{
+		memcpy(pairs, src, count * sizeof(b3Pair));
+	}
+}
+
+void b3BroadPhase::FindPairs(b3ThreadPool* threadPool)
+{
+	// Get the (duplicated) overlapping pairs of the moved proxies.
+	b3FindPairsTask task;
+	task.broadPhase = this;
+
+	u32 taskCount = m_moveBufferCount;
+	u32 grainSize = b3_moveGrainSize;
+
+	if (m_type == e_sweepAndPruneBroadPhase)
+	{
+		// Sweep all proxies but only keep the pairs of the moved proxies.
+		for (u32 i = 0; i < m_moveBufferCount; ++i)
+		{
+			if (m_moveBuffer[i] != NULL_NODE)
+			{
+				m_sap.SetMoved(m_moveBuffer[i]);
+			}
+		}
+
+		m_sap.Sort();
+
+		taskCount = m_moveBufferCount > 0 ? m_sap.GetSortedCount() : 0;
+		grainSize = b3_sweepGrainSize;
+	}
+
+	u32 threadCount = 1;
+	if (threadPool)
+	{
+		threadCount = threadPool->GetThreadCount();
+		threadPool->ParallelFor(&task, taskCount, grainSize);
+	}
+	else
+	{
+		task.Execute(0, taskCount, 0);
+	}
+
+	// Reset the move buffer for the next step.
+	m_moveBufferCount = 0;
+
+	// Merge the pair buffers.
+	u32 pairCount = 0;
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		pairCount += m_threadPairs[i].count;
+	}
+
+	if (pairCount > m_pairCapacity)
+	{
+		// The buffers are kept for the next steps.
+		m_pairCapacity = b3Max(pairCount, 2 * m_pairCapacity);
+
+		b3Free(m_pairs);
+		b3Free(m_sortPairs);
+		m_pairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
+		m_sortPairs = (b3Pair*)b3Alloc(m_pairCapacity * sizeof(b3Pair));
+	}
+
+	m_pairCount = 0;
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		b3PairBuffer* buffer = m_threadPairs + i;
+		if (buffer->count > 0)
+		{
+			memcpy(m_pairs + m_pairCount, buffer->pairs, buffer->count * sizeof(b3Pair));
+			m_pairCount += buffer->count;
+			buffer->count = 0;
+		}
+	}
+
+	if (m_pairCount == 0)
+	{
+		return;
+	}
+
+	// Sort the (duplicated) overlapping pair buffer to prune duplicated pairs.
+	b3SortPairs(m_pairs, m_sortPairs, m_pairCount);
+
+	// Skip duplicated overlapping pairs.
+	u32 uniqueCount = 1;
+	for (u32 i = 1; i < m_pairCount; ++i)
+	{
+		const b3Pair* primaryPair = m_pairs + uniqueCount - 1;
+		const b3Pair* pair = m_pairs + i;
+		if (pair->proxy1 != primaryPair->proxy1 || pair->proxy2 != primaryPair->proxy2)
+		{
+			m_pairs[uniqueCount++] = *pair;
+		}
+	}
+	m_pairCount = uniqueCount;
+}
\ No newline at end of file
@@ -18,13 +18,15 @@
 
 #include <bounce/collision/gjk/gjk.h>
 #include <bounce/collision/gjk/gjk_proxy.h>
+#include <bounce/common/thread/atomic.h>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 // Implementation of the GJK (Gilbert-Johnson-Keerthi) algorithm 
 // using Voronoi regions and Barycentric coordinates.
 
-u32 b3_gjkCalls = 0, b3_gjkIters = 0, b3_gjkMaxIters = 0;
+// The narrow-phase may run on many threads.
+b3Counter b3_gjkCalls(0), b3_gjkIters(0), b3_gjkMaxIters(0);
 
 // Convert a point Q from Cartesian coordinates to Barycentric coordinates (u, v) 
 // with respect to a segment AB.
@@ -580,7 +582,7 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 	const b3Transform& xf2, const b3GJKProxy& proxy2,
 	bool applyRadius, b3SimplexCache* cache)
 {
-	++b3_gjkCalls;
+	b3Increment(b3_gjkCalls);
 
 	// Initialize the simplex.
 	b3Simplex simplex;
@@ -670,7 +672,6 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 
 		// Iteration count is equated to the number of support point calls.
 		++iter;
-		++b3_gjkIters;
 
 		// Check for duplicate support points. 
 		// This is the main termination criteria.
@@ -694,7 +695,8 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 		++simplex.m_count;
 	}
 
-	b3_gjkMaxIters = b3Max(b3_gjkMaxIters, iter);
+	b3Increment(b3_gjkIters, iter);
+	b3RaiseTo(b3_gjkMaxIters, iter);
 
 	// Prepare result.
 	b3GJKOutput output;
@@ -737,7 +739,7 @@ b3GJKOutput b3GJK(const b3Transform& xf1, const b3GJKProxy& proxy1,
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-u32 b3_gjkCacheHits = 0;
+b3Counter b3_gjkCacheHits(0);
 
 // Implements b3Simplex routines for a cached simplex.
 void b3Simplex::ReadCache(const b3SimplexCache* cache,
@@ -773,7 +775,7 @@ void b3Simplex::ReadCache(const b3SimplexCache* cache,
 		}
 		else
 		{
-			++b3_gjkCacheHits;
+			b3Increment(b3_gjkCacheHits);
 		}
 	}
 
@@ -799,8 +801,8 @@ void b3Simplex::WriteCache(b3SimplexCache* cache) const
 	cache->count = u16(m_count);
 	for (u32 i = 0; i < m_count; ++i)
 	{
-		cache->index1[i] = u8(m_vertices[i].index1);
-		cache->index2[i] = u8(m_vertices[i].index2);
+		cache->index1[i] = u16(m_vertices[i].index1);
+		cache->index2[i] = u16(m_vertices[i].index2);
 	}
 }
 
@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/gjk/gjk.h>
+#include <bounce/collision/gjk/gjk_proxy.h>
+
+// The maximum number of advancement iterations of a shape cast.
+const u32 b3_maxShapeCastIterations = 32;
+
+// The proxies stop advancing when the distance between them 
+// is within this tolerance.
+const float32 b3_shapeCastTolerance = 0.5f * B3_LINEAR_SLOP;
+
+// The distance that each advancement tries to reach. 
+// It is less than the tolerance so the iterations converge.
+const float32 b3_shapeCastTarget = 0.25f * B3_LINEAR_SLOP;
+
+bool b3GJKShapeCast(b3GJKShapeCastOutput* output,
+	const b3Transform& xf1, const b3GJKProxy& proxy1,
+	const b3Transform& xf2, const b3GJKProxy& proxy2,
+	const b3Vec3& translation2, float32 maxFraction)
+{
+	float32 totalRadius = proxy1.m_radius + proxy2.m_radius;
+
+	b3SimplexCache cache;
+	cache.count = 0;
+
+	b3Transform xf = xf2;
+	
+	float32 t = 0.0f;
+	u32 iteration = 0;
+	while (iteration < b3_maxShapeCastIterations)
+	{
+		++iteration;
+
+		xf.position = xf2.position + t * translation2;
+
+		// Compute the distance between the cores.
+		b3GJKOutput query = b3GJK(xf1, proxy1, xf, proxy2, false, &cache);
+
+		if (query.distance < B3_EPSILON)
+		{
+			// The cores are overlapping. 
+			// This only happens if the proxies overlap initially.
+			b3Vec3 normal = -translation2;
+			float32 length = b3Length(normal);
+			if (length > B3_EPSILON)
+			{
+				normal /= length;
+			}
+
+			output->t = t;
+			output->point = query.point1;
+			output->normal = normal;
+			output->iterations = iteration;
+			return true;
+		}
+
+		b3Vec3 normal = (query.point2 - query.point1) / query.distance;
+		float32 distance = query.distance - totalRadius;
+
+		if (distance <= b3_shapeCastTolerance)
+		{
+			output->t = t;
+			output->point = query.point1 + proxy1.m_radius * normal;
+			output->normal = normal;
+			output->iterations = iteration;
+			return true;
+		}
+
+		// The distance along a linear translation is convex, so the proxies 
+		// never touch if they aren't approaching each other.
+		float32 speed = -b3Dot(normal, translation2);
+		if (speed <= 0.0f)
+		{
+			return false;
+		}
+
+		// Advance to the time the target distance would be reached if 
+		// the closest points kept approaching at the current speed.
+		// By convexity the proxies are still separated at that time.
+		t += (distance - b3_shapeCastTarget) / speed;
+
+		if (t > maxFraction)
+		{
+			return false;
+		}
+	}
+
+	// The iterations didn't converge. Report a conservative hit.
+	xf.position = xf2.position + t * translation2;
+	b3GJKOutput query = b3GJK(xf1, proxy1, xf, proxy2, false, &cache);
+	
+	b3Vec3 normal = -translation2;
+	if (query.distance > B3_EPSILON)
+	{
+		normal = (query.point2 - query.point1) / query.distance;
+	}
+	else
+	{
+		float32 length = b3Length(normal);
+		if (length > B3_EPSILON)
+		{
+			normal /= length;
+		}
+	}
+
+	output->t = t;
+	output->point = query.point1 + proxy1.m_radius * normal;
+	output->normal = normal;
+	output->iterations = iteration;
+	return true;
+}
\ No newline at end of file
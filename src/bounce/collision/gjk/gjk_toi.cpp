@@ -0,0 +1,169 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/gjk/gjk.h>
+#include <bounce/collision/gjk/gjk_proxy.h>
+
+// The maximum number of advancement iterations of a time of impact query.
+const u32 b3_maxTOIIterations = 32;
+
+// The proxies stop advancing when the distance between their cores 
+// is within this tolerance of the target distance.
+const float32 b3_toiTolerance = 0.25f * B3_LINEAR_SLOP;
+
+// Compute the maximum distance of the proxy vertices to the sweep center.
+static float32 b3ComputeSweepRadius(const b3Sweep& sweep, const b3GJKProxy& proxy)
+{
+	float32 maxDistanceSquared = 0.0f;
+	for (u32 i = 0; i < proxy.m_count; ++i)
+	{
+		float32 distanceSquared = b3LengthSquared(proxy.m_vertices[i] - sweep.localCenter);
+		maxDistanceSquared = b3Max(maxDistanceSquared, distanceSquared);
+	}
+	return b3Sqrt(maxDistanceSquared);
+}
+
+// Compute the maximum angular speed of a sweep. 
+// The orientations are linearly interpolated and normalized, so the 
+// rotation axis is fixed but the rotation is the fastest at the middle of the sweep.
+// If the half angle between the orientations is a then the maximum speed is 4 * tan(a / 2).
+static float32 b3ComputeMaxAngularSpeed(const b3Sweep& sweep)
+{
+	float32 cosine = b3Min(b3Abs(b3Dot(sweep.orientation0, sweep.orientation)), 1.0f);
+	float32 sine = b3Sqrt(1.0f - cosine * cosine);
+	return 4.0f * sine / (1.0f + cosine);
+}
+
+bool b3GJKTimeOfImpact(b3GJKTOIOutput* output,
+	const b3Sweep& sweep1, const b3GJKProxy& proxy1,
+	const b3Sweep& sweep2, const b3GJKProxy& proxy2, float32 tMax)
+{
+	float32 totalRadius = proxy1.m_radius + proxy2.m_radius;
+
+	// The proxies should overlap by a few slops at the time of impact.
+	float32 target = totalRadius - 3.0f * B3_LINEAR_SLOP;
+
+	// The GJK doesn't measure the distance of overlapping cores, so the cores 
+	// are advanced until they are close and then moved to the target.
+	float32 coreTarget = b3Max(target, B3_LINEAR_SLOP);
+
+	// The points of the proxies can't move faster than their centers 
+	// plus their rotation about the centers.
+	b3Vec3 d1 = sweep1.worldCenter - sweep1.worldCenter0;
+	b3Vec3 d2 = sweep2.worldCenter - sweep2.worldCenter0;
+
+	float32 angularBound = 0.0f;
+	angularBound += b3ComputeMaxAngularSpeed(sweep1) * b3ComputeSweepRadius(sweep1, proxy1);
+	angularBound += b3ComputeMaxAngularSpeed(sweep2) * b3ComputeSweepRadius(sweep2, proxy2);
+
+	b3SimplexCache cache;
+	cache.count = 0;
+
+	float32 t = 0.0f;
+	u32 iteration = 0;
+	while (iteration < b3_maxTOIIterations)
+	{
+		++iteration;
+
+		b3Transform xf1 = sweep1.GetTransform(t);
+		b3Transform xf2 = sweep2.GetTransform(t);
+
+		// Compute the distance between the cores.
+		b3GJKOutput query = b3GJK(xf1, proxy1, xf2, proxy2, false, &cache);
+
+		if (query.distance < B3_EPSILON)
+		{
+			if (iteration == 1)
+			{
+				// The cores are overlapping initially. 
+				// This is left to the discrete collision.
+				return false;
+			}
+
+			// The advancement can't overshoot, so this only 
+			// happens due to numerical errors.
+			output->t = t;
+			output->iterations = iteration;
+			return true;
+		}
+
+		b3Vec3 normal = (query.point2 - query.point1) / query.distance;
+
+		// Bound the speed at which the proxies approach along the normal.
+		float32 speed = b3Dot(normal, d1 - d2) + angularBound;
+
+		if (query.distance <= coreTarget + b3_toiTolerance)
+		{
+			if (query.distance < target && iteration == 1)
+			{
+				// The proxies are overlapping more than the target initially. 
+				// This is left to the discrete collision.
+				return false;
+			}
+
+			if (speed > 0.0f && query.distance > target)
+			{
+				// Move the proxies to the target distance. 
+				// The speed bound is too conservative for rotating proxies, therefore 
+				// the step is scaled by the actual approach of the closest points.
+				float32 dt = (query.distance - target) / speed;
+				
+				b3Vec3 localPoint1 = b3MulT(xf1, query.point1);
+				b3Vec3 localPoint2 = b3MulT(xf2, query.point2);
+
+				b3Transform xf3 = sweep1.GetTransform(t + dt);
+				b3Transform xf4 = sweep2.GetTransform(t + dt);
+
+				b3Vec3 displacement1 = b3Mul(xf3, localPoint1) - query.point1;
+				b3Vec3 displacement2 = b3Mul(xf4, localPoint2) - query.point2;
+
+				float32 approach = b3Dot(normal, displacement1 - displacement2);
+				if (approach > B3_EPSILON)
+				{
+					dt *= b3Max((query.distance - target) / approach, 1.0f);
+				}
+
+				t += dt;
+			}
+
+			output->t = b3Min(t, tMax);
+			output->iterations = iteration;
+			return true;
+		}
+
+		// The proxies never touch if they aren't approaching each other.
+		if (speed <= 0.0f)
+		{
+			return false;
+		}
+
+		// Advance to the time the core target would be reached at the maximum speed. 
+		// The proxies are still separated at that time.
+		t += (query.distance - coreTarget) / speed;
+
+		if (t >= tMax)
+		{
+			return false;
+		}
+	}
+
+	// The iterations didn't converge. Report a conservative time.
+	output->t = t;
+	output->iterations = iteration;
+	return true;
+}
\ No newline at end of file
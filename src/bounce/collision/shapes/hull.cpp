@@ -20,6 +20,10 @@
 
 void b3Hull::Validate() const 
 {
+	B3_ASSERT(vertexCount <= B3_MAX_HULL_FEATURES);
+	B3_ASSERT(edgeCount <= B3_MAX_HULL_FEATURES);
+	B3_ASSERT(faceCount <= B3_MAX_HULL_FEATURES);
+
 	for (u32 i = 0; i < faceCount; ++i) 
 	{
 		Validate(faces + i);
@@ -60,7 +64,7 @@ void b3Hull::Validate(const b3Face* face) const
 
 void b3Hull::Validate(const b3HalfEdge* e) const 
 {
-	u8 edgeIndex = (u8)(e - edges);
+	u32 edgeIndex = u32(e - edges);
 	
 	const b3HalfEdge* twin = edges + e->twin;
 
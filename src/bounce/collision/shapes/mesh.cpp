@@ -0,0 +1,153 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/shapes/mesh.h>
+
+// Identifies a binary image of a mesh.
+const u32 b3_meshBlobMagic = 0x484D3342; // "B3MH"
+
+// Increment this when the image layout changes.
+const u32 b3_meshBlobVersion = 1;
+
+// The header of a binary image of a mesh.
+// The arrays follow the header at the given offsets from the image start.
+struct b3MeshBlob
+{
+	u32 magic;
+	u32 version;
+	u32 size;
+	u32 vertexCount;
+	u32 triangleCount;
+	u32 vertexOffset;
+	u32 triangleOffset;
+	u32 treeOffset;
+};
+
+// Round up a size to keep the arrays of a binary image aligned.
+static inline u32 b3AlignBlobSize(u32 size)
+{
+	return (size + 15) & ~15;
+}
+
+u32 b3Mesh::GetBlobSize() const
+{
+	u32 size = b3AlignBlobSize(sizeof(b3MeshBlob));
+	size += b3AlignBlobSize(vertexCount * sizeof(b3Vec3));
+	size += b3AlignBlobSize(triangleCount * sizeof(b3Triangle));
+	size += tree.GetBlobSize();
+	return size;
+}
+
+void b3Mesh::WriteBlob(void* blob) const
+{
+	B3_ASSERT((size_t(blob) & 15) == 0);
+
+	b3MeshBlob header;
+	header.magic = b3_meshBlobMagic;
+	header.version = b3_meshBlobVersion;
+	header.size = GetBlobSize();
+	header.vertexCount = vertexCount;
+	header.triangleCount = triangleCount;
+	header.vertexOffset = b3AlignBlobSize(sizeof(b3MeshBlob));
+	header.triangleOffset = header.vertexOffset + b3AlignBlobSize(vertexCount * sizeof(b3Vec3));
+	header.treeOffset = header.triangleOffset + b3AlignBlobSize(triangleCount * sizeof(b3Triangle));
+
+	u8* bytes = (u8*)blob;
+	memset(bytes, 0, header.treeOffset);
+	memcpy(bytes, &header, sizeof(b3MeshBlob));
+	memcpy(bytes + header.vertexOffset, vertices, vertexCount * sizeof(b3Vec3));
+	memcpy(bytes + header.triangleOffset, triangles, triangleCount * sizeof(b3Triangle));
+	tree.WriteBlob(bytes + header.treeOffset);
+}
+
+bool b3Mesh::ReadBlob(const void* blob, u32 size)
+{
+	if ((size_t(blob) & 15) != 0 || size < sizeof(b3MeshBlob))
+	{
+		return false;
+	}
+
+	const u8* bytes = (const u8*)blob;
+
+	b3MeshBlob header;
+	memcpy(&header, bytes, sizeof(b3MeshBlob));
+
+	if (header.magic != b3_meshBlobMagic || header.version != b3_meshBlobVersion || header.size > size)
+	{
+		return false;
+	}
+
+	// Check that the arrays are inside the image.
+	u64 vertexEnd = u64(header.vertexOffset) + u64(sizeof(b3Vec3)) * header.vertexCount;
+	u64 triangleEnd = u64(header.triangleOffset) + u64(sizeof(b3Triangle)) * header.triangleCount;
+	if (vertexEnd > header.size || triangleEnd > header.size || header.treeOffset > header.size)
+	{
+		return false;
+	}
+
+	if ((header.vertexOffset & 15) != 0 || (header.triangleOffset & 15) != 0 || (header.treeOffset & 15) != 0)
+	{
+		return false;
+	}
+
+	// Check that the triangles index the vertices.
+	const b3Triangle* imageTriangles = (const b3Triangle*)(bytes + header.triangleOffset);
+	for (u32 i = 0; i < header.triangleCount; ++i)
+	{
+		const b3Triangle* triangle = imageTriangles + i;
+		if (triangle->v1 >= header.vertexCount || triangle->v2 >= header.vertexCount || triangle->v3 >= header.vertexCount)
+		{
+			return false;
+		}
+	}
+
+	// Check that the tree proxies are the triangles before replacing the tree.
+	const u8* treeBytes = bytes + header.treeOffset;
+	u32 treeSize = header.size - header.treeOffset;
+	
+	b3StaticTree imageTree;
+	if (imageTree.ReadBlob(treeBytes, treeSize) == false)
+	{
+		return false;
+	}
+
+	if (imageTree.GetProxyCount() != header.triangleCount)
+	{
+		return false;
+	}
+
+	for (u32 i = 0; i < header.triangleCount; ++i)
+	{
+		if (imageTree.GetUserData(i) >= header.triangleCount)
+		{
+			return false;
+		}
+	}
+
+	bool treeRead = tree.ReadBlob(treeBytes, treeSize);
+	B3_ASSERT(treeRead);
+	B3_NOT_USED(treeRead);
+
+	// The image is never written.
+	vertexCount = header.vertexCount;
+	vertices = (b3Vec3*)(bytes + header.vertexOffset);
+	triangleCount = header.triangleCount;
+	triangles = (b3Triangle*)(bytes + header.triangleOffset);
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/collision/sweep_and_prune.h>
+#include <bounce/common/sort.h>
+
+b3SweepAndPrune::b3SweepAndPrune()
+{
+	// Preallocate 32 proxies.
+	m_proxyCapacity = 32;
+	m_proxies = (b3Proxy*)b3Alloc(m_proxyCapacity * sizeof(b3Proxy));
+	m_proxyCount = 0;
+
+	// Link the allocated proxies and make the first proxy 
+	// available the the next allocation.
+	AddToFreeList(0);
+
+	m_sorted = false;
+
+	m_lowerX = NULL;
+	m_upperX = NULL;
+	m_lowerY = NULL;
+	m_upperY = NULL;
+	m_lowerZ = NULL;
+	m_upperZ = NULL;
+	m_sortedProxies = NULL;
+	m_sortedMoved = NULL;
+	m_sortKeys = NULL;
+	m_sortedCount = 0;
+	m_sortedCapacity = 0;
+}
+
+b3SweepAndPrune::~b3SweepAndPrune()
+{
+	if (m_sortedCapacity > 0)
+	{
+		b3Free(m_lowerX);
+		b3Free(m_upperX);
+		b3Free(m_lowerY);
+		b3Free(m_upperY);
+		b3Free(m_lowerZ);
+		b3Free(m_upperZ);
+		b3Free(m_sortedProxies);
+		b3Free(m_sortedMoved);
+		b3Free(m_sortKeys);
+	}
+	b3Free(m_proxies);
+}
+
+void b3SweepAndPrune::AddToFreeList(i32 proxy)
+{
+	// Starting from the given proxy, relink the linked list of proxies.
+	// The free proxies are cleared.
+	for (i32 i = proxy; i < m_proxyCapacity; ++i)
+	{
+		b3Proxy* p = m_proxies + i;
+		p->aabb.m_lower.SetZero();
+		p->aabb.m_upper.SetZero();
+		p->userData = NULL;
+		p->next = i + 1;
+		p->allocated = false;
+		p->moved = false;
+	}
+
+	m_proxies[m_proxyCapacity - 1].next = NULL_NODE;
+
+	// Make the proxy available for the next allocation.
+	m_freeList = proxy;
+}
+
+i32 b3SweepAndPrune::InsertProxy(const b3AABB3& aabb, void* userData)
+{
+	if (m_freeList == NULL_NODE)
+	{
+		B3_ASSERT(m_proxyCount == m_proxyCapacity);
+
+		// Duplicate capacity.
+		m_proxyCapacity *= 2;
+
+		b3Proxy* oldProxies = m_proxies;
+		m_proxies = (b3Proxy*)b3Alloc(m_proxyCapacity * sizeof(b3Proxy));
+		memcpy(m_proxies, oldProxies, m_proxyCount * sizeof(b3Proxy));
+		b3Free(oldProxies);
+
+		// Make the new proxies available for the next allocation.
+		AddToFreeList(m_proxyCount);
+	}
+
+	// Grab the free proxy.
+	i32 proxyId = m_freeList;
+	b3Proxy* proxy = m_proxies + proxyId;
+	m_freeList = proxy->next;
+
+	proxy->aabb = aabb;
+	proxy->userData = userData;
+	proxy->next = NULL_NODE;
+	proxy->allocated = true;
+	proxy->moved = false;
+
+	++m_proxyCount;
+
+	m_sorted = false;
+
+	return proxyId;
+}
+
+void b3SweepAndPrune::RemoveProxy(i32 proxyId)
+{
+	B3_ASSERT(proxyId != NULL_NODE && proxyId < m_proxyCapacity);
+	B3_ASSERT(m_proxies[proxyId].allocated);
+
+	b3Proxy* proxy = m_proxies + proxyId;
+	proxy->next = m_freeList;
+	proxy->allocated = false;
+	proxy->moved = false;
+	m_freeList = proxyId;
+	--m_proxyCount;
+
+	m_sorted = false;
+}
+
+void b3SweepAndPrune::UpdateProxy(i32 proxyId, const b3AABB3& aabb)
+{
+	B3_ASSERT(proxyId != NULL_NODE && proxyId < m_proxyCapacity);
+	B3_ASSERT(m_proxies[proxyId].allocated);
+
+	m_proxies[proxyId].aabb = aabb;
+
+	m_sorted = false;
+}
+
+void b3SweepAndPrune::Sort()
+{
+	u32 count = u32(m_proxyCount);
+	
+	// Check capacity.
+	if (count + B3_SIMD_WIDTH > m_sortedCapacity)
+	{
+		if (m_sortedCapacity > 0)
+		{
+			b3Free(m_lowerX);
+			b3Free(m_upperX);
+			b3Free(m_lowerY);
+			b3Free(m_upperY);
+			b3Free(m_lowerZ);
+			b3Free(m_upperZ);
+			b3Free(m_sortedProxies);
+			b3Free(m_sortedMoved);
+			b3Free(m_sortKeys);
+		}
+
+		// The arrays are kept for the next sorts.
+		m_sortedCapacity = b3Max(count + B3_SIMD_WIDTH, 2 * m_sortedCapacity);
+
+		m_lowerX = (float32*)b3Alloc(m_sortedCapacity * sizeof(float32));
+		m_upperX = (float32*)b3Alloc(m_sortedCapacity * sizeof(float32));
+		m_lowerY = (float32*)b3Alloc(m_sortedCapacity * sizeof(float32));
+		m_upperY = (float32*)b3Alloc(m_sortedCapacity * sizeof(float32));
+		m_lowerZ = (float32*)b3Alloc(m_sortedCapacity * sizeof(float32));
+		m_upperZ = (float32*)b3Alloc(m_sortedCapacity * sizeof(float32));
+		m_sortedProxies = (i32*)b3Alloc(m_sortedCapacity * sizeof(i32));
+		m_sortedMoved = (bool*)b3Alloc(m_sortedCapacity * sizeof(bool));
+		m_sortKeys = (u64*)b3Alloc(2 * m_sortedCapacity * sizeof(u64));
+	}
+
+	// Sort the proxies by the lower bound on the x axis.
+	// The proxy ID is stored in the lower bits of a key,
+	// so proxies with the same bound stay sorted by ID.
+	u64* keys = m_sortKeys;
+	u64* temp = m_sortKeys + m_sortedCapacity;
+
+	u32 keyCount = 0;
+	for (i32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		const b3Proxy* proxy = m_proxies + i;
+		if (proxy->allocated)
+		{
+			keys[keyCount++] = (u64(b3GetSortKey(proxy->aabb.m_lower.x)) << 32) | u64(i);
+		}
+	}
+
+	B3_ASSERT(keyCount == count);
+
+	b3SortKeys(keys, temp, count);
+
+	// Gather the sorted AABBs and capture the moved flags.
+	for (u32 i = 0; i < count; ++i)
+	{
+		i32 proxyId = i32(keys[i] & 0xFFFFFFFF);
+		b3Proxy* proxy = m_proxies + proxyId;
+
+		m_lowerX[i] = proxy->aabb.m_lower.x;
+		m_upperX[i] = proxy->aabb.m_upper.x;
+		m_lowerY[i] = proxy->aabb.m_lower.y;
+		m_upperY[i] = proxy->aabb.m_upper.y;
+		m_lowerZ[i] = proxy->aabb.m_lower.z;
+		m_upperZ[i] = proxy->aabb.m_upper.z;
+		m_sortedProxies[i] = proxyId;
+		m_sortedMoved[i] = proxy->moved;
+
+		proxy->moved = false;
+	}
+
+	// Pad with empty AABBs.
+	for (u32 i = count; i < count + B3_SIMD_WIDTH; ++i)
+	{
+		m_lowerX[i] = B3_MAX_FLOAT;
+		m_upperX[i] = -B3_MAX_FLOAT;
+		m_lowerY[i] = B3_MAX_FLOAT;
+		m_upperY[i] = -B3_MAX_FLOAT;
+		m_lowerZ[i] = B3_MAX_FLOAT;
+		m_upperZ[i] = -B3_MAX_FLOAT;
+		m_sortedProxies[i] = NULL_NODE;
+		m_sortedMoved[i] = false;
+	}
+
+	m_sortedCount = count;
+	m_sorted = true;
+}
+
+void b3SweepAndPrune::Draw(b3Draw* draw) const
+{
+	for (i32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		const b3Proxy* proxy = m_proxies + i;
+		if (proxy->allocated)
+		{
+			draw->DrawAABB(proxy->aabb, b3Color_pink);
+		}
+	}
+}
\ No newline at end of file
@@ -17,6 +17,7 @@
 */
 
 #include <bounce/collision/trees/dynamic_tree.h>
+#include <bounce/common/sort.h>
 
 b3DynamicTree::b3DynamicTree() 
 {
@@ -306,7 +307,8 @@ void b3DynamicTree::WalkBackNodeAndCombineVolumes(i32 node)
 {
 	while (node != NULL_NODE) 
 	{
-		//@todo node = Balance(node);
+		// Keep the tree quality under insertions and removals.
+		Rotate(node);
 
 		i32 child1 = m_nodes[node].child1;
 		i32 child2 = m_nodes[node].child2;
@@ -321,6 +323,403 @@ void b3DynamicTree::WalkBackNodeAndCombineVolumes(i32 node)
 	}
 }
 
+void b3DynamicTree::Rotate(i32 iA)
+{
+	b3Node* A = m_nodes + iA;
+
+	i32 iB = A->child1;
+	i32 iC = A->child2;
+	
+	b3Node* B = m_nodes + iB;
+	b3Node* C = m_nodes + iC;
+
+	// Find the child and grandchild swap that reduces the area the most.
+	// The area of the node doesn't change.
+	float32 bestReduction = 0.0f;
+	i32 bestChild = NULL_NODE;
+	i32 bestGrandChild = NULL_NODE;
+
+	if (C->IsLeaf() == false)
+	{
+		float32 area = C->aabb.SurfaceArea();
+
+		i32 iF = C->child1;
+		i32 iG = C->child2;
+
+		// Swap B and F.
+		float32 reductionBF = area - b3Combine(B->aabb, m_nodes[iG].aabb).SurfaceArea();
+		if (reductionBF > bestReduction)
+		{
+			bestReduction = reductionBF;
+			bestChild = iB;
+			bestGrandChild = iF;
+		}
+
+		// Swap B and G.
+		float32 reductionBG = area - b3Combine(B->aabb, m_nodes[iF].aabb).SurfaceArea();
+		if (reductionBG > bestReduction)
+		{
+			bestReduction = reductionBG;
+			bestChild = iB;
+			bestGrandChild = iG;
+		}
+	}
+
+	if (B->IsLeaf() == false)
+	{
+		float32 area = B->aabb.SurfaceArea();
+
+		i32 iD = B->child1;
+		i32 iE = B->child2;
+
+		// Swap C and D.
+		float32 reductionCD = area - b3Combine(C->aabb, m_nodes[iE].aabb).SurfaceArea();
+		if (reductionCD > bestReduction)
+		{
+			bestReduction = reductionCD;
+			bestChild = iC;
+			bestGrandChild = iD;
+		}
+
+		// Swap C and E.
+		float32 reductionCE = area - b3Combine(C->aabb, m_nodes[iD].aabb).SurfaceArea();
+		if (reductionCE > bestReduction)
+		{
+			bestReduction = reductionCE;
+			bestChild = iC;
+			bestGrandChild = iE;
+		}
+	}
+
+	if (bestChild == NULL_NODE)
+	{
+		// No rotation reduces the area.
+		return;
+	}
+
+	// The child moves down and the grandchild moves up.
+	i32 iP = m_nodes[bestGrandChild].parent;
+	b3Node* P = m_nodes + iP;
+
+	if (A->child1 == bestChild)
+	{
+		A->child1 = bestGrandChild;
+	}
+	else
+	{
+		A->child2 = bestGrandChild;
+	}
+
+	if (P->child1 == bestGrandChild)
+	{
+		P->child1 = bestChild;
+	}
+	else
+	{
+		P->child2 = bestChild;
+	}
+
+	m_nodes[bestGrandChild].parent = iA;
+	m_nodes[bestChild].parent = iP;
+
+	P->aabb = b3Combine(m_nodes[P->child1].aabb, m_nodes[P->child2].aabb);
+	P->height = 1 + b3Max(m_nodes[P->child1].height, m_nodes[P->child2].height);
+}
+
+u32 b3DynamicTree::GatherLeaves(i32* leaves)
+{
+	u32 leafCount = 0;
+	for (i32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		b3Node* node = m_nodes + i;
+		if (node->height < 0)
+		{
+			// Free node.
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			node->parent = NULL_NODE;
+			leaves[leafCount++] = i;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	m_root = NULL_NODE;
+	return leafCount;
+}
+
+// The number of bins used to find the best SAH split of a node.
+const u32 b3_sahBinCount = 16;
+
+i32 b3DynamicTree::BuildSAH(i32* leaves, u32 count)
+{
+	B3_ASSERT(count > 0);
+
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	// Compute the bounds of the leaf centers.
+	b3AABB3 centerAABB;
+	centerAABB.m_lower = centerAABB.m_upper = m_nodes[leaves[0]].aabb.Centroid();
+	for (u32 i = 1; i < count; ++i)
+	{
+		b3Vec3 center = m_nodes[leaves[i]].aabb.Centroid();
+		centerAABB.m_lower = b3Min(centerAABB.m_lower, center);
+		centerAABB.m_upper = b3Max(centerAABB.m_upper, center);
+	}
+
+	u32 axis = centerAABB.GetLongestAxisIndex();
+	float32 lower = centerAABB.m_lower[axis];
+	float32 extent = centerAABB.m_upper[axis] - lower;
+
+	// Split in half if the centers coincide.
+	u32 leftCount = count / 2;
+
+	if (extent > 0.0f)
+	{
+		// Bin the leaves by center.
+		u32 binCounts[b3_sahBinCount];
+		b3AABB3 binAABBs[b3_sahBinCount];
+		for (u32 i = 0; i < b3_sahBinCount; ++i)
+		{
+			binCounts[i] = 0;
+			binAABBs[i].m_lower.Set(B3_MAX_FLOAT, B3_MAX_FLOAT, B3_MAX_FLOAT);
+			binAABBs[i].m_upper.Set(-B3_MAX_FLOAT, -B3_MAX_FLOAT, -B3_MAX_FLOAT);
+		}
+
+		float32 binScale = float32(b3_sahBinCount) / extent;
+		for (u32 i = 0; i < count; ++i)
+		{
+			const b3AABB3& aabb = m_nodes[leaves[i]].aabb;
+			u32 bin = b3Min(u32(binScale * (aabb.Centroid()[axis] - lower)), b3_sahBinCount - 1);
+			++binCounts[bin];
+			binAABBs[bin] = b3Combine(binAABBs[bin], aabb);
+		}
+
+		// Compute the area of the right side of each split.
+		float32 rightAreas[b3_sahBinCount];
+		b3AABB3 rightAABB = binAABBs[b3_sahBinCount - 1];
+		for (u32 i = b3_sahBinCount - 1; i > 0; --i)
+		{
+			rightAABB = b3Combine(rightAABB, binAABBs[i]);
+			rightAreas[i] = rightAABB.SurfaceArea();
+		}
+
+		// Find the split with the minimum cost.
+		// The first and last bins aren't empty, so both sides aren't empty.
+		float32 bestCost = B3_MAX_FLOAT;
+		u32 bestBin = 0;
+		
+		b3AABB3 leftAABB = binAABBs[0];
+		u32 leftBinCount = 0;
+		for (u32 i = 0; i < b3_sahBinCount - 1; ++i)
+		{
+			leftAABB = b3Combine(leftAABB, binAABBs[i]);
+			leftBinCount += binCounts[i];
+
+			float32 cost = float32(leftBinCount) * leftAABB.SurfaceArea() + float32(count - leftBinCount) * rightAreas[i + 1];
+			if (leftBinCount > 0 && leftBinCount < count && cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		// Partition the leaves.
+		leftCount = 0;
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 bin = b3Min(u32(binScale * (m_nodes[leaves[i]].aabb.Centroid()[axis] - lower)), b3_sahBinCount - 1);
+			if (bin <= bestBin)
+			{
+				b3Swap(leaves[i], leaves[leftCount]);
+				++leftCount;
+			}
+		}
+	}
+
+	B3_ASSERT(0 < leftCount && leftCount < count);
+
+	i32 node = AllocateNode();
+	
+	i32 child1 = BuildSAH(leaves, leftCount);
+	i32 child2 = BuildSAH(leaves + leftCount, count - leftCount);
+
+	m_nodes[node].child1 = child1;
+	m_nodes[node].child2 = child2;
+	m_nodes[node].aabb = b3Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	m_nodes[node].height = 1 + b3Max(m_nodes[child1].height, m_nodes[child2].height);
+	m_nodes[child1].parent = node;
+	m_nodes[child2].parent = node;
+
+	return node;
+}
+
+void b3DynamicTree::RebuildSAH()
+{
+	if (m_root == NULL_NODE)
+	{
+		return;
+	}
+
+	i32* leaves = (i32*)b3Alloc(m_nodeCount * sizeof(i32));
+	u32 leafCount = GatherLeaves(leaves);
+
+	m_root = BuildSAH(leaves, leafCount);
+	m_nodes[m_root].parent = NULL_NODE;
+
+	b3Free(leaves);
+}
+
+// The number of nodes on each side of a node that are searched for a merge.
+const u32 b3_mergeRadius = 8;
+
+void b3DynamicTree::RebuildBottomUp()
+{
+	if (m_root == NULL_NODE)
+	{
+		return;
+	}
+
+	i32* leaves = (i32*)b3Alloc(m_nodeCount * sizeof(i32));
+	u32 count = GatherLeaves(leaves);
+
+	// Compute the bounds of the leaf centers.
+	b3AABB3 centerAABB;
+	centerAABB.m_lower = centerAABB.m_upper = m_nodes[leaves[0]].aabb.Centroid();
+	for (u32 i = 1; i < count; ++i)
+	{
+		b3Vec3 center = m_nodes[leaves[i]].aabb.Centroid();
+		centerAABB.m_lower = b3Min(centerAABB.m_lower, center);
+		centerAABB.m_upper = b3Max(centerAABB.m_upper, center);
+	}
+
+	b3Vec3 extent = centerAABB.m_upper - centerAABB.m_lower;
+	b3Vec3 scale;
+	scale.x = extent.x > 0.0f ? 1.0f / extent.x : 0.0f;
+	scale.y = extent.y > 0.0f ? 1.0f / extent.y : 0.0f;
+	scale.z = extent.z > 0.0f ? 1.0f / extent.z : 0.0f;
+
+	// Sort the leaves along a Morton curve so nearby leaves are nearby in the array.
+	u64* keys = (u64*)b3Alloc(2 * count * sizeof(u64));
+	for (u32 i = 0; i < count; ++i)
+	{
+		b3Vec3 p = m_nodes[leaves[i]].aabb.Centroid() - centerAABB.m_lower;
+		p.x *= scale.x;
+		p.y *= scale.y;
+		p.z *= scale.z;
+		keys[i] = (u64(b3GetMortonCode(p)) << 32) | u64(i);
+	}
+
+	b3SortKeys(keys, keys + count, count);
+
+	i32* nodes = (i32*)b3Alloc(count * sizeof(i32));
+	for (u32 i = 0; i < count; ++i)
+	{
+		nodes[i] = leaves[keys[i] & 0xFFFFFFFF];
+	}
+
+	b3Free(keys);
+
+	// The leaves buffer is reused for the best nodes.
+	u32* bestNodes = (u32*)leaves;
+
+	while (count > 1)
+	{
+		// Find the nearby node that gives the smallest combined area for each node.
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 begin = i > b3_mergeRadius ? i - b3_mergeRadius : 0;
+			u32 end = b3Min(i + b3_mergeRadius + 1, count);
+
+			const b3AABB3& aabb = m_nodes[nodes[i]].aabb;
+
+			float32 bestArea = B3_MAX_FLOAT;
+			u32 bestNode = i;
+			for (u32 j = begin; j < end; ++j)
+			{
+				if (j == i)
+				{
+					continue;
+				}
+
+				float32 area = b3Combine(aabb, m_nodes[nodes[j]].aabb).SurfaceArea();
+				if (area < bestArea)
+				{
+					bestArea = area;
+					bestNode = j;
+				}
+			}
+
+			bestNodes[i] = bestNode;
+		}
+
+		// Merge the nodes that are the best node of each other.
+		// At least the pair with the smallest area is merged.
+		u32 newCount = 0;
+		for (u32 i = 0; i < count; ++i)
+		{
+			u32 j = bestNodes[i];
+			if (bestNodes[j] != i)
+			{
+				// Keep the node for the next pass.
+				nodes[newCount++] = nodes[i];
+				continue;
+			}
+
+			if (j < i)
+			{
+				// The node was merged.
+				continue;
+			}
+
+			i32 child1 = nodes[i];
+			i32 child2 = nodes[j];
+
+			i32 node = AllocateNode();
+			m_nodes[node].child1 = child1;
+			m_nodes[node].child2 = child2;
+			m_nodes[node].aabb = b3Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+			m_nodes[node].height = 1 + b3Max(m_nodes[child1].height, m_nodes[child2].height);
+			m_nodes[child1].parent = node;
+			m_nodes[child2].parent = node;
+
+			nodes[newCount++] = node;
+		}
+
+		B3_ASSERT(newCount < count);
+		count = newCount;
+	}
+
+	m_root = nodes[0];
+	m_nodes[m_root].parent = NULL_NODE;
+
+	b3Free(nodes);
+	b3Free(leaves);
+}
+
+float32 b3DynamicTree::GetTotalArea() const
+{
+	float32 area = 0.0f;
+	for (i32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		const b3Node* node = m_nodes + i;
+		if (node->height > 0)
+		{
+			// Internal node.
+			area += node->aabb.SurfaceArea();
+		}
+	}
+	return area;
+}
+
 void b3DynamicTree::Validate(i32 nodeID) const 
 {
 	if (nodeID == NULL_NODE) 
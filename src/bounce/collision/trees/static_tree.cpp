@@ -18,164 +18,1106 @@
 
 #include <bounce/collision/trees/static_tree.h>
 #include <bounce/common/template/stack.h>
+#include <bounce/common/time.h>
 
 b3StaticTree::b3StaticTree()
 {
 	m_nodes = NULL;
+	m_quantizedNodes = NULL;
+	m_wideNodes = NULL;
 	m_nodeCount = 0;
+	m_aabbs = NULL;
+	m_ids = NULL;
+	m_proxyCount = 0;
+	memset(&m_stats, 0, sizeof(b3StaticTreeStats));
+	m_ownsMemory = true;
 }
 
 b3StaticTree::~b3StaticTree()
 {
-	b3Free(m_nodes);
+	Free();
 }
 
-static B3_FORCE_INLINE bool b3SortPredicate(const b3AABB3* set, u32 axis, u32 a, u32 b)
+void b3StaticTree::Free()
 {
-	b3Vec3 c1 = set[a].Centroid();
-	b3Vec3 c2 = set[b].Centroid();
+	if (m_ownsMemory)
+	{
+		b3Free(m_nodes);
+		b3Free(m_quantizedNodes);
+		b3Free(m_wideNodes);
+		b3Free(m_aabbs);
+		b3Free(m_ids);
+	}
 
-	return c1[axis] < c2[axis];
+	m_nodes = NULL;
+	m_quantizedNodes = NULL;
+	m_wideNodes = NULL;
+	m_aabbs = NULL;
+	m_ids = NULL;
+	m_nodeCount = 0;
+	m_proxyCount = 0;
+	m_ownsMemory = true;
 }
 
-static void b3Sort(const b3AABB3* set, u32 axis, u32* ids, u32 count)
+// The number of bins used to find the best split of a node.
+const u32 b3_staticTreeBinCount = 32;
+
+// The minimum number of proxies in a subtree that is built on a thread.
+const u32 b3_minSubtreeProxyCount = 1024;
+
+// The number of proxies whose centers are computed per task.
+const u32 b3_centerGrainSize = 4096;
+
+// The subtree index of an internal top node.
+const u32 b3_nullSubtree = 0xFFFFFFFF;
+
+// A node at the top of the tree, which is built before the subtrees.
+struct b3TopNode
+{
+	b3AABB3 aabb;
+	u32 child1;
+	u32 child2;
+	
+	// The index of the subtree or b3_nullSubtree if this is an internal node.
+	u32 subtree;
+};
+
+// A subtree built on a thread.
+struct b3Subtree
 {
-	if (count <= 1)
+	u32 begin;
+	u32 count;
+	u32 nodeCount;
+};
+
+// Builds the nodes of a static tree.
+// The tree top is split on the calling thread and the subtrees below 
+// a threshold are built in parallel. 
+// The nodes of each subtree are stitched in depth-first order, so the 
+// nodes are identical to the serial build.
+struct b3StaticTreeBuilder
+{
+	// Enclose the given proxies and split them. 
+	// Return the number of proxies on the left side.
+	u32 Split(b3AABB3* nodeAABB, u32 begin, u32 count) const
 	{
-		return;
+		B3_ASSERT(count > 0);
+
+		// Enclose the proxies and their centers.
+		b3AABB3 aabb = aabbs[ids[begin]];
+
+		b3AABB3 centerAABB;
+		centerAABB.m_lower = centerAABB.m_upper = centers[ids[begin]];
+
+		for (u32 i = begin + 1; i < begin + count; ++i)
+		{
+			aabb = b3Combine(aabb, aabbs[ids[i]]);
+			centerAABB.m_lower = b3Min(centerAABB.m_lower, centers[ids[i]]);
+			centerAABB.m_upper = b3Max(centerAABB.m_upper, centers[ids[i]]);
+		}
+
+		*nodeAABB = aabb;
+
+		if (count <= maxObjectsPerLeaf)
+		{
+			return 0;
+		}
+
+		u32 axis = centerAABB.GetLongestAxisIndex();
+		float32 lower = centerAABB.m_lower[axis];
+		float32 extent = centerAABB.m_upper[axis] - lower;
+
+		if (extent == 0.0f)
+		{
+			// Split in half if the centers coincide.
+			return count / 2;
+		}
+
+		// Bin the proxies by center.
+		u32 binCounts[b3_staticTreeBinCount];
+		b3AABB3 binAABBs[b3_staticTreeBinCount];
+		for (u32 i = 0; i < b3_staticTreeBinCount; ++i)
+		{
+			binCounts[i] = 0;
+			binAABBs[i].m_lower.Set(B3_MAX_FLOAT, B3_MAX_FLOAT, B3_MAX_FLOAT);
+			binAABBs[i].m_upper.Set(-B3_MAX_FLOAT, -B3_MAX_FLOAT, -B3_MAX_FLOAT);
+		}
+
+		float32 binScale = float32(b3_staticTreeBinCount) / extent;
+		for (u32 i = begin; i < begin + count; ++i)
+		{
+			u32 id = ids[i];
+			u32 bin = b3Min(u32(binScale * (centers[id][axis] - lower)), b3_staticTreeBinCount - 1);
+			++binCounts[bin];
+			binAABBs[bin] = b3Combine(binAABBs[bin], aabbs[id]);
+		}
+
+		// Compute the area of the right side of each split.
+		float32 rightAreas[b3_staticTreeBinCount];
+		b3AABB3 rightAABB = binAABBs[b3_staticTreeBinCount - 1];
+		for (u32 i = b3_staticTreeBinCount - 1; i > 0; --i)
+		{
+			rightAABB = b3Combine(rightAABB, binAABBs[i]);
+			rightAreas[i] = rightAABB.SurfaceArea();
+		}
+
+		// Find the split with the minimum cost.
+		// The first and last bins aren't empty, so both sides aren't empty.
+		float32 bestCost = B3_MAX_FLOAT;
+		u32 bestBin = 0;
+
+		b3AABB3 leftAABB = binAABBs[0];
+		u32 leftBinCount = 0;
+		for (u32 i = 0; i < b3_staticTreeBinCount - 1; ++i)
+		{
+			leftAABB = b3Combine(leftAABB, binAABBs[i]);
+			leftBinCount += binCounts[i];
+
+			float32 cost = float32(leftBinCount) * leftAABB.SurfaceArea() + float32(count - leftBinCount) * rightAreas[i + 1];
+			if (leftBinCount > 0 && leftBinCount < count && cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		// Partition the proxies.
+		u32 leftCount = 0;
+		for (u32 i = begin; i < begin + count; ++i)
+		{
+			u32 id = ids[i];
+			u32 bin = b3Min(u32(binScale * (centers[id][axis] - lower)), b3_staticTreeBinCount - 1);
+			if (bin <= bestBin)
+			{
+				b3Swap(ids[i], ids[begin + leftCount]);
+				++leftCount;
+			}
+		}
+
+		B3_ASSERT(0 < leftCount && leftCount < count);
+		return leftCount;
+	}
+
+	// Build a subtree in depth-first order.
+	void BuildSubtree(b3StaticTree::b3Node* nodes, u32& nodeCount, u32 begin, u32 count) const
+	{
+		u32 nodeIndex = nodeCount;
+		++nodeCount;
+
+		b3StaticTree::b3Node* node = nodes + nodeIndex;
+		u32 leftCount = Split(&node->aabb, begin, count);
+		if (leftCount == 0)
+		{
+			node->index = begin;
+			node->count = count;
+			return;
+		}
+
+		node->count = 0;
+
+		// The left subtree is stored after the node.
+		BuildSubtree(nodes, nodeCount, begin, leftCount);
+
+		nodes[nodeIndex].child2 = nodeCount;
+		BuildSubtree(nodes, nodeCount, begin + leftCount, count - leftCount);
+	}
+
+	// Split the tree top until the proxies are below the subtree threshold.
+	u32 BuildTop(u32 begin, u32 count)
+	{
+		// Check capacity.
+		if (topNodeCount == topNodeCapacity)
+		{
+			b3TopNode* oldNodes = topNodes;
+			topNodeCapacity = b3Max(2 * topNodeCapacity, 64u);
+			topNodes = (b3TopNode*)b3Alloc(topNodeCapacity * sizeof(b3TopNode));
+			if (oldNodes)
+			{
+				memcpy(topNodes, oldNodes, topNodeCount * sizeof(b3TopNode));
+				b3Free(oldNodes);
+			}
+		}
+
+		u32 nodeIndex = topNodeCount;
+		++topNodeCount;
+
+		if (count <= subtreeThreshold)
+		{
+			// Check capacity.
+			if (subtreeCount == subtreeCapacity)
+			{
+				b3Subtree* oldSubtrees = subtrees;
+				subtreeCapacity = b3Max(2 * subtreeCapacity, 64u);
+				subtrees = (b3Subtree*)b3Alloc(subtreeCapacity * sizeof(b3Subtree));
+				if (oldSubtrees)
+				{
+					memcpy(subtrees, oldSubtrees, subtreeCount * sizeof(b3Subtree));
+					b3Free(oldSubtrees);
+				}
+			}
+
+			b3Subtree* subtree = subtrees + subtreeCount;
+			subtree->begin = begin;
+			subtree->count = count;
+			subtree->nodeCount = 0;
+
+			topNodes[nodeIndex].subtree = subtreeCount;
+			++subtreeCount;
+			return nodeIndex;
+		}
+
+		b3AABB3 aabb;
+		u32 leftCount = Split(&aabb, begin, count);
+		B3_ASSERT(leftCount > 0);
+
+		u32 child1 = BuildTop(begin, leftCount);
+		u32 child2 = BuildTop(begin + leftCount, count - leftCount);
+
+		b3TopNode* node = topNodes + nodeIndex;
+		node->aabb = aabb;
+		node->child1 = child1;
+		node->child2 = child2;
+		node->subtree = b3_nullSubtree;
+		return nodeIndex;
 	}
 
-	u32 pivot = ids[count - 1];
-	u32 low = 0;
-	for (u32 i = 0; i < count - 1; ++i)
+	// Build a range of subtrees on a thread.
+	// Each subtree can use twice as many nodes as its proxies starting at 
+	// twice its first proxy, so the subtrees never overlap in the buffer.
+	void Execute(u32 begin, u32 end, u32 threadIndex)
 	{
-		if (b3SortPredicate(set, axis, ids[i], pivot))
+		B3_NOT_USED(threadIndex);
+
+		for (u32 i = begin; i < end; ++i)
 		{
-			u32 tmp = ids[i];
-			ids[i] = ids[low];
-			ids[low] = tmp;
-			low++;
+			b3Subtree* subtree = subtrees + i;
+			BuildSubtree(nodeBuffer + 2 * subtree->begin, subtree->nodeCount, subtree->begin, subtree->count);
 		}
 	}
 
-	ids[count - 1] = ids[low];
-	ids[low] = pivot;
+	// Copy the tree top and the subtrees to the tree in depth-first order.
+	void Emit(b3StaticTree* tree, u32 topNodeIndex) const
+	{
+		const b3TopNode* topNode = topNodes + topNodeIndex;
+		if (topNode->subtree != b3_nullSubtree)
+		{
+			const b3Subtree* subtree = subtrees + topNode->subtree;
+			const b3StaticTree::b3Node* src = nodeBuffer + 2 * subtree->begin;
+			b3StaticTree::b3Node* dst = tree->m_nodes + tree->m_nodeCount;
+			u32 offset = tree->m_nodeCount;
+
+			for (u32 i = 0; i < subtree->nodeCount; ++i)
+			{
+				dst[i] = src[i];
+				if (dst[i].IsLeaf() == false)
+				{
+					dst[i].child2 += offset;
+				}
+			}
+
+			tree->m_nodeCount += subtree->nodeCount;
+			return;
+		}
+
+		u32 nodeIndex = tree->m_nodeCount;
+		++tree->m_nodeCount;
+
+		b3StaticTree::b3Node* node = tree->m_nodes + nodeIndex;
+		node->aabb = topNode->aabb;
+		node->count = 0;
+
+		Emit(tree, topNode->child1);
+
+		tree->m_nodes[nodeIndex].child2 = tree->m_nodeCount;
+		Emit(tree, topNode->child2);
+	}
+
+	const b3AABB3* aabbs;
+	const b3Vec3* centers;
+	u32* ids;
+	u32 maxObjectsPerLeaf;
+
+	u32 subtreeThreshold;
 	
-	b3Sort(set, axis, ids, low);
-	b3Sort(set, axis, ids + low + 1, count - 1 - low);
+	b3TopNode* topNodes;
+	u32 topNodeCount;
+	u32 topNodeCapacity;
+
+	b3Subtree* subtrees;
+	u32 subtreeCount;
+	u32 subtreeCapacity;
+
+	b3StaticTree::b3Node* nodeBuffer;
+};
+
+// Computes the proxy centers on a thread.
+struct b3ComputeCentersTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			ids[i] = i;
+			centers[i] = aabbs[i].Centroid();
+		}
+	}
+
+	const b3AABB3* aabbs;
+	b3Vec3* centers;
+	u32* ids;
+};
+
+void b3StaticTree::Build(const b3AABB3* aabbs, u32 count, u32 maxObjectsPerLeaf, b3ThreadPool* threadPool)
+{
+	B3_ASSERT(count > 0);
+	B3_ASSERT(maxObjectsPerLeaf > 0);
+
+	b3Time time;
+
+	Free();
+
+	u32* ids = (u32*)b3Alloc(count * sizeof(u32));
+	b3Vec3* centers = (b3Vec3*)b3Alloc(count * sizeof(b3Vec3));
+	
+	b3ComputeCentersTask centersTask;
+	centersTask.aabbs = aabbs;
+	centersTask.centers = centers;
+	centersTask.ids = ids;
+
+	u32 threadCount = 1;
+	if (threadPool)
+	{
+		threadCount = threadPool->GetThreadCount();
+		threadPool->ParallelFor(&centersTask, count, b3_centerGrainSize);
+	}
+	else
+	{
+		centersTask.Execute(0, count, 0);
+	}
+
+	// A binary tree with at most n leaves has at most 2n - 1 nodes.
+	u32 nodeCapacity = 2 * count - 1;
+	
+	b3StaticTreeBuilder builder;
+	builder.aabbs = aabbs;
+	builder.centers = centers;
+	builder.ids = ids;
+	builder.maxObjectsPerLeaf = maxObjectsPerLeaf;
+	builder.nodeBuffer = (b3Node*)b3Alloc(nodeCapacity * sizeof(b3Node));
+
+	if (threadCount > 1)
+	{
+		// Make a few subtrees per thread for load balancing.
+		builder.subtreeThreshold = b3Max(count / (4 * threadCount), b3Max(b3_minSubtreeProxyCount, maxObjectsPerLeaf));
+		builder.topNodes = NULL;
+		builder.topNodeCount = 0;
+		builder.topNodeCapacity = 0;
+		builder.subtrees = NULL;
+		builder.subtreeCount = 0;
+		builder.subtreeCapacity = 0;
+
+		builder.BuildTop(0, count);
+
+		threadPool->ParallelFor(&builder, builder.subtreeCount, 1);
+
+		u32 nodeCount = builder.topNodeCount - builder.subtreeCount;
+		for (u32 i = 0; i < builder.subtreeCount; ++i)
+		{
+			nodeCount += builder.subtrees[i].nodeCount;
+		}
+
+		m_nodes = (b3Node*)b3Alloc(nodeCount * sizeof(b3Node));
+		m_nodeCount = 0;
+
+		builder.Emit(this, 0);
+
+		B3_ASSERT(m_nodeCount == nodeCount);
+
+		b3Free(builder.topNodes);
+		b3Free(builder.subtrees);
+	}
+	else
+	{
+		u32 nodeCount = 0;
+		builder.BuildSubtree(builder.nodeBuffer, nodeCount, 0, count);
+
+		// Trim the node array.
+		m_nodes = (b3Node*)b3Alloc(nodeCount * sizeof(b3Node));
+		memcpy(m_nodes, builder.nodeBuffer, nodeCount * sizeof(b3Node));
+		m_nodeCount = nodeCount;
+	}
+
+	B3_ASSERT(m_nodeCount <= nodeCapacity);
+
+	b3Free(builder.nodeBuffer);
+	b3Free(centers);
+
+	// Store the proxies in leaf order.
+	m_proxyCount = count;
+	m_aabbs = (b3AABB3*)b3Alloc(count * sizeof(b3AABB3));
+	for (u32 i = 0; i < count; ++i)
+	{
+		m_aabbs[i] = aabbs[ids[i]];
+	}
+	m_ids = ids;
+	m_root = m_nodes[0].aabb;
+
+	ComputeStats();
+
+	time.Update();
+	m_stats.buildTime = time.GetCurrentMilis();
 }
 
-static u32 b3Partition(const b3AABB3& setAABB, const b3AABB3* set, u32* ids, u32 count)
+void b3StaticTree::ComputeStats()
 {
-	// Choose a partitioning axis.
-	u32 splitAxis = setAABB.GetLongestAxisIndex();
+	memset(&m_stats, 0, sizeof(b3StaticTreeStats));
 
-	// Choose a split point.
-	float32 splitPos = setAABB.Centroid()[splitAxis];
+	m_stats.nodeCount = m_nodeCount;
 
-	// Sort along the split axis.
-	b3Sort(set, splitAxis, ids, count);
+	// Walk the tree keeping the depth of each node.
+	b3Stack<u32, 256> stack;
+	stack.Push(0);
+	stack.Push(0);
 
-	// Find the AABB that splits the set in two subsets.
-	u32 left = 0;
-	u32 right = count - 1;
-	u32 middle = left;
-	while (middle < right)
+	while (stack.IsEmpty() == false)
 	{
-		b3Vec3 center = set[ids[middle]].Centroid();
-		if (center[splitAxis] > splitPos)
+		u32 depth = stack.Top();
+		stack.Pop();
+		
+		u32 nodeIndex = stack.Top();
+		stack.Pop();
+
+		const b3Node* node = m_nodes + nodeIndex;
+		if (node->IsLeaf())
 		{
-			// Found median.
-			break;
+			++m_stats.leafCount;
+			m_stats.height = b3Max(m_stats.height, depth);
+			m_stats.cost += float32(node->count) * node->aabb.SurfaceArea();
 		}
-		++middle;
+		else
+		{
+			m_stats.cost += node->aabb.SurfaceArea();
+
+			stack.Push(node->child2);
+			stack.Push(depth + 1);
+			stack.Push(nodeIndex + 1);
+			stack.Push(depth + 1);
+		}
+	}
+
+	float32 rootArea = m_nodes[0].aabb.SurfaceArea();
+	if (rootArea > 0.0f)
+	{
+		m_stats.cost /= rootArea;
 	}
+}
 
-	// Ensure nonempty subsets.
-	u32 count1 = middle;
-	u32 count2 = count - middle;
-	if (count1 == 0 || count2 == 0)
+// Quantize a lower bound so that it decodes to a value not greater than the bound.
+static inline u16 b3QuantizeLower(float32 parentLower, float32 parentUpper, float32 x)
+{
+	float32 extent = parentUpper - parentLower;
+	if (extent <= 0.0f)
 	{
-		// Choose median.
-		middle = (left + right) / 2;
+		return 0;
 	}
 
-	return middle;
+	float32 q = 65535.0f * (x - parentLower) / extent;
+	q = b3Clamp(q, 0.0f, 65535.0f);
+	return u16(q);
 }
 
-void b3StaticTree::Build(const b3AABB3* set, b3Node* node, u32* ids, u32 count, u32 minObjectsPerLeaf, u32 nodeCapacity, u32& leafCount, u32& internalCount)
+// Quantize an upper bound so that it decodes to a value not less than the bound.
+static inline u16 b3QuantizeUpper(float32 parentLower, float32 parentUpper, float32 x)
 {
-	B3_ASSERT(count > 0);
-	
-	// Enclose set
-	b3AABB3 setAABB = set[ids[0]];
-	for (u32 i = 1; i < count; ++i)
+	float32 extent = parentUpper - parentLower;
+	if (extent <= 0.0f)
+	{
+		return 65535;
+	}
+
+	float32 q = 65535.0f * (parentUpper - x) / extent;
+	q = b3Clamp(q, 0.0f, 65535.0f);
+	return u16(65535 - u32(q));
+}
+
+bool b3StaticTree::Compress()
+{
+	B3_ASSERT(m_nodeCount > 0);
+	B3_ASSERT(m_nodes != NULL);
+	B3_ASSERT(m_ownsMemory);
+
+	// A compact leaf stores the number of proxies in four bits 
+	// and the first proxy in 27 bits.
+	if (m_proxyCount > 0x08000000)
+	{
+		return false;
+	}
+
+	for (u32 i = 0; i < m_nodeCount; ++i)
+	{
+		const b3Node* node = m_nodes + i;
+		if (node->IsLeaf() && node->count > 16)
+		{
+			return false;
+		}
+	}
+
+	m_quantizedNodes = (b3QuantizedNode*)b3Alloc(m_nodeCount * sizeof(b3QuantizedNode));
+
+	// Walk the tree keeping the decoded bounds of the parent of each node.
+	// The children must be quantized relative to the decoded bounds 
+	// because these are the bounds seen by the queries.
+	b3QuantizedEntry root;
+	root.index = 0;
+	root.aabb = m_root;
+
+	b3Stack<b3QuantizedEntry, 256> stack;
+	stack.Push(root);
+
+	while (stack.IsEmpty() == false)
 	{
-		setAABB = b3Combine(setAABB, set[ids[i]]);
+		b3QuantizedEntry entry = stack.Top();
+		stack.Pop();
+
+		const b3AABB3& parent = entry.aabb;
+		const b3Node* node = m_nodes + entry.index;
+		b3QuantizedNode* quantizedNode = m_quantizedNodes + entry.index;
+
+		const b3AABB3& aabb = node->aabb;
+		for (u32 i = 0; i < 3; ++i)
+		{
+			quantizedNode->lower[i] = b3QuantizeLower(parent.m_lower[i], parent.m_upper[i], aabb.m_lower[i]);
+			quantizedNode->upper[i] = b3QuantizeUpper(parent.m_lower[i], parent.m_upper[i], aabb.m_upper[i]);
+		}
+
+		// Fix rounding errors so the decoded bounds enclose the node bounds.
+		b3Vec3 step = GetQuantizationStep(parent);
+		b3AABB3 decoded = Decode(parent, step, quantizedNode);
+		for (u32 i = 0; i < 3; ++i)
+		{
+			while (decoded.m_lower[i] > aabb.m_lower[i] && quantizedNode->lower[i] > 0)
+			{
+				--quantizedNode->lower[i];
+				decoded = Decode(parent, step, quantizedNode);
+			}
+
+			while (decoded.m_upper[i] < aabb.m_upper[i] && quantizedNode->upper[i] < 65535)
+			{
+				++quantizedNode->upper[i];
+				decoded = Decode(parent, step, quantizedNode);
+			}
+		}
+
+		B3_ASSERT(b3TestOverlap(decoded, aabb));
+
+		if (node->IsLeaf())
+		{
+			quantizedNode->data = 0x80000000 | ((node->count - 1) << 27) | node->index;
+		}
+		else
+		{
+			B3_ASSERT(node->child2 < 0x80000000);
+			quantizedNode->data = node->child2;
+
+			b3QuantizedEntry child1;
+			child1.index = entry.index + 1;
+			child1.aabb = decoded;
+			stack.Push(child1);
+
+			b3QuantizedEntry child2;
+			child2.index = node->child2;
+			child2.aabb = decoded;
+			stack.Push(child2);
+		}
 	}
 
-	node->aabb = setAABB;
+	b3Free(m_nodes);
+	m_nodes = NULL;
+
+	return true;
+}
+
+void b3StaticTree::Collapse()
+{
+	B3_ASSERT(m_nodeCount > 0);
+	B3_ASSERT(m_nodes != NULL);
+	B3_ASSERT(m_ownsMemory);
+
+	// Each wide node replaces at least one internal binary node 
+	// unless the root is a leaf.
+	u32 capacity = b3Max((m_nodeCount - 1) / 2, u32(1));
+	m_wideNodes = (b3WideNode*)b3Alloc(capacity * sizeof(b3WideNode));
+	m_nodeCount = 0;
+
+	CollapseNode(0);
+
+	B3_ASSERT(m_nodeCount <= capacity);
+
+	// Trim the node array.
+	b3WideNode* wideNodes = (b3WideNode*)b3Alloc(m_nodeCount * sizeof(b3WideNode));
+	memcpy(wideNodes, m_wideNodes, m_nodeCount * sizeof(b3WideNode));
+	b3Free(m_wideNodes);
+	m_wideNodes = wideNodes;
+
+	b3Free(m_nodes);
+	m_nodes = NULL;
+}
+
+u32 b3StaticTree::CollapseNode(u32 nodeIndex)
+{
+	u32 wideIndex = m_nodeCount;
+	++m_nodeCount;
+
+	// Gather the children of the wide node.
+	u32 children[B3_SIMD_WIDTH];
+	u32 childCount = 0;
 
-	if (count <= minObjectsPerLeaf)
+	const b3Node* node = m_nodes + nodeIndex;
+	if (node->IsLeaf())
 	{
-		++leafCount;
-		node->child1 = NULL_NODE_S;
-		node->index = ids[0];
+		children[childCount++] = nodeIndex;
 	}
 	else
 	{
-		++internalCount;
+		children[childCount++] = nodeIndex + 1;
+		children[childCount++] = node->child2;
+	}
 
-		// Partition current set
-		u32 middle = b3Partition(setAABB, set, ids, count);
+	// Replace the internal child with the largest area by its children 
+	// until the wide node is full.
+	while (childCount < B3_SIMD_WIDTH)
+	{
+		u32 bestChild = B3_SIMD_WIDTH;
+		float32 bestArea = -B3_MAX_FLOAT;
+		for (u32 i = 0; i < childCount; ++i)
+		{
+			const b3Node* child = m_nodes + children[i];
+			if (child->IsLeaf())
+			{
+				continue;
+			}
 
-		// Allocate left subtree
-		B3_ASSERT(m_nodeCount < nodeCapacity);
-		node->child1 = m_nodeCount;
-		++m_nodeCount;
+			float32 area = child->aabb.SurfaceArea();
+			if (area > bestArea)
+			{
+				bestChild = i;
+				bestArea = area;
+			}
+		}
 
-		// Allocate right subtree
-		B3_ASSERT(m_nodeCount < nodeCapacity);
-		node->child2 = m_nodeCount;
-		++m_nodeCount;
+		if (bestChild == B3_SIMD_WIDTH)
+		{
+			break;
+		}
 
-		// Build left and right subtrees
-		Build(set, m_nodes + node->child1, ids, middle, minObjectsPerLeaf, nodeCapacity, leafCount, internalCount);
-		Build(set, m_nodes + node->child2, ids + middle, count - middle, minObjectsPerLeaf, nodeCapacity, leafCount, internalCount);
+		u32 index = children[bestChild];
+		children[bestChild] = index + 1;
+		children[childCount++] = m_nodes[index].child2;
 	}
+
+	b3WideNode* wideNode = m_wideNodes + wideIndex;
+	for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+	{
+		if (i >= childCount)
+		{
+			wideNode->lowerX[i] = wideNode->lowerY[i] = wideNode->lowerZ[i] = B3_MAX_FLOAT;
+			wideNode->upperX[i] = wideNode->upperY[i] = wideNode->upperZ[i] = -B3_MAX_FLOAT;
+			wideNode->children[i] = b3_nullWideChild;
+			wideNode->counts[i] = 0;
+			continue;
+		}
+
+		const b3Node* child = m_nodes + children[i];
+
+		wideNode->lowerX[i] = child->aabb.m_lower.x;
+		wideNode->lowerY[i] = child->aabb.m_lower.y;
+		wideNode->lowerZ[i] = child->aabb.m_lower.z;
+		wideNode->upperX[i] = child->aabb.m_upper.x;
+		wideNode->upperY[i] = child->aabb.m_upper.y;
+		wideNode->upperZ[i] = child->aabb.m_upper.z;
+
+		if (child->IsLeaf())
+		{
+			wideNode->children[i] = child->index;
+			wideNode->counts[i] = child->count;
+		}
+		else
+		{
+			// The wide nodes are preallocated, so the node pointer stays valid.
+			wideNode->children[i] = CollapseNode(children[i]);
+			wideNode->counts[i] = 0;
+		}
+	}
+
+	return wideIndex;
 }
 
-void b3StaticTree::Build(const b3AABB3* set, u32 count)
+b3StaticTree::b3TreeEntry b3StaticTree::GetRootEntry() const
 {
-	B3_ASSERT(count > 0);
+	B3_ASSERT(m_nodeCount > 0);
 
-	u32* ids = (u32*)b3Alloc(count * sizeof(u32));
-	for (u32 i = 0; i < count; ++i)
+	b3TreeEntry root;
+
+	if (m_quantizedNodes)
 	{
-		ids[i] = i;
+		const b3QuantizedNode* node = m_quantizedNodes;
+		root.index = node->IsLeaf() ? node->GetIndex() : 0;
+		root.count = node->IsLeaf() ? node->GetCount() : 0;
+		root.aabb = Decode(m_root, GetQuantizationStep(m_root), node);
+		return root;
 	}
 
-	// Leafs = n, Internals = n - 1, Total = 2n - 1, if we assume
-	// each leaf node contains exactly 1 object.
-	const u32 kMinObjectsPerLeaf = 1;
+	if (m_wideNodes)
+	{
+		root.index = 0;
+		root.count = 0;
+		root.aabb = m_root;
+		return root;
+	}
 
-	u32 internalCapacity = count - 1;
-	u32 leafCapacity = count;
-	u32 nodeCapacity = 2 * count - 1;
+	const b3Node* node = m_nodes;
+	root.index = node->IsLeaf() ? node->index : 0;
+	root.count = node->count;
+	root.aabb = node->aabb;
+	return root;
+}
+
+u32 b3StaticTree::GetChildEntries(b3TreeEntry children[B3_SIMD_WIDTH], const b3TreeEntry& entry) const
+{
+	B3_ASSERT(entry.count == 0);
+
+	if (m_quantizedNodes)
+	{
+		const b3QuantizedNode* node = m_quantizedNodes + entry.index;
+		B3_ASSERT(node->IsLeaf() == false);
+
+		b3Vec3 step = GetQuantizationStep(entry.aabb);
+
+		u32 childIndices[2] = { entry.index + 1, node->GetChild2() };
+		for (u32 i = 0; i < 2; ++i)
+		{
+			const b3QuantizedNode* child = m_quantizedNodes + childIndices[i];
+			children[i].index = child->IsLeaf() ? child->GetIndex() : childIndices[i];
+			children[i].count = child->IsLeaf() ? child->GetCount() : 0;
+			children[i].aabb = Decode(entry.aabb, step, child);
+		}
 
-	u32 internalCount = 0;
-	u32 leafCount = 0;
+		return 2;
+	}
+
+	if (m_wideNodes)
+	{
+		const b3WideNode* node = m_wideNodes + entry.index;
+
+		u32 childCount = 0;
+		for (u32 i = 0; i < B3_SIMD_WIDTH; ++i)
+		{
+			if (node->children[i] == b3_nullWideChild)
+			{
+				break;
+			}
+
+			b3TreeEntry* child = children + childCount++;
+			child->index = node->children[i];
+			child->count = node->counts[i];
+			child->aabb.m_lower.Set(node->lowerX[i], node->lowerY[i], node->lowerZ[i]);
+			child->aabb.m_upper.Set(node->upperX[i], node->upperY[i], node->upperZ[i]);
+		}
 
-	m_nodes = (b3Node*)b3Alloc(nodeCapacity * sizeof(b3Node));
-	m_nodeCount = 1;
+		return childCount;
+	}
 
-	Build(set, m_nodes, ids, count, kMinObjectsPerLeaf, nodeCapacity, leafCount, internalCount);
+	const b3Node* node = m_nodes + entry.index;
+	B3_ASSERT(node->IsLeaf() == false);
 
-	b3Free(ids);
+	u32 childIndices[2] = { entry.index + 1, node->child2 };
+	for (u32 i = 0; i < 2; ++i)
+	{
+		const b3Node* child = m_nodes + childIndices[i];
+		children[i].index = child->IsLeaf() ? child->index : childIndices[i];
+		children[i].count = child->count;
+		children[i].aabb = child->aabb;
+	}
 
-	B3_ASSERT(leafCount == leafCapacity);
-	B3_ASSERT(internalCount == internalCapacity);
-	B3_ASSERT(m_nodeCount == nodeCapacity);
+	return 2;
+}
+
+// Identifies a binary image of a static tree.
+const u32 b3_staticTreeBlobMagic = 0x54534233; // "B3ST"
+
+// Increment this when the image layout or the node layout changes.
+const u32 b3_staticTreeBlobVersion = 2;
+
+// The node formats of a binary image.
+enum b3StaticTreeBlobFormat
+{
+	e_binaryBlobFormat,
+	e_quantizedBlobFormat,
+	e_wideBlobFormat
+};
+
+// The header of a binary image of a static tree.
+// The arrays follow the header at the given offsets from the image start.
+struct b3StaticTreeBlob
+{
+	u32 magic;
+	u32 version;
+	u32 format;
+	u32 nodeSize;
+	u32 nodeCount;
+	u32 proxyCount;
+	u32 nodeOffset;
+	u32 aabbOffset;
+	u32 idOffset;
+	b3AABB3 root;
+	u32 padding; // zero, keeps the image free of uninitialized bytes
+	b3StaticTreeStats stats; // the build time isn't stored
+};
+
+// Round up a size to keep the arrays of a binary image aligned.
+static inline u32 b3AlignBlobSize(u32 size)
+{
+	return (size + 15) & ~15;
+}
+
+u32 b3StaticTree::GetNodeSize() const
+{
+	if (m_quantizedNodes)
+	{
+		return sizeof(b3QuantizedNode);
+	}
+
+	if (m_wideNodes)
+	{
+		return sizeof(b3WideNode);
+	}
+
+	return sizeof(b3Node);
+}
+
+u32 b3StaticTree::GetBlobSize() const
+{
+	u32 nodeSize = GetNodeSize();
+
+	u32 size = b3AlignBlobSize(sizeof(b3StaticTreeBlob));
+	size += b3AlignBlobSize(m_nodeCount * nodeSize);
+	size += b3AlignBlobSize(m_proxyCount * sizeof(b3AABB3));
+	size += b3AlignBlobSize(m_proxyCount * sizeof(u32));
+	return size;
+}
+
+void b3StaticTree::WriteBlob(void* blob) const
+{
+	B3_ASSERT((size_t(blob) & 15) == 0);
+
+	u32 nodeSize = GetNodeSize();
+	
+	const void* nodes = m_nodes;
+	u32 format = e_binaryBlobFormat;
+	if (m_quantizedNodes)
+	{
+		nodes = m_quantizedNodes;
+		format = e_quantizedBlobFormat;
+	}
+	else if (m_wideNodes)
+	{
+		nodes = m_wideNodes;
+		format = e_wideBlobFormat;
+	}
+
+	b3StaticTreeBlob header;
+	header.magic = b3_staticTreeBlobMagic;
+	header.version = b3_staticTreeBlobVersion;
+	header.format = format;
+	header.nodeSize = nodeSize;
+	header.nodeCount = m_nodeCount;
+	header.proxyCount = m_proxyCount;
+	header.nodeOffset = b3AlignBlobSize(sizeof(b3StaticTreeBlob));
+	header.aabbOffset = header.nodeOffset + b3AlignBlobSize(m_nodeCount * nodeSize);
+	header.idOffset = header.aabbOffset + b3AlignBlobSize(m_proxyCount * sizeof(b3AABB3));
+	header.root = m_root;
+	header.padding = 0;
+	header.stats = m_stats;
+	
+	// Images of the same tree must be identical.
+	header.stats.buildTime = 0.0;
+
+	u8* bytes = (u8*)blob;
+	memset(bytes, 0, GetBlobSize());
+	memcpy(bytes, &header, sizeof(b3StaticTreeBlob));
+	memcpy(bytes + header.nodeOffset, nodes, m_nodeCount * nodeSize);
+	memcpy(bytes + header.aabbOffset, m_aabbs, m_proxyCount * sizeof(b3AABB3));
+	memcpy(bytes + header.idOffset, m_ids, m_proxyCount * sizeof(u32));
+}
+
+bool b3StaticTree::ReadBlob(const void* blob, u32 size)
+{
+	if ((size_t(blob) & 15) != 0 || size < sizeof(b3StaticTreeBlob))
+	{
+		return false;
+	}
+
+	const u8* bytes = (const u8*)blob;
+	
+	b3StaticTreeBlob header;
+	memcpy(&header, bytes, sizeof(b3StaticTreeBlob));
+
+	if (header.magic != b3_staticTreeBlobMagic || header.version != b3_staticTreeBlobVersion)
+	{
+		return false;
+	}
+
+	if (header.nodeCount == 0 || header.proxyCount == 0)
+	{
+		return false;
+	}
+
+	// The wide node size depends on the SIMD width of the build.
+	u32 nodeSize;
+	switch (header.format)
+	{
+	case e_binaryBlobFormat: nodeSize = sizeof(b3Node); break;
+	case e_quantizedBlobFormat: nodeSize = sizeof(b3QuantizedNode); break;
+	case e_wideBlobFormat: nodeSize = sizeof(b3WideNode); break;
+	default: return false;
+	}
+
+	if (header.nodeSize != nodeSize)
+	{
+		return false;
+	}
+
+	// Check that the arrays are inside the image.
+	u64 nodeEnd = u64(header.nodeOffset) + u64(nodeSize) * header.nodeCount;
+	u64 aabbEnd = u64(header.aabbOffset) + u64(sizeof(b3AABB3)) * header.proxyCount;
+	u64 idEnd = u64(header.idOffset) + u64(sizeof(u32)) * header.proxyCount;
+	if (nodeEnd > size || aabbEnd > size || idEnd > size)
+	{
+		return false;
+	}
+
+	if ((header.nodeOffset & 15) != 0 || (header.aabbOffset & 15) != 0 || (header.idOffset & 15) != 0)
+	{
+		return false;
+	}
+
+	// Check the nodes so that the queries stay inside the arrays.
+	const u8* nodes = bytes + header.nodeOffset;
+	bool valid = false;
+	switch (header.format)
+	{
+	case e_binaryBlobFormat: valid = ValidateNodes((const b3Node*)nodes, header.nodeCount, header.proxyCount); break;
+	case e_quantizedBlobFormat: valid = ValidateNodes((const b3QuantizedNode*)nodes, header.nodeCount, header.proxyCount); break;
+	case e_wideBlobFormat: valid = ValidateNodes((const b3WideNode*)nodes, header.nodeCount, header.proxyCount); break;
+	default: break;
+	}
+
+	if (valid == false)
+	{
+		return false;
+	}
+
+	Free();
+
+	// The image is never written.
+	m_ownsMemory = false;
+	
+	switch (header.format)
+	{
+	case e_binaryBlobFormat: m_nodes = (b3Node*)(bytes + header.nodeOffset); break;
+	case e_quantizedBlobFormat: m_quantizedNodes = (b3QuantizedNode*)(bytes + header.nodeOffset); break;
+	case e_wideBlobFormat: m_wideNodes = (b3WideNode*)(bytes + header.nodeOffset); break;
+	default: break;
+	}
+	
+	m_nodeCount = header.nodeCount;
+	m_root = header.root;
+	m_proxyCount = header.proxyCount;
+	m_aabbs = (b3AABB3*)(bytes + header.aabbOffset);
+	m_ids = (u32*)(bytes + header.idOffset);
+	m_stats = header.stats;
+
+	return true;
+}
+
+bool b3StaticTree::ValidateNodes(const b3Node* nodes, u32 nodeCount, u32 proxyCount)
+{
+	for (u32 i = 0; i < nodeCount; ++i)
+	{
+		const b3Node* node = nodes + i;
+		if (node->IsLeaf())
+		{
+			if (u64(node->index) + node->count > proxyCount)
+			{
+				return false;
+			}
+		}
+		else
+		{
+			if (node->child2 <= i + 1 || node->child2 >= nodeCount)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool b3StaticTree::ValidateNodes(const b3QuantizedNode* nodes, u32 nodeCount, u32 proxyCount)
+{
+	for (u32 i = 0; i < nodeCount; ++i)
+	{
+		const b3QuantizedNode* node = nodes + i;
+		if (node->IsLeaf())
+		{
+			if (u64(node->GetIndex()) + node->GetCount() > proxyCount)
+			{
+				return false;
+			}
+		}
+		else
+		{
+			if (node->GetChild2() <= i + 1 || node->GetChild2() >= nodeCount)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool b3StaticTree::ValidateNodes(const b3WideNode* nodes, u32 nodeCount, u32 proxyCount)
+{
+	for (u32 i = 0; i < nodeCount; ++i)
+	{
+		const b3WideNode* node = nodes + i;
+		for (u32 j = 0; j < B3_SIMD_WIDTH; ++j)
+		{
+			u32 child = node->children[j];
+			if (child == b3_nullWideChild)
+			{
+				continue;
+			}
+
+			if (node->counts[j] > 0)
+			{
+				if (u64(child) + node->counts[j] > proxyCount)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if (child <= i || child >= nodeCount)
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
 }
 
 void b3StaticTree::Draw(b3Draw* draw) const
@@ -185,8 +1127,48 @@ void b3StaticTree::Draw(b3Draw* draw) const
 		return;
 	}
 
-	u32 root = 0;
+	if (m_quantizedNodes)
+	{
+		b3QuantizedEntry root;
+		root.index = 0;
+		root.aabb = Decode(m_root, GetQuantizationStep(m_root), m_quantizedNodes);
+
+		b3Stack<b3QuantizedEntry, 256> stack;
+		stack.Push(root);
+
+		while (!stack.IsEmpty())
+		{
+			b3QuantizedEntry entry = stack.Top();
 
+			stack.Pop();
+
+			const b3QuantizedNode* node = m_quantizedNodes + entry.index;
+			if (node->IsLeaf())
+			{
+				draw->DrawAABB(entry.aabb, b3Color_pink);
+			}
+			else
+			{
+				draw->DrawAABB(entry.aabb, b3Color_red);
+
+				b3Vec3 step = GetQuantizationStep(entry.aabb);
+
+				b3QuantizedEntry child1;
+				child1.index = entry.index + 1;
+				child1.aabb = Decode(entry.aabb, step, m_quantizedNodes + child1.index);
+				stack.Push(child1);
+
+				b3QuantizedEntry child2;
+				child2.index = node->GetChild2();
+				child2.aabb = Decode(entry.aabb, step, m_quantizedNodes + child2.index);
+				stack.Push(child2);
+			}
+		}
+
+		return;
+	}
+
+	u32 root = 0;
 	b3Stack<u32, 256> stack;
 	stack.Push(root);
 
@@ -205,8 +1187,8 @@ void b3StaticTree::Draw(b3Draw* draw) const
 		{
 			draw->DrawAABB(node->aabb, b3Color_red);
 			
-			stack.Push(node->child1);
+			stack.Push(nodeIndex + 1);
 			stack.Push(node->child2);
 		}
 	}
-}
+}
\ No newline at end of file
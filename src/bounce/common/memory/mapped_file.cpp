@@ -0,0 +1,158 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/common/memory/mapped_file.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+b3MappedFile::b3MappedFile()
+{
+	m_data = NULL;
+	m_size = 0;
+}
+
+b3MappedFile::~b3MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool b3MappedFile::Open(const char* path)
+{
+	Close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) == FALSE || size.QuadPart == 0 || size.QuadPart > 0xFFFFFFFF)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	
+	// The mapping keeps a reference to the file.
+	CloseHandle(file);
+	
+	if (mapping == NULL)
+	{
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	
+	// The view keeps a reference to the mapping.
+	CloseHandle(mapping);
+
+	if (data == NULL)
+	{
+		return false;
+	}
+
+	m_data = data;
+	m_size = u32(size.QuadPart);
+	return true;
+}
+
+void b3MappedFile::Close()
+{
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = NULL;
+		m_size = 0;
+	}
+}
+
+#else
+
+bool b3MappedFile::Open(const char* path)
+{
+	Close();
+
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0 || u64(info.st_size) > 0xFFFFFFFF)
+	{
+		close(file);
+		return false;
+	}
+
+	void* data = mmap(NULL, size_t(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+	
+	// The mapping keeps a reference to the file.
+	close(file);
+
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = data;
+	m_size = u32(info.st_size);
+	return true;
+}
+
+void b3MappedFile::Close()
+{
+	if (m_data)
+	{
+		munmap(m_data, m_size);
+		m_data = NULL;
+		m_size = 0;
+	}
+}
+
+#endif
+
+bool b3WriteFile(const char* path, const void* data, u32 size)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	size_t written = fwrite(data, 1, size, file);
+	
+	if (fclose(file) != 0)
+	{
+		return false;
+	}
+
+	return written == size;
+}
\ No newline at end of file
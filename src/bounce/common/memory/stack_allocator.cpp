@@ -24,17 +24,25 @@ b3StackAllocator::b3StackAllocator()
 	m_blocks = (b3Block*)b3Alloc(m_blockCapacity * sizeof(b3Block));
 	m_blockCount = 0;
 	m_allocatedSize = 0;
+	m_requestedSize = 0;
+	m_maxRequestedSize = 0;
+	m_memoryCapacity = b3_maxStackSize;
+	m_memory = (u8*)b3Alloc(m_memoryCapacity);
 }
 
 b3StackAllocator::~b3StackAllocator() 
 {
 	B3_ASSERT(m_allocatedSize == 0);
 	B3_ASSERT(m_blockCount == 0);
+	b3Free(m_memory);
 	b3Free(m_blocks);
 }
 
 void* b3StackAllocator::Allocate(u32 size) 
 {
+	// Keep the next block aligned.
+	size = (size + b3_stackAlignment - 1) & ~(b3_stackAlignment - 1);
+
 	if (m_blockCount == m_blockCapacity) 
 	{
 		// Then duplicate capacity if needed.
@@ -47,7 +55,7 @@ void* b3StackAllocator::Allocate(u32 size)
 
 	b3Block* block = m_blocks + m_blockCount;
 	block->size = size;
-	if (m_allocatedSize + size > b3_maxStackSize) 
+	if (m_allocatedSize + size > m_memoryCapacity) 
 	{
 		// Allocate with parent allocator.
 		block->data = (u8*) b3Alloc(size);
@@ -63,6 +71,12 @@ void* b3StackAllocator::Allocate(u32 size)
 	
 	++m_blockCount;
 
+	m_requestedSize += size;
+	if (m_requestedSize > m_maxRequestedSize)
+	{
+		m_maxRequestedSize = m_requestedSize;
+	}
+
 	return block->data;
 }
 
@@ -80,4 +94,13 @@ void b3StackAllocator::Free(void* p)
 		m_allocatedSize -= block->size;
 	}
 	--m_blockCount;
+	m_requestedSize -= block->size;
+
+	// Grow the stack to the peak usage if it didn't fit.
+	if (m_blockCount == 0 && m_maxRequestedSize > m_memoryCapacity)
+	{
+		b3Free(m_memory);
+		m_memoryCapacity = m_maxRequestedSize;
+		m_memory = (u8*)b3Alloc(m_memoryCapacity);
+	}
 }
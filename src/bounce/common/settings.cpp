@@ -18,19 +18,21 @@
 
 #include <bounce/common/settings.h>
 #include <bounce/common/math/math.h>
+#include <bounce/common/thread/atomic.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 
-u32 b3_allocCalls = 0;
-u32 b3_maxAllocCalls = 0;
+// The default allocator may be called from many threads.
+b3Counter b3_allocCalls(0);
+b3Counter b3_maxAllocCalls(0);
 
 b3Version b3_version = { 1, 0, 0 };
 
 void* b3Alloc(u32 size) 
 {
-	++b3_allocCalls;
-	b3_maxAllocCalls = b3Max(b3_maxAllocCalls, b3_allocCalls);
+	u32 calls = b3_allocCalls.fetch_add(1, std::memory_order_relaxed) + 1;
+	b3RaiseTo(b3_maxAllocCalls, calls);
 	return malloc(size);
 }
 
@@ -0,0 +1,70 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/common/sort.h>
+#include <bounce/common/math/math.h>
+
+void b3SortKeys(u64* keys, u64* temp, u32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	u64* src = keys;
+	u64* dst = temp;
+
+	for (u32 pass = 0; pass < 4; ++pass)
+	{
+		u32 shift = 32 + 8 * pass;
+
+		u32 offsets[256];
+		memset(offsets, 0, sizeof(offsets));
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			++offsets[(src[i] >> shift) & 0xFF];
+		}
+
+		// Skip the pass if all the keys have the same digit.
+		if (offsets[(src[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		u32 offset = 0;
+		for (u32 i = 0; i < 256; ++i)
+		{
+			u32 digitCount = offsets[i];
+			offsets[i] = offset;
+			offset += digitCount;
+		}
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			dst[offsets[(src[i] >> shift) & 0xFF]++] = src[i];
+		}
+
+		b3Swap(src, dst);
+	}
+
+	if (src != keys)
+	{
+		memcpy(keys, src, count * sizeof(u64));
+	}
+}
@@ -0,0 +1,207 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce/common/thread/thread_pool.h>
+#include <bounce/common/math/math.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// The synchronization state shared by the calling thread and the workers.
+struct b3ThreadPoolState
+{
+	// Execute the chunks of the current task until there are no chunks left.
+	void Work(u32 threadIndex)
+	{
+		for (;;)
+		{
+			u32 chunk = nextChunk.fetch_add(1);
+			if (chunk >= chunkCount)
+			{
+				break;
+			}
+
+			u32 begin = chunk * grainSize;
+			u32 end = b3Min(begin + grainSize, count);
+			fcn(task, begin, end, threadIndex);
+		}
+	}
+
+	// The worker thread entry point.
+	void WorkerMain(u32 threadIndex)
+	{
+		u32 lastGeneration = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (exit == false && generation == lastGeneration)
+				{
+					wakeCondition.wait(lock);
+				}
+
+				if (exit)
+				{
+					return;
+				}
+
+				lastGeneration = generation;
+			}
+
+			Work(threadIndex);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				--busyWorkers;
+				if (busyWorkers == 0)
+				{
+					doneCondition.notify_one();
+				}
+			}
+		}
+	}
+
+	std::thread workers[b3_maxThreads - 1];
+	u32 workerCount;
+
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+	u32 generation;
+	u32 busyWorkers;
+	bool exit;
+
+	// The current task.
+	void(*fcn)(void* task, u32 begin, u32 end, u32 threadIndex);
+	void* task;
+	u32 count;
+	u32 grainSize;
+	u32 chunkCount;
+	std::atomic<u32> nextChunk;
+};
+
+b3ThreadPool::b3ThreadPool()
+{
+	m_threadCount = 1;
+	m_state = NULL;
+}
+
+b3ThreadPool::~b3ThreadPool()
+{
+	SetThreadCount(1);
+}
+
+void b3ThreadPool::SetThreadCount(u32 count)
+{
+	count = b3Clamp(count, 1u, b3_maxThreads);
+	if (count == m_threadCount)
+	{
+		return;
+	}
+
+	if (m_state)
+	{
+		// Stop and join the current workers.
+		{
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			m_state->exit = true;
+		}
+		m_state->wakeCondition.notify_all();
+
+		for (u32 i = 0; i < m_state->workerCount; ++i)
+		{
+			m_state->workers[i].join();
+		}
+
+		m_state->~b3ThreadPoolState();
+		b3Free(m_state);
+		m_state = NULL;
+	}
+
+	m_threadCount = count;
+
+	if (m_threadCount > 1)
+	{
+		void* mem = b3Alloc(sizeof(b3ThreadPoolState));
+		m_state = new (mem) b3ThreadPoolState();
+		m_state->workerCount = m_threadCount - 1;
+		m_state->generation = 0;
+		m_state->busyWorkers = 0;
+		m_state->exit = false;
+		m_state->fcn = NULL;
+		m_state->task = NULL;
+		m_state->count = 0;
+		m_state->grainSize = 1;
+		m_state->chunkCount = 0;
+		m_state->nextChunk = 0;
+
+		for (u32 i = 0; i < m_state->workerCount; ++i)
+		{
+			m_state->workers[i] = std::thread(&b3ThreadPoolState::WorkerMain, m_state, i + 1);
+		}
+	}
+}
+
+void b3ThreadPool::Run(b3TaskFcn fcn, void* task, u32 count, u32 grainSize)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (grainSize == 0)
+	{
+		grainSize = 1;
+	}
+
+	if (m_state == NULL || count <= grainSize)
+	{
+		// Not worth waking up the workers.
+		for (u32 begin = 0; begin < count; begin += grainSize)
+		{
+			u32 end = b3Min(begin + grainSize, count);
+			fcn(task, begin, end, 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		m_state->fcn = fcn;
+		m_state->task = task;
+		m_state->count = count;
+		m_state->grainSize = grainSize;
+		m_state->chunkCount = (count + grainSize - 1) / grainSize;
+		m_state->nextChunk = 0;
+		m_state->busyWorkers = m_state->workerCount;
+		++m_state->generation;
+	}
+	m_state->wakeCondition.notify_all();
+
+	// The calling thread helps.
+	m_state->Work(0);
+
+	// Wait for the workers to finish their chunks.
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+	while (m_state->busyWorkers > 0)
+	{
+		m_state->doneCondition.wait(lock);
+	}
+}
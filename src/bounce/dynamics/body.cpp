@@ -27,11 +27,17 @@ b3Body::b3Body(const b3BodyDef& def, b3World* world)
 	m_world = world;
 	m_type = def.type;
 	m_flags = 0;
+	m_island = NULL;
 	
 	if (def.awake)
 	{
 		m_flags |= e_awakeFlag;
 	}
+
+	if (def.bullet)
+	{
+		SetBullet(true);
+	}
 	
 	if (m_type == e_dynamicBody) 
 	{
@@ -179,6 +185,15 @@ void b3Body::SynchronizeTransform()
 	m_xf = m_sweep.GetTransform(1.0f);
 }
 
+void b3Body::Advance(float32 t)
+{
+	// Move the initial and final states to the given time.
+	m_sweep.Advance(t);
+	m_sweep.worldCenter = m_sweep.worldCenter0;
+	m_sweep.orientation = m_sweep.orientation0;
+	SynchronizeTransform();
+}
+
 void b3Body::SynchronizeShapes() 
 {
 	b3Transform xf1 = m_sweep.GetTransform(0.0f);
@@ -417,6 +432,75 @@ void b3Body::SetMassData(const b3MassData* massData)
 	m_linearVelocity += b3Cross(m_angularVelocity, m_sweep.worldCenter - oldCenter);
 }
 
+void b3Body::SetAwake(bool flag) 
+{
+	if (flag) 
+	{
+		if (!IsAwake()) 
+		{
+			m_flags |= e_awakeFlag;
+			m_sleepTime = 0.0f;
+
+			if (IsBullet())
+			{
+				b3Increment(m_world->m_awakeBulletCount);
+			}
+		}
+
+		// The island of this body must be solved again.
+		if (m_island)
+		{
+			m_world->m_islandMan.WakeIsland(m_island);
+		}
+	}
+	else 
+	{
+		// Islands can fall asleep on many threads.
+		if (IsAwake() && IsBullet())
+		{
+			b3Decrement(m_world->m_awakeBulletCount);
+		}
+
+		m_flags &= ~e_awakeFlag;
+		m_sleepTime = 0.0f;
+		m_force.SetZero();
+		m_torque.SetZero();
+		m_linearVelocity.SetZero();
+		m_angularVelocity.SetZero();		
+	}
+}
+
+void b3Body::SetBullet(bool flag)
+{
+	if (flag == IsBullet())
+	{
+		return;
+	}
+
+	b3World* world = m_world;
+	if (flag)
+	{
+		m_flags |= e_bulletFlag;
+		m_bulletLink.m_item = this;
+		world->m_bulletList.PushFront(&m_bulletLink);
+
+		if (IsAwake())
+		{
+			b3Increment(world->m_awakeBulletCount);
+		}
+	}
+	else
+	{
+		m_flags &= ~e_bulletFlag;
+		world->m_bulletList.Remove(&m_bulletLink);
+
+		if (IsAwake())
+		{
+			b3Decrement(world->m_awakeBulletCount);
+		}
+	}
+}
+
 void b3Body::SetType(b3BodyType type)
 {
 	if (m_type == type)
@@ -444,6 +528,25 @@ void b3Body::SetType(b3BodyType type)
 
 	DestroyContacts();
 
+	// Relink the body and its joints to the island graph.
+	b3IslandManager* islandMan = &m_world->m_islandMan;
+	for (b3JointEdge* je = m_jointEdges.m_head; je; je = je->m_next)
+	{
+		islandMan->RemoveJoint(je->joint);
+	}
+	
+	islandMan->RemoveBody(this);
+	
+	if (m_type != e_staticBody)
+	{
+		islandMan->AddBody(this);
+	}
+
+	for (b3JointEdge* je = m_jointEdges.m_head; je; je = je->m_next)
+	{
+		islandMan->AddJoint(je->joint);
+	}
+
 	// Move the shape proxies so new contacts can be created.
 	b3BroadPhase* phase = &m_world->m_contactMan.m_broadPhase;
 	for (b3Shape* s = m_shapeList.m_head; s; s = s->m_next)
@@ -465,6 +568,7 @@ void b3Body::Dump() const
 	b3Log("		bd.angularVelocity.Set(%f, %f, %f);\n", m_angularVelocity.x, m_angularVelocity.y, m_angularVelocity.z);
 	b3Log("		bd.gravityScale = %f;\n", m_gravityScale);
 	b3Log("		bd.awake = %d;\n", m_flags & e_awakeFlag);
+	b3Log("		bd.bullet = %d;\n", (m_flags & e_bulletFlag) != 0);
 	b3Log("		\n");
 	b3Log("		bodies[%d] = world.CreateBody(bd);\n");
 	b3Log("		\n");
@@ -17,18 +17,102 @@
 */
 
 #include <bounce/dynamics/cloth/cloth.h>
+#include <bounce/dynamics/coloring.h>
 #include <bounce/collision/shapes/mesh.h>
 #include <bounce/common/template/array.h>
+#include <bounce/common/sort.h>
 #include <bounce/common/draw.h>
+#include <bounce/common/thread/thread_pool.h>
+#include <bounce/dynamics/world.h>
+#include <bounce/dynamics/world_listeners.h>
+#include <bounce/dynamics/body.h>
+#include <bounce/dynamics/shapes/shape.h>
+
+#define B3_NULL_CLOTH_EDGE (0xFFFFFFFF)
+#define B3_NULL_CLOTH_CONTACT (0xFFFFFFFF)
+
+// The number of wide constraints of a color solved per task.
+const u32 b3_clothGrainSize = 16;
+
+// The number of particle contacts solved per task.
+const u32 b3_clothContactGrainSize = 64;
+
+// Particles closer than this distance to a shape get a contact, so that the particles 
+// pushed into the shape by the constraints during the iterations are caught.
+const float32 b3_clothContactMargin = 0.1f;
+
+// The number of triangles searched for self-contacts per task.
+const u32 b3_clothTriangleGrainSize = 64;
+
+// Get the sphere enclosing the particle motion in a step. 
+// This prevents fast particles from tunneling through thin shapes.
+static inline b3Sphere b3GetParticleSphere(const b3Vec3& x0, const b3Vec3& x, float32 r)
+{
+	b3Sphere sphere;
+	sphere.vertex = x0;
+	sphere.radius = r + b3Distance(x0, x) + b3_clothContactMargin;
+	return sphere;
+}
+
+// Get the vertices of a triangle half-edge.
+static inline void b3GetEdgeVertices(const b3Mesh* m, u32 edge, u32& v1, u32& v2)
+{
+	const b3Triangle* t = m->triangles + edge / 3;
+	u32 is[3] = { t->v1, t->v2, t->v3 };
+
+	u32 j = edge % 3;
+	u32 k = j + 1 < 3 ? j + 1 : 0;
+	
+	v1 = is[j];
+	v2 = is[k];
+}
 
 b3Cloth::b3Cloth()
 {
 	m_pCount = 0;
-	m_ps = NULL;
+	m_x = NULL;
+	m_x0 = NULL;
+	m_v = NULL;
+	m_im = NULL;
 	m_c1Count = 0;
 	m_c1s = NULL;
 	m_c2Count = 0;
 	m_c2s = NULL;
+	m_wideC1s = NULL;
+	m_wideC2s = NULL;
+	m_world = NULL;
+	m_proxyIds = NULL;
+	m_contacts = NULL;
+	m_contactCount = 0;
+	m_particleContacts = NULL;
+	m_selfCollision = false;
+	m_cellSize = 0.0f;
+	m_hashSize = 0;
+	m_hashBuckets = NULL;
+	m_hashParticles = NULL;
+	m_hashPositions = NULL;
+	m_pairs = NULL;
+	m_sortPairs = NULL;
+	m_pairCapacity = 0;
+	m_selfContacts = NULL;
+	m_selfContactCount = 0;
+	m_selfContactCapacity = 0;
+	m_aabb.m_lower.SetZero();
+	m_aabb.m_upper.SetZero();
+	m_awake = true;
+	m_sleepTime = 0.0f;
+	m_system = NULL;
+	m_particleOffset = 0;
+	m_prev = NULL;
+	m_next = NULL;
+
+	for (u32 i = 0; i < b3_maxThreads; ++i)
+	{
+		b3ClothPairBuffer* buffer = m_threadPairs + i;
+		buffer->keys = NULL;
+		buffer->count = 0;
+		buffer->capacity = 0;
+	}
 
 	m_k1 = 0.0f;
 	m_k2 = 0.0f;
@@ -39,12 +123,52 @@ b3Cloth::b3Cloth()
 
 b3Cloth::~b3Cloth()
 {
-	b3Free(m_ps);
+	// The particles of a cloth in a cloth system live in the system buffers.
+	if (m_system == NULL)
+	{
+		b3Free(m_x);
+		b3Free(m_x0);
+		b3Free(m_v);
+		b3Free(m_im);
+	}
+
 	b3Free(m_c1s);
 	b3Free(m_c2s);
+	b3Free(m_wideC1s);
+	b3Free(m_wideC2s);
+	b3Free(m_proxyIds);
+	b3Free(m_contacts);
+	b3Free(m_particleContacts);
+	b3Free(m_hashBuckets);
+	b3Free(m_hashParticles);
+	b3Free(m_hashPositions);
+	b3Free(m_pairs);
+	b3Free(m_sortPairs);
+	b3Free(m_selfContacts);
+
+	for (u32 i = 0; i < b3_maxThreads; ++i)
+	{
+		if (m_threadPairs[i].keys)
+		{
+			b3Free(m_threadPairs[i].keys);
+		}
+	}
 }
 
 void b3Cloth::Initialize(const b3ClothDef& def)
+{
+	B3_ASSERT(def.mesh);
+	u32 count = def.mesh->vertexCount;
+	
+	b3Vec3* x = (b3Vec3*)b3Alloc(count * sizeof(b3Vec3));
+	b3Vec3* x0 = (b3Vec3*)b3Alloc(count * sizeof(b3Vec3));
+	b3Vec3* v = (b3Vec3*)b3Alloc(count * sizeof(b3Vec3));
+	float32* im = (float32*)b3Alloc(count * sizeof(float32));
+	
+	Initialize(def, x, x0, v, im);
+}
+
+void b3Cloth::Initialize(const b3ClothDef& def, b3Vec3* x, b3Vec3* x0, b3Vec3* v, float32* im)
 {
 	B3_ASSERT(def.mesh);
 	m_mesh = def.mesh;
@@ -52,18 +176,108 @@ void b3Cloth::Initialize(const b3ClothDef& def)
 	const b3Mesh* m = m_mesh;
 
 	m_pCount = m->vertexCount;
-	m_ps = (b3Particle*)b3Alloc(m_pCount * sizeof(b3Particle));
-	
+	m_x = x;
+	m_x0 = x0;
+	m_v = v;
+	m_im = im;
+
 	for (u32 i = 0; i < m->vertexCount; ++i)
 	{
-		b3Particle* p = m_ps + i;
-		p->im = 0.0f;
-		p->p = m->vertices[i];
-		p->p0 = p->p;
-		p->v.SetZero();
+		m_x[i] = m->vertices[i];
+		m_x0[i] = m->vertices[i];
+		m_v[i].SetZero();
+		m_im[i] = 0.0f;
+	}
+
+	// Find the twin of each triangle edge.
+	// Half-edge 3 * i + j goes from vertex j to vertex j + 1 of triangle i.
+	// Sort the half-edges by their lowest vertex and match the half-edges 
+	// within each group, so this is linear in the number of triangles.
+	u32 edgeCount = 3 * m->triangleCount;
+	u64* keys = (u64*)b3Alloc(2 * edgeCount * sizeof(u64));
+	u32* twins = (u32*)b3Alloc(edgeCount * sizeof(u32));
+	u32* leaders = (u32*)b3Alloc(edgeCount * sizeof(u32));
+
+	for (u32 i = 0; i < m->triangleCount; ++i)
+	{
+		b3Triangle* t = m->triangles + i;
+		u32 is[3] = { t->v1, t->v2, t->v3 };
+
+		for (u32 j = 0; j < 3; ++j)
+		{
+			u32 k = j + 1 < 3 ? j + 1 : 0;
+			
+			u32 edge = 3 * i + j;
+			u64 vertex = b3Min(is[j], is[k]);
+			
+			keys[edge] = (vertex << 32) | u64(edge);
+			twins[edge] = B3_NULL_CLOTH_EDGE;
+			leaders[edge] = B3_NULL_CLOTH_EDGE;
+		}
 	}
 
-	m_c1s = (b3C1*)b3Alloc(3 * m->triangleCount * sizeof(b3C1));
+	b3SortKeys(keys, keys + edgeCount, edgeCount);
+
+	u32 c1Count = 0;
+	u32 c2Count = 0;
+	
+	u32 begin = 0;
+	while (begin < edgeCount)
+	{
+		u32 end = begin + 1;
+		while (end < edgeCount && (keys[end] >> 32) == (keys[begin] >> 32))
+		{
+			++end;
+		}
+
+		// The groups are as small as the vertex valences.
+		for (u32 i = begin; i < end; ++i)
+		{
+			u32 e1 = u32(keys[i]);
+			if (leaders[e1] != B3_NULL_CLOTH_EDGE)
+			{
+				continue;
+			}
+
+			// This is the first half-edge of an edge.
+			leaders[e1] = e1;
+			++c1Count;
+
+			u32 e1v1, e1v2;
+			b3GetEdgeVertices(m, e1, e1v1, e1v2);
+
+			for (u32 j = i + 1; j < end; ++j)
+			{
+				u32 e2 = u32(keys[j]);
+				
+				u32 e2v1, e2v2;
+				b3GetEdgeVertices(m, e2, e2v1, e2v2);
+
+				if (e1v1 == e2v1 && e1v2 == e2v2)
+				{
+					leaders[e2] = e1;
+				}
+				else if (e1v1 == e2v2 && e1v2 == e2v1)
+				{
+					leaders[e2] = e1;
+
+					if (twins[e1] == B3_NULL_CLOTH_EDGE && e1 / 3 != e2 / 3)
+					{
+						twins[e1] = e2;
+						twins[e2] = e1;
+						++c2Count;
+					}
+				}
+			}
+		}
+
+		begin = end;
+	}
+
+	b3Free(keys);
+
+	// Emit one stretch constraint per edge.
+	m_c1s = (b3C1*)b3Alloc(c1Count * sizeof(b3C1));
 	m_c1Count = 0;
 
 	for (u32 i = 0; i < m->triangleCount; ++i)
@@ -73,6 +287,12 @@ void b3Cloth::Initialize(const b3ClothDef& def)
 		u32 is[3] = { t->v1, t->v2, t->v3 };
 		for (u32 j = 0; j < 3; ++j)
 		{
+			u32 edge = 3 * i + j;
+			if (leaders[edge] != edge)
+			{
+				continue;
+			}
+
 			u32 k = j + 1 < 3 ? j + 1 : 0;
 
 			u32 v1 = is[j];
@@ -97,17 +317,21 @@ void b3Cloth::Initialize(const b3ClothDef& def)
 
 		const float32 inv3 = 1.0f / 3.0f;
 
-		m_ps[t->v1].im += inv3 * mass;
-		m_ps[t->v2].im += inv3 * mass;
-		m_ps[t->v3].im += inv3 * mass;
+		m_im[t->v1] += inv3 * mass;
+		m_im[t->v2] += inv3 * mass;
+		m_im[t->v3] += inv3 * mass;
 	}
 
+	B3_ASSERT(m_c1Count == c1Count);
+
 	for (u32 i = 0; i < m_pCount; ++i)
 	{
-		m_ps[i].im = m_ps[i].im > 0.0f ? 1.0f / m_ps[i].im : 0.0f;
+		m_im[i] = m_im[i] > 0.0f ? 1.0f / m_im[i] : 0.0f;
 	}
 
-	u32 c2Capacity = 0;
+	// Emit one bending constraint per pair of adjacent triangles.
+	m_c2Count = 0;
+	m_c2s = (b3C2*)b3Alloc(c2Count * sizeof(b3C2));
 
 	for (u32 i = 0; i < m->triangleCount; ++i)
 	{
@@ -116,107 +340,825 @@ void b3Cloth::Initialize(const b3ClothDef& def)
 
 		for (u32 j1 = 0; j1 < 3; ++j1)
 		{
+			u32 twin = twins[3 * i + j1];
+			if (twin == B3_NULL_CLOTH_EDGE || twin < 3 * i + j1)
+			{
+				continue;
+			}
+
+			b3Triangle* t2 = m->triangles + twin / 3;
+			u32 i2s[3] = { t2->v1, t2->v2, t2->v3 };
+
 			u32 k1 = j1 + 1 < 3 ? j1 + 1 : 0;
+			u32 k3 = k1 + 1 < 3 ? k1 + 1 : 0;
+			
+			u32 j2 = twin % 3;
+			u32 k2 = j2 + 1 < 3 ? j2 + 1 : 0;
+			u32 k4 = k2 + 1 < 3 ? k2 + 1 : 0;
 
 			u32 t1v1 = i1s[j1];
 			u32 t1v2 = i1s[k1];
+			u32 t1v3 = i1s[k3];
+			u32 t2v3 = i2s[k4];
+
+			b3Vec3 p1 = m->vertices[t1v1];
+			b3Vec3 p2 = m->vertices[t1v2];
+			b3Vec3 p3 = m->vertices[t1v3];
+			b3Vec3 p4 = m->vertices[t2v3];
+
+			b3Vec3 n1 = b3Cross(p2 - p1, p3 - p1);
+			n1.Normalize();
+			
+			b3Vec3 n2 = b3Cross(p2 - p1, p4 - p1);
+			n2.Normalize();
+			
+			float32 x = b3Dot(n1, n2);
+
+			b3Vec3 n3 = b3Cross(n1, n2);
+			float32 y = b3Length(n3);
+
+			b3C2* c = m_c2s + m_c2Count;
+			c->i1 = t1v1;
+			c->i2 = t1v2;
+			c->i3 = t1v3;
+			c->i4 = t2v3;
+			c->angle = atan2(y, x);
+			
+			++m_c2Count;
+		}
+	}
+
+	B3_ASSERT(m_c2Count == c2Count);
+
+	b3Free(leaders);
+	b3Free(twins);
+
+	PackC1();
+	PackC2();
+
+	m_k1 = def.k1;
+	m_k2 = def.k2;
+	m_kd = def.kd;
+	m_r = def.r;
+	m_gravity = def.gravity;
+
+	m_world = def.world;
+	if (m_world)
+	{
+		m_proxyIds = (i32*)b3Alloc(m_pCount * sizeof(i32));
+		m_contacts = (b3ClothContact*)b3Alloc(m_pCount * sizeof(b3ClothContact));
+		m_particleContacts = (u32*)b3Alloc(m_pCount * sizeof(u32));
+
+		for (u32 i = 0; i < m_pCount; ++i)
+		{
+			b3AABB3 aabb;
+			aabb.m_lower = aabb.m_upper = m_x[i];
+			aabb.Extend(m_r + B3_AABB_EXTENSION);
+			
+			// The particle buffers may be moved by a cloth system. 
+			// Therefore, the particle index is recovered from the proxy ID address.
+			m_proxyIds[i] = m_tree.InsertNode(aabb, m_proxyIds + i);
+			m_particleContacts[i] = B3_NULL_CLOTH_CONTACT;
+		}
+	}
+
+	m_selfCollision = def.selfCollision;
+	if (m_selfCollision)
+	{
+		B3_ASSERT(m_r > 0.0f);
+
+		// A triangle overlaps few cells if the cells are larger than the edges 
+		// and the self-contact distance.
+		float32 length = 0.0f;
+		for (u32 i = 0; i < m_c1Count; ++i)
+		{
+			length += m_c1s[i].L;
+		}
+		
+		if (m_c1Count > 0)
+		{
+			length /= float32(m_c1Count);
+		}
+
+		m_cellSize = 2.0f * b3Max(length, 4.0f * m_r);
+
+		// Keep about two buckets per particle.
+		m_hashSize = 1;
+		while (m_hashSize < 2 * m_pCount)
+		{
+			m_hashSize *= 2;
+		}
+
+		m_hashBuckets = (u32*)b3Alloc((m_hashSize + 1) * sizeof(u32));
+		m_hashParticles = (u32*)b3Alloc(m_pCount * sizeof(u32));
+		m_hashPositions = (b3Vec3*)b3Alloc(m_pCount * sizeof(b3Vec3));
+	}
+
+	if (m_pCount > 0)
+	{
+		m_aabb.Compute(m_x, m_pCount);
+	}
+
+	m_awake = true;
+	m_sleepTime = 0.0f;
+}
+
+// Get the particles of a constraint.
+static inline u32 b3GetParticles(const b3C1& c, u32* is)
+{
+	is[0] = c.i1;
+	is[1] = c.i2;
+	return 2;
+}
+
+static inline u32 b3GetParticles(const b3C2& c, u32* is)
+{
+	is[0] = c.i1;
+	is[1] = c.i2;
+	is[2] = c.i3;
+	is[3] = c.i4;
+	return 4;
+}
+
+// Get the particles of a constraint.
+struct b3ConstraintParticles
+{
+	template<class T>
+	u32 operator()(const T& c, u32* is) const
+	{
+		return b3GetParticles(c, is);
+	}
+};
+
+// Sort constraints by color such that the constraints of a color don't share particles.
+template<class T>
+static void b3ColorParticleConstraints(T* constraints, u32 count, u32 particleCount, u32* offsets)
+{
+	u32* particleMasks = (u32*)b3Alloc(particleCount * sizeof(u32));
+	u8* colors = (u8*)b3Alloc(count * sizeof(u8));
+	T* sorted = (T*)b3Alloc(count * sizeof(T));
+
+	b3ConstraintParticles particles;
+	b3ColorConstraints(constraints, count, particles, particleMasks, particleCount, colors, sorted, offsets);
+
+	b3Free(sorted);
+	b3Free(colors);
+	b3Free(particleMasks);
+}
+
+// Count the wide constraints of each color.
+static u32 b3CountWideConstraints(const u32* offsets, u32* wideOffsets)
+{
+	wideOffsets[0] = 0;
+	for (u32 i = 0; i < B3_MAX_CONSTRAINT_COLORS; ++i)
+	{
+		u32 count = offsets[i + 1] - offsets[i];
+		wideOffsets[i + 1] = wideOffsets[i] + (count + B3_SIMD_WIDTH - 1) / B3_SIMD_WIDTH;
+	}
+	return wideOffsets[B3_MAX_CONSTRAINT_COLORS];
+}
+
+void b3Cloth::PackC1()
+{
+	b3ColorParticleConstraints(m_c1s, m_c1Count, m_pCount, m_c1Colors);
+	
+	u32 wideCount = b3CountWideConstraints(m_c1Colors, m_wideC1Colors);
+	m_wideC1s = (b3WideC1*)b3Alloc(wideCount * sizeof(b3WideC1));
+
+	// Unused lanes are zero.
+	memset(m_wideC1s, 0, wideCount * sizeof(b3WideC1));
+	
+	u32 wideIndex = 0;
+	for (u32 i = 0; i < B3_MAX_CONSTRAINT_COLORS; ++i)
+	{
+		for (u32 first = m_c1Colors[i]; first < m_c1Colors[i + 1]; first += B3_SIMD_WIDTH)
+		{
+			b3WideC1* wc = m_wideC1s + wideIndex;
+			++wideIndex;
 
-			for (u32 j = i + 1; j < m->triangleCount; ++j)
+			wc->laneCount = b3Min(u32(B3_SIMD_WIDTH), m_c1Colors[i + 1] - first);
+			for (u32 lane = 0; lane < wc->laneCount; ++lane)
 			{
-				b3Triangle* t2 = m->triangles + j;
-				u32 i2s[3] = { t2->v1, t2->v2, t2->v3 };
+				const b3C1* c = m_c1s + first + lane;
+				wc->L[lane] = c->L;
+				wc->i1[lane] = c->i1;
+				wc->i2[lane] = c->i2;
+			}
+		}
+	}
 
-				for (u32 j2 = 0; j2 < 3; ++j2)
-				{
-					u32 k2 = j2 + 1 < 3 ? j2 + 1 : 0;
+	B3_ASSERT(wideIndex == wideCount);
+}
 
-					u32 t2v1 = i2s[j2];
-					u32 t2v2 = i2s[k2];
+void b3Cloth::PackC2()
+{
+	b3ColorParticleConstraints(m_c2s, m_c2Count, m_pCount, m_c2Colors);
 
-					if (t1v1 == t2v2 && t1v2 == t2v1)
-					{
-						++c2Capacity;
-					}
-				}
+	u32 wideCount = b3CountWideConstraints(m_c2Colors, m_wideC2Colors);
+	m_wideC2s = (b3WideC2*)b3Alloc(wideCount * sizeof(b3WideC2));
+
+	// Unused lanes are zero.
+	memset(m_wideC2s, 0, wideCount * sizeof(b3WideC2));
+
+	u32 wideIndex = 0;
+	for (u32 i = 0; i < B3_MAX_CONSTRAINT_COLORS; ++i)
+	{
+		for (u32 first = m_c2Colors[i]; first < m_c2Colors[i + 1]; first += B3_SIMD_WIDTH)
+		{
+			b3WideC2* wc = m_wideC2s + wideIndex;
+			++wideIndex;
+
+			wc->laneCount = b3Min(u32(B3_SIMD_WIDTH), m_c2Colors[i + 1] - first);
+			for (u32 lane = 0; lane < wc->laneCount; ++lane)
+			{
+				const b3C2* c = m_c2s + first + lane;
+				wc->angle[lane] = c->angle;
+				wc->i1[lane] = c->i1;
+				wc->i2[lane] = c->i2;
+				wc->i3[lane] = c->i3;
+				wc->i4[lane] = c->i4;
 			}
 		}
 	}
 
-	m_c2Count = 0;
-	m_c2s = (b3C2*)b3Alloc(c2Capacity * sizeof(b3C2));
+	B3_ASSERT(wideIndex == wideCount);
+}
 
-	for (u32 i = 0; i < m->triangleCount; ++i)
+// Solves a range of wide stretching constraints of a color.
+struct b3SolveWideC1Task
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
 	{
-		b3Triangle* t1 = m->triangles + i;
-		u32 i1s[3] = { t1->v1, t1->v2, t1->v3 };
+		B3_NOT_USED(threadIndex);
 
-		for (u32 j1 = 0; j1 < 3; ++j1)
+		cloth->SolveWideC1(offset + begin, offset + end);
+	}
+
+	b3Cloth* cloth;
+	u32 offset;
+};
+
+// Solves a range of wide bending constraints of a color.
+struct b3SolveWideC2Task
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		cloth->SolveWideC2(offset + begin, offset + end);
+	}
+
+	b3Cloth* cloth;
+	u32 offset;
+};
+
+// Solve the wide constraints color by color. 
+template<class T>
+static void b3SolveColors(b3ThreadPool* threadPool, b3Cloth* cloth, const u32* wideOffsets)
+{
+	for (u32 i = 0; i < B3_MAX_CONSTRAINT_COLORS; ++i)
+	{
+		u32 begin = wideOffsets[i];
+		u32 count = wideOffsets[i + 1] - begin;
+		if (count == 0)
 		{
-			u32 k1 = j1 + 1 < 3 ? j1 + 1 : 0;
+			continue;
+		}
 
-			u32 t1v1 = i1s[j1];
-			u32 t1v2 = i1s[k1];
+		T task;
+		task.cloth = cloth;
+		task.offset = begin;
 
-			for (u32 j = i + 1; j < m->triangleCount; ++j)
-			{
-				b3Triangle* t2 = m->triangles + j;
-				u32 i2s[3] = { t2->v1, t2->v2, t2->v3 };
+		if (threadPool)
+		{
+			threadPool->ParallelFor(&task, count, b3_clothGrainSize);
+		}
+		else
+		{
+			task.Execute(0, count, 0);
+		}
+	}
+}
 
-				for (u32 j2 = 0; j2 < 3; ++j2)
-				{
-					u32 k2 = j2 + 1 < 3 ? j2 + 1 : 0;
+// Solves a range of particle contacts.
+struct b3SolveContactsTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		cloth->SolveContacts(begin, end);
+	}
 
-					u32 t2v1 = i2s[j2];
-					u32 t2v2 = i2s[k2];
+	b3Cloth* cloth;
+};
 
-					if (t1v1 == t2v2 && t1v2 == t2v1)
+b3AABB3 b3Cloth::UpdateProxies()
+{
+	b3AABB3 clothAABB;
+	clothAABB.m_lower = clothAABB.m_upper = m_x0[0];
+
+	for (u32 i = 0; i < m_pCount; ++i)
+	{
+		b3Sphere sphere = b3GetParticleSphere(m_x0[i], m_x[i], m_r);
+		
+		b3AABB3 aabb;
+		aabb.m_lower = aabb.m_upper = sphere.vertex;
+		aabb.Extend(sphere.radius);
+
+		clothAABB = b3Combine(clothAABB, aabb);
+
+		i32 proxyId = m_proxyIds[i];
+		if (m_tree.GetAABB(proxyId).Contains(aabb))
+		{
+			continue;
+		}
+
+		// Update the tree with a fat and motion predicted AABB.
+		b3Vec3 displacement = B3_AABB_MULTIPLIER * (m_x[i] - m_x0[i]);
+
+		b3AABB3 fatAABB = aabb;
+		fatAABB.Extend(B3_AABB_EXTENSION);
+		fatAABB.m_lower += b3Min(displacement, b3Vec3(0.0f, 0.0f, 0.0f));
+		fatAABB.m_upper += b3Max(displacement, b3Vec3(0.0f, 0.0f, 0.0f));
+
+		m_tree.UpdateNode(proxyId, fatAABB);
+	}
+
+	return clothAABB;
+}
+
+// Reports the particles overlapping a shape.
+struct b3ClothParticleQuery
+{
+	bool Report(i32 proxyId)
+	{
+		// The proxy user data is the particle position.
+		i32* id = (i32*)cloth->m_tree.GetUserData(proxyId);
+		u32 particle = u32(id - cloth->m_proxyIds);
+		if (cloth->m_im[particle] > 0.0f)
+		{
+			cloth->AddContact(particle, shape);
+		}
+		return true;
+	}
+
+	b3Cloth* cloth;
+	const b3Shape* shape;
+};
+
+// Reports the shapes overlapping the cloth.
+class b3ClothShapeQuery : public b3QueryListener
+{
+public:
+	bool ReportShape(b3Shape* shape)
+	{
+		if (shape->IsSensor())
+		{
+			return true;
+		}
+
+		b3AABB3 aabb;
+		shape->ComputeAABB(&aabb, shape->GetBody()->GetTransform());
+
+		b3ClothParticleQuery query;
+		query.cloth = cloth;
+		query.shape = shape;
+		cloth->m_tree.QueryAABB(&query, aabb);
+		
+		return true;
+	}
+
+	b3Cloth* cloth;
+};
+
+void b3Cloth::AddContact(u32 particle, const b3Shape* shape)
+{
+	b3Vec3 x0 = m_x0[particle];
+	b3Vec3 x = m_x[particle];
+
+	b3Sphere sphere = b3GetParticleSphere(x0, x, m_r);
+
+	b3SphereManifold manifold;
+	if (shape->CollideSphere(&manifold, sphere, shape->GetBody()->GetTransform()) == false)
+	{
+		return;
+	}
+
+	float32 separation = b3Dot(manifold.normal, x - manifold.point);
+
+	u32 index = m_particleContacts[particle];
+	if (index == B3_NULL_CLOTH_CONTACT)
+	{
+		index = m_contactCount;
+		++m_contactCount;
+		m_particleContacts[particle] = index;
+	}
+	else
+	{
+		// Keep the deepest contact.
+		const b3ClothContact* c = m_contacts + index;
+		if (b3Dot(c->normal, x - c->point) <= separation)
+		{
+			return;
+		}
+	}
+
+	b3ClothContact* c = m_contacts + index;
+	c->p = particle;
+	c->point = manifold.point;
+	c->normal = manifold.normal;
+	c->friction = shape->GetFriction();
+}
+
+void b3Cloth::UpdateContacts()
+{
+	for (u32 i = 0; i < m_contactCount; ++i)
+	{
+		m_particleContacts[m_contacts[i].p] = B3_NULL_CLOTH_CONTACT;
+	}
+	m_contactCount = 0;
+
+	b3AABB3 aabb = UpdateProxies();
+
+	b3ClothShapeQuery query;
+	query.cloth = this;
+	m_world->QueryAABB(&query, aabb);
+}
+
+void b3Cloth::SolveContacts(u32 begin, u32 end)
+{
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3ClothContact* c = m_contacts + i;
+
+		b3Vec3& x = m_x[c->p];
+		
+		float32 C = b3Dot(c->normal, x - c->point) - m_r;
+		if (C >= 0.0f)
+		{
+			continue;
+		}
+
+		// Push the particle out of the shape.
+		x -= C * c->normal;
+
+		// Remove the tangential motion if it is inside the friction cone, 
+		// otherwise reduce it by the friction bound.
+		b3Vec3 dx = x - m_x0[c->p];
+		b3Vec3 dt = dx - b3Dot(dx, c->normal) * c->normal;
+		float32 lt = b3Length(dt);
+		
+		float32 maxFriction = -c->friction * C;
+		if (lt <= maxFriction)
+		{
+			x -= dt;
+		}
+		else
+		{
+			x -= (maxFriction / lt) * dt;
+		}
+	}
+}
+
+// Get the grid cell containing a point.
+static inline void b3GetCell(i32* cell, const b3Vec3& p, float32 invCellSize)
+{
+	cell[0] = i32(floor(invCellSize * p.x));
+	cell[1] = i32(floor(invCellSize * p.y));
+	cell[2] = i32(floor(invCellSize * p.z));
+}
+
+// Hash a grid cell.
+static inline u32 b3HashCell(i32 x, i32 y, i32 z, u32 mask)
+{
+	u32 h = (u32(x) * 92837111) ^ (u32(y) * 689287499) ^ (u32(z) * 283923481);
+	return h & mask;
+}
+
+void b3Cloth::BuildHash()
+{
+	float32 invCellSize = 1.0f / m_cellSize;
+	u32 mask = m_hashSize - 1;
+
+	// Count the particles in each bucket.
+	memset(m_hashBuckets, 0, (m_hashSize + 1) * sizeof(u32));
+	for (u32 i = 0; i < m_pCount; ++i)
+	{
+		i32 cell[3];
+		b3GetCell(cell, m_x[i], invCellSize);
+		++m_hashBuckets[b3HashCell(cell[0], cell[1], cell[2], mask)];
+	}
+
+	// Find the end of each bucket.
+	for (u32 i = 1; i <= m_hashSize; ++i)
+	{
+		m_hashBuckets[i] += m_hashBuckets[i - 1];
+	}
+
+	// Fill the buckets backwards, so each bucket offset ends at the bucket begin.
+	for (u32 i = 0; i < m_pCount; ++i)
+	{
+		i32 cell[3];
+		b3GetCell(cell, m_x[i], invCellSize);
+		u32 bucket = b3HashCell(cell[0], cell[1], cell[2], mask);
+		u32 index = --m_hashBuckets[bucket];
+		m_hashParticles[index] = i;
+		m_hashPositions[index] = m_x[i];
+	}
+}
+
+// Add a pair to a pair buffer.
+static inline void b3AddPair(b3ClothPairBuffer* buffer, u64 key)
+{
+	// Check capacity.
+	if (buffer->count == buffer->capacity)
+	{
+		// Duplicate capacity.
+		buffer->capacity = b3Max(2 * buffer->capacity, 64u);
+
+		u64* oldKeys = buffer->keys;
+		buffer->keys = (u64*)b3Alloc(buffer->capacity * sizeof(u64));
+		if (oldKeys)
+		{
+			memcpy(buffer->keys, oldKeys, buffer->count * sizeof(u64));
+			b3Free(oldKeys);
+		}
+	}
+
+	buffer->keys[buffer->count] = key;
+	++buffer->count;
+}
+
+void b3Cloth::FindSelfPairs(u32 begin, u32 end, b3ClothPairBuffer* buffer) const
+{
+	float32 invCellSize = 1.0f / m_cellSize;
+	u32 mask = m_hashSize - 1;
+
+	// The particles and the triangles have radius r.
+	// The pairs closer than twice the thickness are kept, so the particles 
+	// that approach the triangles during the iterations are caught.
+	float32 distance = 4.0f * m_r;
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		const b3Triangle* t = m_mesh->triangles + i;
+		u32 v1 = t->v1;
+		u32 v2 = t->v2;
+		u32 v3 = t->v3;
+
+		bool staticTriangle = m_im[v1] == 0.0f && m_im[v2] == 0.0f && m_im[v3] == 0.0f;
+
+		b3Vec3 x1 = m_x[v1];
+		b3Vec3 x2 = m_x[v2];
+		b3Vec3 x3 = m_x[v3];
+
+		// The whole cloth can move fast. Therefore, the triangle motion isn't enclosed. 
+		// The relative motion of the particles is assumed to be small.
+		b3AABB3 aabb;
+		aabb.m_lower = b3Min(b3Min(x1, x2), x3);
+		aabb.m_upper = b3Max(b3Max(x1, x2), x3);
+		aabb.Extend(distance);
+
+		// Precompute the terms of the barycentric coordinates 
+		// shared by the candidate particles.
+		b3Vec3 e1 = x2 - x1;
+		b3Vec3 e2 = x3 - x1;
+		
+		float32 d11 = b3Dot(e1, e1);
+		float32 d12 = b3Dot(e1, e2);
+		float32 d22 = b3Dot(e2, e2);
+		
+		float32 divisor = d11 * d22 - d12 * d12;
+		if (divisor <= B3_EPSILON * B3_EPSILON)
+		{
+			continue;
+		}
+
+		b3Vec3 n = b3Cross(e1, e2);
+		float32 maxDistance = distance * b3Length(n);
+
+		i32 lower[3], upper[3];
+		b3GetCell(lower, aabb.m_lower, invCellSize);
+		b3GetCell(upper, aabb.m_upper, invCellSize);
+
+		for (i32 x = lower[0]; x <= upper[0]; ++x)
+		{
+			for (i32 y = lower[1]; y <= upper[1]; ++y)
+			{
+				for (i32 z = lower[2]; z <= upper[2]; ++z)
+				{
+					u32 bucket = b3HashCell(x, y, z, mask);
+					for (u32 j = m_hashBuckets[bucket]; j < m_hashBuckets[bucket + 1]; ++j)
 					{
-						u32 k3 = k1 + 1 < 3 ? k1 + 1 : 0;
-						u32 t1v3 = i1s[k3];
-
-						u32 k4 = k2 + 1 < 3 ? k2 + 1 : 0;
-						u32 t2v3 = i2s[k4];
-
-						b3Vec3 p1 = m->vertices[t1v1];
-						b3Vec3 p2 = m->vertices[t1v2];
-						b3Vec3 p3 = m->vertices[t1v3];
-						b3Vec3 p4 = m->vertices[t2v3];
-
-						b3Vec3 n1 = b3Cross(p2 - p1, p3 - p1);
-						n1.Normalize();
-						
-						b3Vec3 n2 = b3Cross(p2 - p1, p4 - p1);
-						n2.Normalize();
-						
-						float32 x = b3Dot(n1, n2);
-
-						b3Vec3 n3 = b3Cross(n1, n2);
-						float32 y = b3Length(n3);
-
-						b3C2* c = m_c2s + m_c2Count;
-						c->i1 = t1v1;
-						c->i2 = t1v2;
-						c->i3 = t1v3;
-						c->i4 = t2v3;
-						c->angle = atan2(y, x);
-						
-						++m_c2Count;
-
-						break;
+						// The positions are contiguous in a bucket.
+						const b3Vec3& xp = m_hashPositions[j];
+						if (aabb.Contains(xp) == false)
+						{
+							continue;
+						}
+
+						// Is the particle close to the triangle plane?
+						b3Vec3 dp = xp - x1;
+						if (b3Abs(b3Dot(n, dp)) > maxDistance)
+						{
+							continue;
+						}
+
+						// Is the particle projection on the triangle?
+						// The coordinates are scaled by the divisor.
+						float32 dp1 = b3Dot(dp, e1);
+						float32 dp2 = b3Dot(dp, e2);
+						float32 v = d22 * dp1 - d12 * dp2;
+						float32 w = d11 * dp2 - d12 * dp1;
+						if (v < 0.0f || w < 0.0f || v + w > divisor)
+						{
+							continue;
+						}
+
+						u32 p = m_hashParticles[j];
+						if (p == v1 || p == v2 || p == v3)
+						{
+							continue;
+						}
+
+						if (staticTriangle && m_im[p] == 0.0f)
+						{
+							continue;
+						}
+
+						// Skip the particles of other cells in the bucket.
+						// This also reports each pair once.
+						i32 cell[3];
+						b3GetCell(cell, xp, invCellSize);
+						if (cell[0] != x || cell[1] != y || cell[2] != z)
+						{
+							continue;
+						}
+
+						b3AddPair(buffer, (u64(i) << 32) | u64(p));
 					}
 				}
 			}
 		}
 	}
+}
 
-	m_k1 = def.k1;
-	m_k2 = def.k2;
-	m_kd = def.kd;
-	m_r = def.r;
-	m_gravity = def.gravity;
+// Finds the self-contact pairs of a range of triangles.
+struct b3FindSelfPairsTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		cloth->FindSelfPairs(begin, end, cloth->m_threadPairs + threadIndex);
+	}
+
+	b3Cloth* cloth;
+};
+
+void b3Cloth::UpdateSelfContacts(b3ThreadPool* threadPool)
+{
+	BuildHash();
+
+	b3FindSelfPairsTask task;
+	task.cloth = this;
+	
+	u32 triangleCount = m_mesh->triangleCount;
+	u32 threadCount = 1;
+	if (threadPool)
+	{
+		threadCount = threadPool->GetThreadCount();
+		threadPool->ParallelFor(&task, triangleCount, b3_clothTriangleGrainSize);
+	}
+	else
+	{
+		task.Execute(0, triangleCount, 0);
+	}
+
+	// Merge the pair buffers.
+	u32 pairCount = 0;
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		pairCount += m_threadPairs[i].count;
+	}
+
+	if (pairCount > m_pairCapacity)
+	{
+		// The buffers are kept for the next steps.
+		m_pairCapacity = b3Max(pairCount, 2 * m_pairCapacity);
+
+		b3Free(m_pairs);
+		b3Free(m_sortPairs);
+		m_pairs = (u64*)b3Alloc(m_pairCapacity * sizeof(u64));
+		m_sortPairs = (u64*)b3Alloc(m_pairCapacity * sizeof(u64));
+
+		b3Free(m_selfContacts);
+		m_selfContactCapacity = m_pairCapacity;
+		m_selfContacts = (b3ClothSelfContact*)b3Alloc(m_selfContactCapacity * sizeof(b3ClothSelfContact));
+	}
+
+	u32 count = 0;
+	for (u32 i = 0; i < threadCount; ++i)
+	{
+		b3ClothPairBuffer* buffer = m_threadPairs + i;
+		if (buffer->count > 0)
+		{
+			memcpy(m_pairs + count, buffer->keys, buffer->count * sizeof(u64));
+			count += buffer->count;
+			buffer->count = 0;
+		}
+	}
+
+	// The pairs of a triangle are found by a single thread.
+	// Therefore, a stable sort by triangle gives the same contact order 
+	// for any number of threads.
+	b3SortKeys(m_pairs, m_sortPairs, pairCount);
+
+	m_selfContactCount = pairCount;
+	for (u32 i = 0; i < pairCount; ++i)
+	{
+		u32 p = u32(m_pairs[i]);
+		u32 t = u32(m_pairs[i] >> 32);
+
+		const b3Triangle* triangle = m_mesh->triangles + t;
+
+		// Keep the particle on the side of the triangle it was 
+		// at the beginning of the step.
+		b3Vec3 x1 = m_x0[triangle->v1];
+		b3Vec3 x2 = m_x0[triangle->v2];
+		b3Vec3 x3 = m_x0[triangle->v3];
+
+		b3Vec3 n = b3Cross(x2 - x1, x3 - x1);
+
+		b3ClothSelfContact* c = m_selfContacts + i;
+		c->p = p;
+		c->t = t;
+		c->side = b3Dot(n, m_x0[p] - x1) >= 0.0f ? 1.0f : -1.0f;
+	}
 }
 
-void b3Cloth::Step(float32 h, u32 iterations)
+void b3Cloth::SolveSelfContacts()
+{
+	float32 thickness = 2.0f * m_r;
+
+	for (u32 i = 0; i < m_selfContactCount; ++i)
+	{
+		b3ClothSelfContact* c = m_selfContacts + i;
+		const b3Triangle* t = m_mesh->triangles + c->t;
+
+		b3Vec3& x1 = m_x[t->v1];
+		b3Vec3& x2 = m_x[t->v2];
+		b3Vec3& x3 = m_x[t->v3];
+		b3Vec3& x4 = m_x[c->p];
+
+		// The neighbour triangles handle the particles outside this triangle.
+		float32 wABC[4];
+		b3BarycentricCoordinates(wABC, x1, x2, x3, x4);
+		if (wABC[3] <= B3_EPSILON * B3_EPSILON)
+		{
+			continue;
+		}
+
+		if (wABC[0] < 0.0f || wABC[1] < 0.0f || wABC[2] < 0.0f)
+		{
+			continue;
+		}
+
+		float32 len = b3Sqrt(wABC[3]);
+		b3Vec3 n = (c->side / len) * b3Cross(x2 - x1, x3 - x1);
+
+		float32 C = b3Dot(n, x4 - x1) - thickness;
+		if (C >= 0.0f)
+		{
+			continue;
+		}
+
+		float32 s = 1.0f / wABC[3];
+		float32 u = s * wABC[0];
+		float32 v = s * wABC[1];
+		float32 w = s * wABC[2];
+
+		float32 m1 = m_im[t->v1];
+		float32 m2 = m_im[t->v2];
+		float32 m3 = m_im[t->v3];
+		float32 m4 = m_im[c->p];
+
+		// J4 = n, J1 = -u * n, J2 = -v * n, J3 = -w * n
+		float32 mass = m4 + u * u * m1 + v * v * m2 + w * w * m3;
+		if (mass == 0.0f)
+		{
+			continue;
+		}
+
+		float32 impulse = -C / mass;
+
+		x1 -= (m1 * impulse * u) * n;
+		x2 -= (m2 * impulse * v) * n;
+		x3 -= (m3 * impulse * w) * n;
+		x4 += (m4 * impulse) * n;
+	}
+}
+
+void b3Cloth::Step(float32 h, u32 iterations, b3ThreadPool* threadPool)
 {
 	if (h == 0.0f)
 	{
@@ -227,40 +1169,86 @@ void b3Cloth::Step(float32 h, u32 iterations)
 
 	for (u32 i = 0; i < m_pCount; ++i)
 	{
-		b3Particle* p = m_ps + i;
+		m_v[i] += h * m_im[i] * m_gravity;
+		m_v[i] *= d;
 
-		p->v += h * p->im * m_gravity;
-		p->v *= d;
+		m_x0[i] = m_x[i];
+		m_x[i] += h * m_v[i];
+	}
 
-		p->p0 = p->p;
-		p->p += h * p->v;
+	if (m_world)
+	{
+		UpdateContacts();
+	}
+
+	if (m_selfCollision)
+	{
+		UpdateSelfContacts(threadPool);
 	}
 
 	for (u32 i = 0; i < iterations; ++i)
 	{
-		SolveC2();
-		SolveC1();
+		// The constraints that couldn't be colored are solved last.
+		b3SolveColors<b3SolveWideC2Task>(threadPool, this, m_wideC2Colors);
+		SolveC2(m_c2Colors[B3_MAX_CONSTRAINT_COLORS], m_c2Colors[B3_MAX_CONSTRAINT_COLORS + 1]);
+		
+		b3SolveColors<b3SolveWideC1Task>(threadPool, this, m_wideC1Colors);
+		SolveC1(m_c1Colors[B3_MAX_CONSTRAINT_COLORS], m_c1Colors[B3_MAX_CONSTRAINT_COLORS + 1]);
+
+		// The self-contacts share particles. Therefore, they are solved serially.
+		SolveSelfContacts();
+
+		// Each particle has at most one contact. 
+		// Therefore, the contacts can be solved in parallel.
+		if (threadPool && m_contactCount > 0)
+		{
+			b3SolveContactsTask task;
+			task.cloth = this;
+			threadPool->ParallelFor(&task, m_contactCount, b3_clothContactGrainSize);
+		}
+		else
+		{
+			SolveContacts(0, m_contactCount);
+		}
 	}
 
 	float32 inv_h = 1.0f / h;
 	for (u32 i = 0; i < m_pCount; ++i)
 	{
-		b3Particle* p = m_ps + i;
-		p->v = inv_h * (p->p - p->p0);
+		m_v[i] = inv_h * (m_x[i] - m_x0[i]);
 	}
+
+	if (m_pCount > 0)
+	{
+		m_aabb.Compute(m_x, m_pCount);
+	}
+}
+
+void b3Cloth::SetAwake(bool flag)
+{
+	if (flag == false)
+	{
+		for (u32 i = 0; i < m_pCount; ++i)
+		{
+			m_v[i].SetZero();
+		}
+	}
+
+	m_awake = flag;
+	m_sleepTime = 0.0f;
 }
 
-void b3Cloth::SolveC1()
+void b3Cloth::SolveC1(u32 begin, u32 end)
 {
-	for (u32 i = 0; i < m_c1Count; ++i)
+	for (u32 i = begin; i < end; ++i)
 	{
 		b3C1* c = m_c1s + i;
 		
-		b3Particle* p1 = m_ps + c->i1;
-		b3Particle* p2 = m_ps + c->i2;
+		b3Vec3& x1 = m_x[c->i1];
+		b3Vec3& x2 = m_x[c->i2];
 
-		float32 m1 = p1->im;
-		float32 m2 = p2->im;
+		float32 m1 = m_im[c->i1];
+		float32 m2 = m_im[c->i2];
 
 		float32 mass = m1 + m2;
 		if (mass == 0.0f)
@@ -270,7 +1258,7 @@ void b3Cloth::SolveC1()
 
 		mass = 1.0f / mass;
 
-		b3Vec3 J2 = p2->p - p1->p;
+		b3Vec3 J2 = x2 - x1;
 		float32 L = b3Length(J2);
 		if (L > B3_EPSILON)
 		{
@@ -282,30 +1270,30 @@ void b3Cloth::SolveC1()
 		float32 C = L - c->L;
 		float32 impulse = -m_k1 * mass * C;
 
-		p1->p += (m1 * impulse) * J1;
-		p2->p += (m2 * impulse) * J2;
+		x1 += (m1 * impulse) * J1;
+		x2 += (m2 * impulse) * J2;
 	}
 }
 
-void b3Cloth::SolveC2()
+void b3Cloth::SolveC2(u32 begin, u32 end)
 {
-	for (u32 i = 0; i < m_c2Count; ++i)
+	for (u32 i = begin; i < end; ++i)
 	{
 		b3C2* c = m_c2s + i;
 
-		b3Particle* p1 = m_ps + c->i1;
-		b3Particle* p2 = m_ps + c->i2;
-		b3Particle* p3 = m_ps + c->i3;
-		b3Particle* p4 = m_ps + c->i4;
+		b3Vec3& x1 = m_x[c->i1];
+		b3Vec3& x2 = m_x[c->i2];
+		b3Vec3& x3 = m_x[c->i3];
+		b3Vec3& x4 = m_x[c->i4];
 
-		float32 m1 = p1->im;
-		float32 m2 = p2->im;
-		float32 m3 = p3->im;
-		float32 m4 = p4->im;
+		float32 m1 = m_im[c->i1];
+		float32 m2 = m_im[c->i2];
+		float32 m3 = m_im[c->i3];
+		float32 m4 = m_im[c->i4];
 
-		b3Vec3 v2 = p2->p - p1->p;
-		b3Vec3 v3 = p3->p - p1->p;
-		b3Vec3 v4 = p4->p - p1->p;
+		b3Vec3 v2 = x2 - x1;
+		b3Vec3 v3 = x3 - x1;
+		b3Vec3 v4 = x4 - x1;
 		
 		b3Vec3 n1 = b3Cross(v2, v3);
 		n1.Normalize();
@@ -345,8 +1333,10 @@ void b3Cloth::SolveC2()
 		
 		b3Vec3 J1 = -J2 - J3 - J4;
 
+		// The gradients vanish when the triangles are flat. 
+		// Skip the constraint instead of dividing by a vanishing mass.
 		float32 mass = m1 * b3Dot(J1, J1) + m2 * b3Dot(J2, J2) + m3 * b3Dot(J3, J3) + m4 * b3Dot(J4, J4);
-		if (mass == 0.0f)
+		if (mass <= B3_EPSILON)
 		{
 			continue;
 		}
@@ -361,10 +1351,159 @@ void b3Cloth::SolveC2()
 
 		float32 impulse = -m_k2 * mass * y * C;
 
-		p1->p += (m1 * impulse) * J1;
-		p2->p += (m2 * impulse) * J2;
-		p3->p += (m3 * impulse) * J3;
-		p4->p += (m4 * impulse) * J4;
+		x1 += (m1 * impulse) * J1;
+		x2 += (m2 * impulse) * J2;
+		x3 += (m3 * impulse) * J3;
+		x4 += (m4 * impulse) * J4;
+	}
+}
+
+// Gather the positions and inverse masses of the particles in the lanes.
+// Unused lanes are zero.
+static inline void b3GatherParticles(b3Vec3W& xw, b3FloatW& mw, 
+	const b3Vec3* x, const float32* im, const u32* indices, u32 laneCount)
+{
+	float32 lanes[4][B3_SIMD_WIDTH];
+	memset(lanes, 0, sizeof(lanes));
+	for (u32 lane = 0; lane < laneCount; ++lane)
+	{
+		u32 index = indices[lane];
+		lanes[0][lane] = x[index].x;
+		lanes[1][lane] = x[index].y;
+		lanes[2][lane] = x[index].z;
+		lanes[3][lane] = im[index];
+	}
+
+	xw.x.Load(lanes[0]);
+	xw.y.Load(lanes[1]);
+	xw.z.Load(lanes[2]);
+	mw.Load(lanes[3]);
+}
+
+// Scatter the positions of the particles in the used lanes.
+static inline void b3ScatterParticles(b3Vec3* x, const b3Vec3W& xw, const u32* indices, u32 laneCount)
+{
+	float32 lanes[3][B3_SIMD_WIDTH];
+	xw.x.Store(lanes[0]);
+	xw.y.Store(lanes[1]);
+	xw.z.Store(lanes[2]);
+	for (u32 lane = 0; lane < laneCount; ++lane)
+	{
+		x[indices[lane]].Set(lanes[0][lane], lanes[1][lane], lanes[2][lane]);
+	}
+}
+
+// Return 1 / a where a > B3_EPSILON and b otherwise.
+static inline b3FloatW b3SafeInverse(const b3FloatW& a, const b3FloatW& b)
+{
+	const b3FloatW epsilon(B3_EPSILON);
+	const b3FloatW one(1.0f);
+	b3FloatW mask = a > epsilon;
+	return b3Select(mask, one / b3Select(mask, a, one), b);
+}
+
+void b3Cloth::SolveWideC1(u32 begin, u32 end)
+{
+	const b3FloatW zero(0.0f);
+	const b3FloatW one(1.0f);
+	const b3FloatW k1(m_k1);
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		const b3WideC1* wc = m_wideC1s + i;
+		u32 laneCount = wc->laneCount;
+
+		b3Vec3W x1, x2;
+		b3FloatW m1, m2;
+		b3GatherParticles(x1, m1, m_x, m_im, wc->i1, laneCount);
+		b3GatherParticles(x2, m2, m_x, m_im, wc->i2, laneCount);
+
+		b3FloatW L0;
+		L0.Load(wc->L);
+
+		b3FloatW mass = m1 + m2;
+		mass = b3Select(mass > zero, one / b3Select(mass > zero, mass, one), zero);
+
+		b3Vec3W J2 = x2 - x1;
+		b3FloatW L = b3Sqrt(b3Dot(J2, J2));
+		J2 = b3SafeInverse(L, one) * J2;
+
+		b3FloatW C = L - L0;
+		b3FloatW impulse = -k1 * mass * C;
+
+		x1 -= (m1 * impulse) * J2;
+		x2 += (m2 * impulse) * J2;
+
+		b3ScatterParticles(m_x, x1, wc->i1, laneCount);
+		b3ScatterParticles(m_x, x2, wc->i2, laneCount);
+	}
+}
+
+void b3Cloth::SolveWideC2(u32 begin, u32 end)
+{
+	const b3FloatW zero(0.0f);
+	const b3FloatW one(1.0f);
+	const b3FloatW k2(m_k2);
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		const b3WideC2* wc = m_wideC2s + i;
+		u32 laneCount = wc->laneCount;
+
+		b3Vec3W x1, x2, x3, x4;
+		b3FloatW m1, m2, m3, m4;
+		b3GatherParticles(x1, m1, m_x, m_im, wc->i1, laneCount);
+		b3GatherParticles(x2, m2, m_x, m_im, wc->i2, laneCount);
+		b3GatherParticles(x3, m3, m_x, m_im, wc->i3, laneCount);
+		b3GatherParticles(x4, m4, m_x, m_im, wc->i4, laneCount);
+
+		b3Vec3W v2 = x2 - x1;
+		b3Vec3W v3 = x3 - x1;
+		b3Vec3W v4 = x4 - x1;
+
+		b3Vec3W n1 = b3Cross(v2, v3);
+		b3FloatW L3 = b3Sqrt(b3Dot(n1, n1));
+		b3FloatW inv3 = b3SafeInverse(L3, one);
+		n1 = inv3 * n1;
+
+		b3Vec3W n2 = b3Cross(v2, v4);
+		b3FloatW L4 = b3Sqrt(b3Dot(n2, n2));
+		b3FloatW inv4 = b3SafeInverse(L4, one);
+		n2 = inv4 * n2;
+
+		b3FloatW x = b3Dot(n1, n2);
+
+		b3Vec3W J3 = inv3 * (b3Cross(v2, n2) + x * b3Cross(n1, v2));
+		b3Vec3W J4 = inv4 * (b3Cross(v2, n1) + x * b3Cross(n2, v2));
+		
+		b3Vec3W J2_1 = inv3 * (b3Cross(v3, n2) + x * b3Cross(n1, v3));
+		b3Vec3W J2_2 = inv4 * (b3Cross(v4, n1) + x * b3Cross(n2, v4));
+
+		b3Vec3W J2 = -J2_1 - J2_2;
+		b3Vec3W J1 = -J2 - J3 - J4;
+
+		b3FloatW mass = m1 * b3Dot(J1, J1) + m2 * b3Dot(J2, J2) + m3 * b3Dot(J3, J3) + m4 * b3Dot(J4, J4);
+		mass = b3SafeInverse(mass, zero);
+
+		b3Vec3W n3 = b3Cross(n1, n2);
+		b3FloatW y = b3Sqrt(b3Dot(n3, n3));
+
+		b3FloatW angle0;
+		angle0.Load(wc->angle);
+
+		b3FloatW C = b3Atan2(y, x) - angle0;
+
+		b3FloatW impulse = -k2 * mass * y * C;
+
+		x1 += (m1 * impulse) * J1;
+		x2 += (m2 * impulse) * J2;
+		x3 += (m3 * impulse) * J3;
+		x4 += (m4 * impulse) * J4;
+
+		b3ScatterParticles(m_x, x1, wc->i1, laneCount);
+		b3ScatterParticles(m_x, x2, wc->i2, laneCount);
+		b3ScatterParticles(m_x, x3, wc->i3, laneCount);
+		b3ScatterParticles(m_x, x4, wc->i4, laneCount);
 	}
 }
 
@@ -381,13 +1520,9 @@ void b3Cloth::Draw(b3Draw* draw) const
 	{
 		b3Triangle* t = m->triangles + i;
 
-		b3Particle* p1 = m_ps + t->v1;
-		b3Particle* p2 = m_ps + t->v2;
-		b3Particle* p3 = m_ps + t->v3;
-
-		b3Vec3 v1 = p1->p;
-		b3Vec3 v2 = p2->p;
-		b3Vec3 v3 = p3->p;
+		b3Vec3 v1 = m_x[t->v1];
+		b3Vec3 v2 = m_x[t->v2];
+		b3Vec3 v3 = m_x[t->v3];
 
 		b3Vec3 n1 = b3Cross(v2 - v1, v3 - v1);
 		n1.Normalize();
@@ -0,0 +1,326 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/dynamics/cloth/cloth_system.h>
+#include <bounce/collision/shapes/mesh.h>
+#include <bounce/dynamics/world.h>
+#include <bounce/dynamics/world_listeners.h>
+#include <bounce/dynamics/body.h>
+#include <bounce/dynamics/shapes/shape.h>
+
+b3ClothSystem::b3ClothSystem() : m_clothBlocks(sizeof(b3Cloth))
+{
+	m_sleeping = false;
+	m_particleCount = 0;
+	m_particleCapacity = 0;
+	m_x = NULL;
+	m_x0 = NULL;
+	m_v = NULL;
+	m_im = NULL;
+	m_stepCloths = NULL;
+	m_stepCapacity = 0;
+}
+
+b3ClothSystem::~b3ClothSystem()
+{
+	b3Cloth* c = m_clothList.m_head;
+	while (c)
+	{
+		b3Cloth* c0 = c;
+		c = c->m_next;
+		c0->~b3Cloth();
+	}
+
+	b3Free(m_x);
+	b3Free(m_x0);
+	b3Free(m_v);
+	b3Free(m_im);
+	b3Free(m_stepCloths);
+}
+
+void b3ClothSystem::SetThreadCount(u32 count)
+{
+	B3_ASSERT(count > 0);
+	count = b3Min(count, b3_maxThreads);
+	if (count == m_threadPool.GetThreadCount())
+	{
+		return;
+	}
+	m_threadPool.SetThreadCount(count);
+}
+
+void b3ClothSystem::SetSleeping(bool flag)
+{
+	m_sleeping = flag;
+	if (m_sleeping == false)
+	{
+		for (b3Cloth* c = m_clothList.m_head; c; c = c->m_next)
+		{
+			c->SetAwake(true);
+		}
+	}
+}
+
+void b3ClothSystem::ReserveParticles(u32 count)
+{
+	if (count <= m_particleCapacity)
+	{
+		return;
+	}
+
+	u32 capacity = b3Max(count, 2 * m_particleCapacity);
+
+	b3Vec3* x = (b3Vec3*)b3Alloc(capacity * sizeof(b3Vec3));
+	b3Vec3* x0 = (b3Vec3*)b3Alloc(capacity * sizeof(b3Vec3));
+	b3Vec3* v = (b3Vec3*)b3Alloc(capacity * sizeof(b3Vec3));
+	float32* im = (float32*)b3Alloc(capacity * sizeof(float32));
+
+	if (m_particleCount > 0)
+	{
+		memcpy(x, m_x, m_particleCount * sizeof(b3Vec3));
+		memcpy(x0, m_x0, m_particleCount * sizeof(b3Vec3));
+		memcpy(v, m_v, m_particleCount * sizeof(b3Vec3));
+		memcpy(im, m_im, m_particleCount * sizeof(float32));
+	}
+
+	b3Free(m_x);
+	b3Free(m_x0);
+	b3Free(m_v);
+	b3Free(m_im);
+
+	m_x = x;
+	m_x0 = x0;
+	m_v = v;
+	m_im = im;
+	m_particleCapacity = capacity;
+
+	RebaseCloths();
+}
+
+void b3ClothSystem::RebaseCloths()
+{
+	for (b3Cloth* c = m_clothList.m_head; c; c = c->m_next)
+	{
+		u32 offset = c->m_particleOffset;
+		c->m_x = m_x + offset;
+		c->m_x0 = m_x0 + offset;
+		c->m_v = m_v + offset;
+		c->m_im = m_im + offset;
+	}
+}
+
+b3Cloth* b3ClothSystem::CreateCloth(const b3ClothDef& def)
+{
+	B3_ASSERT(def.mesh);
+	u32 offset = m_particleCount;
+	ReserveParticles(m_particleCount + def.mesh->vertexCount);
+	m_particleCount += def.mesh->vertexCount;
+
+	void* mem = m_clothBlocks.Allocate();
+	b3Cloth* c = new(mem) b3Cloth();
+	c->m_system = this;
+	c->m_particleOffset = offset;
+	c->Initialize(def, m_x + offset, m_x0 + offset, m_v + offset, m_im + offset);
+	m_clothList.PushFront(c);
+
+	if (m_clothList.m_count > m_stepCapacity)
+	{
+		b3Free(m_stepCloths);
+		m_stepCapacity = b3Max(m_clothList.m_count, 2 * m_stepCapacity);
+		m_stepCloths = (b3Cloth**)b3Alloc(m_stepCapacity * sizeof(b3Cloth*));
+	}
+
+	return c;
+}
+
+void b3ClothSystem::DestroyCloth(b3Cloth* c)
+{
+	B3_ASSERT(c->m_system == this);
+
+	// Move the particles of the following cloths over the particles of the cloth.
+	u32 offset = c->m_particleOffset;
+	u32 count = c->m_pCount;
+	u32 tailCount = m_particleCount - offset - count;
+
+	memmove(m_x + offset, m_x + offset + count, tailCount * sizeof(b3Vec3));
+	memmove(m_x0 + offset, m_x0 + offset + count, tailCount * sizeof(b3Vec3));
+	memmove(m_v + offset, m_v + offset + count, tailCount * sizeof(b3Vec3));
+	memmove(m_im + offset, m_im + offset + count, tailCount * sizeof(float32));
+	
+	m_particleCount -= count;
+
+	m_clothList.Remove(c);
+	c->~b3Cloth();
+	m_clothBlocks.Free(c);
+
+	for (b3Cloth* c2 = m_clothList.m_head; c2; c2 = c2->m_next)
+	{
+		if (c2->m_particleOffset > offset)
+		{
+			c2->m_particleOffset -= count;
+		}
+	}
+
+	RebaseCloths();
+}
+
+// Find if an awake body overlaps the AABB of a sleeping cloth.
+class b3ClothWakeQuery : public b3QueryListener
+{
+public:
+	bool ReportShape(b3Shape* shape)
+	{
+		b3Body* body = shape->GetBody();
+		if (body->GetType() != e_staticBody && body->IsAwake())
+		{
+			wake = true;
+			return false;
+		}
+		return true;
+	}
+
+	bool wake;
+};
+
+bool b3ClothSystem::ShouldWake(const b3Cloth* c) const
+{
+	if (c->m_world == NULL)
+	{
+		return false;
+	}
+
+	b3AABB3 aabb = c->m_aabb;
+	aabb.Extend(c->m_r);
+
+	b3ClothWakeQuery query;
+	query.wake = false;
+	c->m_world->QueryAABB(&query, aabb);
+	return query.wake;
+}
+
+void b3ClothSystem::StepCloth(b3Cloth* c, float32 dt, u32 iterations, b3ThreadPool* threadPool)
+{
+	c->Step(dt, iterations, threadPool);
+
+	if (m_sleeping == false || dt == 0.0f)
+	{
+		return;
+	}
+
+	const float32 linTolSqr = B3_SLEEP_LINEAR_TOL * B3_SLEEP_LINEAR_TOL;
+
+	float32 maxSpeedSqr = 0.0f;
+	for (u32 i = 0; i < c->m_pCount; ++i)
+	{
+		maxSpeedSqr = b3Max(maxSpeedSqr, b3LengthSquared(c->m_v[i]));
+	}
+
+	if (maxSpeedSqr > linTolSqr)
+	{
+		c->m_sleepTime = 0.0f;
+		return;
+	}
+
+	c->m_sleepTime += dt;
+	if (c->m_sleepTime >= B3_TIME_TO_SLEEP)
+	{
+		c->SetAwake(false);
+	}
+}
+
+struct b3StepClothsTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			system->StepCloth(cloths[i], dt, iterations, NULL);
+		}
+	}
+
+	b3ClothSystem* system;
+	b3Cloth** cloths;
+	float32 dt;
+	u32 iterations;
+};
+
+void b3ClothSystem::Step(float32 dt, u32 iterations, const b3AABB3* view)
+{
+	B3_PROFILE("Cloth Step");
+
+	// Gather the cloths to be stepped.
+	// The small cloths are stored at the beginning of the array 
+	// and the large cloths at the end.
+	u32 smallCount = 0;
+	u32 largeCount = 0;
+
+	for (b3Cloth* c = m_clothList.m_head; c; c = c->m_next)
+	{
+		if (c->m_awake == false)
+		{
+			if (m_sleeping && ShouldWake(c) == false)
+			{
+				continue;
+			}
+			
+			c->SetAwake(true);
+		}
+
+		if (view && b3TestOverlap(c->m_aabb, *view) == false)
+		{
+			continue;
+		}
+
+		if (c->m_pCount < b3_clothBatchParticleCount)
+		{
+			m_stepCloths[smallCount++] = c;
+		}
+		else
+		{
+			m_stepCloths[m_stepCapacity - 1 - largeCount++] = c;
+		}
+	}
+
+	// The small cloths don't share data. 
+	// Therefore, they are stepped in parallel.
+	if (smallCount > 0)
+	{
+		b3StepClothsTask task;
+		task.system = this;
+		task.cloths = m_stepCloths;
+		task.dt = dt;
+		task.iterations = iterations;
+		m_threadPool.ParallelFor(&task, smallCount, 1);
+	}
+
+	// The large cloths are stepped one at a time, each using the worker threads.
+	for (u32 i = 0; i < largeCount; ++i)
+	{
+		StepCloth(m_stepCloths[m_stepCapacity - 1 - i], dt, iterations, &m_threadPool);
+	}
+}
+
+void b3ClothSystem::Draw(b3Draw* draw) const
+{
+	for (b3Cloth* c = m_clothList.m_head; c; c = c->m_next)
+	{
+		c->Draw(draw);
+	}
+}
\ No newline at end of file
@@ -21,7 +21,10 @@
 #include <bounce/dynamics/contacts/mesh_contact.h>
 #include <bounce/dynamics/shapes/shape.h>
 #include <bounce/dynamics/body.h>
+#include <bounce/dynamics/world.h>
 #include <bounce/dynamics/world_listeners.h>
+#include <bounce/common/memory/stack_allocator.h>
+#include <bounce/common/thread/thread_pool.h>
 
 b3ContactManager::b3ContactManager() : 
 	m_convexBlocks(sizeof(b3ConvexContact)),
@@ -101,6 +104,9 @@ void b3ContactManager::AddPair(void* dataA, void* dataB)
 	bodyB = shapeB->GetBody();
 
 	c->m_flags = 0;
+	c->m_island = NULL;
+	c->m_toi.t = 1.0f;
+	c->m_toi.count = 0;
 	b3OverlappingPair* pair = &c->m_pair;
 
 	// Initialize edge A
@@ -152,9 +158,9 @@ void b3ContactManager::SynchronizeShapes()
 }
 
 // Find potentially overlapping shape pairs.
-void b3ContactManager::FindNewContacts()
+void b3ContactManager::FindNewContacts(b3ThreadPool* threadPool)
 {
-	m_broadPhase.FindNewPairs(this);
+	m_broadPhase.FindNewPairs(this, threadPool);
 
 	b3MeshContactLink* c = m_meshContactList.m_head;
 	while (c)
@@ -164,11 +170,36 @@ void b3ContactManager::FindNewContacts()
 	}
 }
 
-void b3ContactManager::UpdateContacts() 
+// The number of contacts updated per task.
+const u32 b3_contactGrainSize = 32;
+
+// Updates the manifolds of a range of contacts on a thread.
+struct b3UpdateManifoldsTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		// Each thread uses its own stack allocator.
+		b3StackAllocator* allocator = threadIndex == 0 ? mainAllocator : threadAllocators + threadIndex - 1;
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			contacts[i]->UpdateManifolds(allocator);
+		}
+	}
+
+	b3StackAllocator* mainAllocator;
+	b3StackAllocator* threadAllocators;
+	b3Contact** contacts;
+};
+
+void b3ContactManager::UpdateContacts(b3StackAllocator* allocator, b3ThreadPool* threadPool, b3StackAllocator* threadAllocators) 
 {	
 	B3_PROFILE("Update Contacts");
 	
-	// Update the state of all contacts.
+	// Filter the contacts and gather the ones that must be updated.
+	b3Contact** contacts = (b3Contact**)allocator->Allocate(m_contactList.m_count * sizeof(b3Contact*));
+	u32 contactCount = 0;
+
 	b3Contact* c = m_contactList.m_head;
 	while (c)
 	{
@@ -224,10 +255,30 @@ void b3ContactManager::UpdateContacts()
 		}
 
 		// The contact persists.
-		c->Update(m_contactListener);
+		contacts[contactCount++] = c;
 
 		c = c->m_next;
 	}
+
+	{
+		B3_PROFILE("Narrow Phase");
+
+		// Each contact only writes to itself. 
+		b3UpdateManifoldsTask task;
+		task.mainAllocator = allocator;
+		task.threadAllocators = threadAllocators;
+		task.contacts = contacts;
+
+		threadPool->ParallelFor(&task, contactCount, b3_contactGrainSize);
+	}
+
+	// Wake the bodies and report the new states in a deterministic order.
+	for (u32 i = 0; i < contactCount; ++i)
+	{
+		contacts[i]->UpdateState(m_contactListener);
+	}
+
+	allocator->Free(contacts);
 }
 
 b3Contact* b3ContactManager::Create(b3Shape* shapeA, b3Shape* shapeB) 
@@ -252,17 +303,12 @@ b3Contact* b3ContactManager::Create(b3Shape* shapeA, b3Shape* shapeB)
 	}
 	else 
 	{
-		if (typeB == e_meshShape) 
-		{
-			void* block = m_meshBlocks.Allocate();
-			b3MeshContact* mxc = new (block) b3MeshContact(shapeA, shapeB);
-			c = mxc;
-		}
-		else 
-		{
-			// Collisions between meshes are not implemented.
-			return NULL;
-		}
+		// The shape B is a mesh. 
+		// The shape A is either a convex shape or a mesh.
+		B3_ASSERT(typeB == e_meshShape);
+		void* block = m_meshBlocks.Allocate();
+		b3MeshContact* mxc = new (block) b3MeshContact(shapeA, shapeB);
+		c = mxc;
 	}
 
 	// The shapes might be swapped.
@@ -287,6 +333,10 @@ void b3ContactManager::Destroy(b3Contact* c)
 	b3Shape* shapeA = c->GetShapeA();
 	b3Shape* shapeB = c->GetShapeB();
 	
+	// Remove the contact from its island.
+	b3World* world = shapeA->GetBody()->GetWorld();
+	world->m_islandMan.RemoveContact(c);
+
 	shapeA->m_contactEdges.Remove(&pair->edgeA);
 	shapeB->m_contactEdges.Remove(&pair->edgeB);
 
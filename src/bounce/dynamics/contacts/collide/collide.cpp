@@ -29,6 +29,8 @@
 
 void b3ShapeGJKProxy::Set(const b3Shape* shape, u32 index)
 {
+	m_hull = NULL;
+
 	switch (shape->GetType())
 	{
 	case e_sphereShape:
@@ -53,6 +55,7 @@ void b3ShapeGJKProxy::Set(const b3Shape* shape, u32 index)
 		m_count = hull->m_hull->vertexCount;
 		m_vertices = hull->m_hull->vertices;
 		m_radius = hull->m_radius;
+		m_hull = hull->m_hull;
 		break;
 	}
 	case e_meshShape:
@@ -22,6 +22,7 @@
 #include <bounce/dynamics/contacts/contact_cluster.h>
 #include <bounce/dynamics/shapes/hull_shape.h>
 #include <bounce/collision/shapes/hull.h>
+#include <bounce/common/thread/atomic.h>
 
 void b3BuildEdgeContact(b3Manifold& manifold, 
 	const b3Transform& xf1, u32 index1, const b3HullShape* s1,
@@ -255,7 +256,8 @@ void b3CollideHulls(b3Manifold& manifold,
 }
 
 bool b3_convexCache = true;
-u32 b3_convexCalls = 0, b3_convexCacheHits = 0;
+// The narrow-phase may run on many threads.
+b3Counter b3_convexCalls(0), b3_convexCacheHits(0);
 
 void b3CollideHulls(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* s1,
@@ -267,7 +269,7 @@ void b3CollideHullAndHull(b3Manifold& manifold,
 	const b3Transform& xf2, const b3HullShape* s2, 
 	b3ConvexCache* cache)
 {
-	++b3_convexCalls;
+	b3Increment(b3_convexCalls);
 
 	if (b3_convexCache)
 	{
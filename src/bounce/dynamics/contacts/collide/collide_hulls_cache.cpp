@@ -22,6 +22,7 @@
 #include <bounce/dynamics/shapes/hull_shape.h>
 #include <bounce/dynamics/body.h>
 #include <bounce/collision/shapes/hull.h>
+#include <bounce/common/thread/atomic.h>
 
 void b3BuildEdgeContact(b3Manifold& manifold,
 	const b3Transform& xf1, u32 index1, const b3HullShape* s1,
@@ -350,7 +351,7 @@ b3SATCacheType b3FeatureCache::ReadEdge(
 	return b3SATCacheType::e_empty;
 }
 
-extern u32 b3_convexCacheHits;
+extern b3Counter b3_convexCacheHits;
 
 void b3CollideHulls(b3Manifold& manifold,
 	const b3Transform& xf1, const b3HullShape* s1,
@@ -373,7 +374,7 @@ void b3CollideHulls(b3Manifold& manifold,
 		state1 == b3SATCacheType::e_separation)
 	{
 		// Separation cache hit.
-		++b3_convexCacheHits;
+		b3Increment(b3_convexCacheHits);
 		return;
 	}
 	else if (state0 == b3SATCacheType::e_overlap &&
@@ -406,7 +407,7 @@ void b3CollideHulls(b3Manifold& manifold,
 		if (manifold.pointCount > 0)
 		{
 			// Overlap cache hit.
-			++b3_convexCacheHits;
+			b3Increment(b3_convexCacheHits);
 			return;
 		}
 	}
@@ -38,19 +38,15 @@ void b3Contact::GetWorldManifold(b3WorldManifold* out, u32 index) const
 	out->Initialize(m, shapeA->m_radius, xfA, shapeB->m_radius, xfB);
 }
 
-void b3Contact::Update(b3ContactListener* listener)
+void b3Contact::UpdateManifolds(b3StackAllocator* allocator)
 {
 	b3Shape* shapeA = GetShapeA();
 	b3Body* bodyA = shapeA->GetBody();
-	b3Transform xfA = bodyA->GetTransform();
 
 	b3Shape* shapeB = GetShapeB();
-	b3Body* bodyB = shapeB->GetBody();
-	b3Transform xfB = bodyB->GetTransform();
 
 	b3World* world = bodyA->GetWorld();
 
-	bool wasOverlapping = IsOverlapping();
 	bool isOverlapping = false;
 	bool isSensorContact = shapeA->IsSensor() || shapeB->IsSensor();
 
@@ -74,7 +70,7 @@ void b3Contact::Update(b3ContactListener* listener)
 		}
 
 		// Generate new contact points for the solver.
-		Collide();
+		Collide(allocator);
 
 		// Initialize the new built contact points for warm starting the solver.
 		if (world->m_warmStarting == true)
@@ -102,6 +98,31 @@ void b3Contact::Update(b3ContactListener* listener)
 		}
 	}
 
+	// The overlap state is updated later.
+	if (isOverlapping == true)
+	{
+		m_flags |= e_newOverlapFlag;
+	}
+	else
+	{
+		m_flags &= ~e_newOverlapFlag;
+	}
+}
+
+void b3Contact::UpdateState(b3ContactListener* listener)
+{
+	b3Shape* shapeA = GetShapeA();
+	b3Body* bodyA = shapeA->GetBody();
+
+	b3Shape* shapeB = GetShapeB();
+	b3Body* bodyB = shapeB->GetBody();
+
+	b3World* world = bodyA->GetWorld();
+
+	bool wasOverlapping = IsOverlapping();
+	bool isOverlapping = (m_flags & e_newOverlapFlag) != 0;
+	bool isSensorContact = shapeA->IsSensor() || shapeB->IsSensor();
+
 	// Wake the bodies associated with the shapes if the contact has began.
 	if (isOverlapping != wasOverlapping)
 	{
@@ -119,6 +140,17 @@ void b3Contact::Update(b3ContactListener* listener)
 		m_flags &= ~e_overlapFlag;;
 	}
 
+	// Link the contact to the island graph if it's touching.
+	bool isTouching = isOverlapping && isSensorContact == false;
+	if (isTouching == true && m_island == NULL)
+	{
+		world->m_islandMan.AddContact(this);
+	}
+	else if (isTouching == false && m_island != NULL)
+	{
+		world->m_islandMan.RemoveContact(this);
+	}
+
 	// Notify the contact listener the new contact state.
 	if (listener != NULL)
 	{
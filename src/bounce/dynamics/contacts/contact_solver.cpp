@@ -22,6 +22,7 @@
 #include <bounce/dynamics/body.h>
 #include <bounce/common/memory/stack_allocator.h>
 #include <bounce/common/math/mat.h>
+#include <stdint.h>
 
 // This solver implements PGS for solving velocity constraints and 
 // NGS for solving position constraints.
@@ -33,41 +34,57 @@ b3ContactSolver::b3ContactSolver(const b3ContactSolverDef* def)
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
-	m_positionConstraints = (b3ContactPositionConstraint*)m_allocator->Allocate(m_count * sizeof(b3ContactPositionConstraint));
-	m_velocityConstraints = (b3ContactVelocityConstraint*)m_allocator->Allocate(m_count * sizeof(b3ContactVelocityConstraint));
 	m_dt = def->dt;
 	m_invDt = m_dt != 0.0f ? 1.0f / m_dt : 0.0f;
+	
+	// Count the manifolds and points so that all the constraint data 
+	// is stored in a few contiguous arrays.
+	m_manifoldCount = 0;
+	m_pointCount = 0;
+	for (u32 i = 0; i < m_count; ++i)
+	{
+		b3Contact* c = m_contacts[i];
+		m_manifoldCount += c->m_manifoldCount;
+		for (u32 j = 0; j < c->m_manifoldCount; ++j)
+		{
+			m_pointCount += c->m_manifolds[j].pointCount;
+		}
+	}
+	
+	m_positionConstraints = (b3ContactPositionConstraint*)m_allocator->Allocate(m_count * sizeof(b3ContactPositionConstraint));
+	m_velocityConstraints = (b3ContactVelocityConstraint*)m_allocator->Allocate(m_count * sizeof(b3ContactVelocityConstraint));
+	m_positionManifolds = (b3PositionConstraintManifold*)m_allocator->Allocate(m_manifoldCount * sizeof(b3PositionConstraintManifold));
+	m_velocityManifolds = (b3VelocityConstraintManifold*)m_allocator->Allocate(m_manifoldCount * sizeof(b3VelocityConstraintManifold));
+	m_positionPoints = (b3PositionConstraintPoint*)m_allocator->Allocate(m_pointCount * sizeof(b3PositionConstraintPoint));
+	m_velocityPoints = (b3VelocityConstraintPoint*)m_allocator->Allocate(m_pointCount * sizeof(b3VelocityConstraintPoint));
+	
+	m_wideMemory = NULL;
+	m_wideConstraints = NULL;
+	m_wideCount = 0;
+	m_wideManifolds = NULL;
+	m_widePoints = NULL;
 }
 
 b3ContactSolver::~b3ContactSolver()
 {
 	// Reverse free.
-	for (u32 index1 = m_count; index1 > 0; --index1)
+	if (m_wideMemory)
 	{
-		u32 i1 = index1 - 1;
-		b3ContactPositionConstraint* pc = m_positionConstraints + i1;
-		b3ContactVelocityConstraint* vc = m_velocityConstraints + i1;
-		
-		for (u32 index2 = pc->manifoldCount; index2 > 0; --index2)
-		{
-			u32 i2 = index2 - 1;
-			b3PositionConstraintManifold* pcm = pc->manifolds + i2;
-			b3VelocityConstraintManifold* vcm = vc->manifolds + i2;
-			
-			m_allocator->Free(vcm->points);
-			m_allocator->Free(pcm->points);
-		}
-
-		m_allocator->Free(vc->manifolds);
-		m_allocator->Free(pc->manifolds);
+		m_allocator->Free(m_wideMemory);
 	}
 
+	m_allocator->Free(m_velocityPoints);
+	m_allocator->Free(m_positionPoints);
+	m_allocator->Free(m_velocityManifolds);
+	m_allocator->Free(m_positionManifolds);
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
 
 void b3ContactSolver::InitializeConstraints()
 {
+	u32 manifoldIndex = 0;
+	u32 pointIndex = 0;
 	for (u32 i = 0; i < m_count; ++i)
 	{
 		b3Contact* c = m_contacts[i];
@@ -84,26 +101,26 @@ void b3ContactSolver::InitializeConstraints()
 		b3ContactPositionConstraint* pc = m_positionConstraints + i;
 		b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
-		pc->indexA = bodyA->m_islandID;
+		pc->indexA = c->m_indexA;
 		pc->invMassA = bodyA->m_invMass;
 		pc->invIA = bodyA->m_worldInvI;
 		pc->localCenterA = bodyA->m_sweep.localCenter;
 		pc->radiusA = shapeA->m_radius;
 
-		pc->indexB = bodyB->m_islandID;
+		pc->indexB = c->m_indexB;
 		pc->invMassB = bodyB->m_invMass;
 		pc->invIB = bodyB->m_worldInvI;
 		pc->localCenterB = bodyB->m_sweep.localCenter;
 		pc->radiusB = shapeB->m_radius;
 
 		pc->manifoldCount = manifoldCount;
-		pc->manifolds = (b3PositionConstraintManifold*)m_allocator->Allocate(manifoldCount * sizeof(b3PositionConstraintManifold));
+		pc->manifolds = m_positionManifolds + manifoldIndex;
 
-		vc->indexA = bodyA->m_islandID;
+		vc->indexA = c->m_indexA;
 		vc->invMassA = bodyA->m_invMass;
 		vc->invIA = bodyA->m_worldInvI;
 
-		vc->indexB = bodyB->m_islandID;
+		vc->indexB = c->m_indexB;
 		vc->invMassB = bodyB->m_invMass;
 		vc->invIB = bodyB->m_worldInvI;
 
@@ -111,7 +128,9 @@ void b3ContactSolver::InitializeConstraints()
 		vc->restitution = b3MixRestitution(shapeA->m_restitution, shapeB->m_restitution);
 
 		vc->manifoldCount = manifoldCount;
-		vc->manifolds = (b3VelocityConstraintManifold*)m_allocator->Allocate(manifoldCount * sizeof(b3VelocityConstraintManifold));
+		vc->manifolds = m_velocityManifolds + manifoldIndex;
+		
+		manifoldIndex += manifoldCount;
 
 		for (u32 j = 0; j < manifoldCount; ++j)
 		{
@@ -120,10 +139,12 @@ void b3ContactSolver::InitializeConstraints()
 			b3VelocityConstraintManifold* vcm = vc->manifolds + j;
 
 			pcm->pointCount = m->pointCount;
-			pcm->points = (b3PositionConstraintPoint*)m_allocator->Allocate(pcm->pointCount * sizeof(b3PositionConstraintPoint));
+			pcm->points = m_positionPoints + pointIndex;
 			
 			vcm->pointCount = m->pointCount;
-			vcm->points = (b3VelocityConstraintPoint*)m_allocator->Allocate(vcm->pointCount * sizeof(b3VelocityConstraintPoint));
+			vcm->points = m_velocityPoints + pointIndex;
+			
+			pointIndex += m->pointCount;
 			
 			vcm->tangentImpulse = m->tangentImpulse;
 			vcm->motorImpulse = m->motorImpulse;
@@ -338,7 +359,13 @@ void b3ContactSolver::WarmStart()
 
 void b3ContactSolver::SolveVelocityConstraints()
 {
-	for (u32 i = 0; i < m_count; ++i)
+	SolveVelocityConstraints(0, m_count);
+}
+
+void b3ContactSolver::SolveVelocityConstraints(u32 begin, u32 end)
+{
+	B3_ASSERT(begin <= end && end <= m_count);
+	for (u32 i = begin; i < end; ++i)
 	{
 		b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
 		u32 manifoldCount = vc->manifoldCount;
@@ -441,10 +468,361 @@ void b3ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		// Only dynamic bodies have positive mass.
+		if (mA > 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+
+		if (mB > 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
+	}
+}
+
+// Compute the number of manifolds of a wide constraint and the number of points 
+// of each of its manifolds.
+static u32 b3WideManifoldCount(const b3ContactVelocityConstraint* vcs, u32 laneCount, u32* pointCounts)
+{
+	u32 manifoldCount = 0;
+	for (u32 i = 0; i < B3_MAX_MANIFOLDS; ++i)
+	{
+		pointCounts[i] = 0;
+	}
+
+	for (u32 i = 0; i < laneCount; ++i)
+	{
+		const b3ContactVelocityConstraint* vc = vcs + i;
+		B3_ASSERT(vc->manifoldCount <= B3_MAX_MANIFOLDS);
+		manifoldCount = b3Max(manifoldCount, vc->manifoldCount);
+		for (u32 j = 0; j < vc->manifoldCount; ++j)
+		{
+			pointCounts[j] = b3Max(pointCounts[j], vc->manifolds[j].pointCount);
+		}
+	}
+
+	return manifoldCount;
+}
+
+// Round a size up to the wide number alignment.
+static u32 b3AlignWide(u32 size)
+{
+	return (size + B3_SIMD_ALIGNMENT - 1) & ~(B3_SIMD_ALIGNMENT - 1);
+}
+
+void b3ContactSolver::PackWideConstraints(const u32* offsets, u32 rangeCount, u32* wideOffsets)
+{
+	B3_ASSERT(m_wideMemory == NULL);
+
+	// Count the wide constraints, manifolds, and points.
+	u32 wideCount = 0;
+	u32 manifoldCount = 0;
+	u32 pointCount = 0;
+
+	wideOffsets[0] = 0;
+	for (u32 i = 0; i < rangeCount; ++i)
+	{
+		for (u32 first = offsets[i]; first < offsets[i + 1]; first += B3_SIMD_WIDTH)
+		{
+			u32 laneCount = b3Min(u32(B3_SIMD_WIDTH), offsets[i + 1] - first);
+			
+			u32 pointCounts[B3_MAX_MANIFOLDS];
+			u32 count = b3WideManifoldCount(m_velocityConstraints + first, laneCount, pointCounts);
+			
+			manifoldCount += count;
+			for (u32 j = 0; j < count; ++j)
+			{
+				pointCount += pointCounts[j];
+			}
+
+			++wideCount;
+		}
+
+		wideOffsets[i + 1] = wideCount;
+	}
+
+	// Allocate the wide data in a single aligned block.
+	// Unused lanes must be zero, so that they don't change the velocities.
+	u32 constraintsSize = b3AlignWide(wideCount * sizeof(b3WideContactVelocityConstraint));
+	u32 manifoldsSize = b3AlignWide(manifoldCount * sizeof(b3WideVelocityConstraintManifold));
+	u32 pointsSize = b3AlignWide(pointCount * sizeof(b3WideVelocityConstraintPoint));
+	u32 size = constraintsSize + manifoldsSize + pointsSize;
+	
+	m_wideMemory = m_allocator->Allocate(size + B3_SIMD_ALIGNMENT - 1);
+	
+	uintptr_t address = ((uintptr_t)m_wideMemory + B3_SIMD_ALIGNMENT - 1) & ~uintptr_t(B3_SIMD_ALIGNMENT - 1);
+	u8* memory = (u8*)address;
+	memset(memory, 0, size);
+
+	m_wideConstraints = (b3WideContactVelocityConstraint*)memory;
+	m_wideManifolds = (b3WideVelocityConstraintManifold*)(memory + constraintsSize);
+	m_widePoints = (b3WideVelocityConstraintPoint*)(memory + constraintsSize + manifoldsSize);
+	m_wideCount = wideCount;
+
+	// Fill the lanes.
+	u32 wideIndex = 0;
+	u32 manifoldIndex = 0;
+	u32 pointIndex = 0;
+	for (u32 i = 0; i < rangeCount; ++i)
+	{
+		for (u32 first = offsets[i]; first < offsets[i + 1]; first += B3_SIMD_WIDTH)
+		{
+			u32 laneCount = b3Min(u32(B3_SIMD_WIDTH), offsets[i + 1] - first);
+			
+			b3WideContactVelocityConstraint* wc = m_wideConstraints + wideIndex;
+			++wideIndex;
+			
+			wc->constraintIndex = first;
+			wc->laneCount = laneCount;
+			
+			u32 pointCounts[B3_MAX_MANIFOLDS];
+			wc->manifoldIndex = manifoldIndex;
+			wc->manifoldCount = b3WideManifoldCount(m_velocityConstraints + first, laneCount, pointCounts);
+			
+			for (u32 j = 0; j < wc->manifoldCount; ++j)
+			{
+				b3WideVelocityConstraintManifold* wcm = m_wideManifolds + manifoldIndex + j;
+				wcm->pointIndex = pointIndex;
+				wcm->pointCount = pointCounts[j];
+				pointIndex += pointCounts[j];
+			}
+			manifoldIndex += wc->manifoldCount;
+
+			for (u32 lane = 0; lane < laneCount; ++lane)
+			{
+				const b3ContactVelocityConstraint* vc = m_velocityConstraints + first + lane;
+
+				wc->invMassA.SetLane(lane, vc->invMassA);
+				wc->invIA.SetLane(lane, vc->invIA);
+				wc->invMassB.SetLane(lane, vc->invMassB);
+				wc->invIB.SetLane(lane, vc->invIB);
+				wc->friction.SetLane(lane, vc->friction);
+
+				for (u32 j = 0; j < vc->manifoldCount; ++j)
+				{
+					const b3VelocityConstraintManifold* vcm = vc->manifolds + j;
+					b3WideVelocityConstraintManifold* wcm = m_wideManifolds + wc->manifoldIndex + j;
+
+					wcm->rA.SetLane(lane, vcm->rA);
+					wcm->rB.SetLane(lane, vcm->rB);
+					wcm->normal.SetLane(lane, vcm->normal);
+					wcm->tangent1.SetLane(lane, vcm->tangent1);
+					wcm->tangent2.SetLane(lane, vcm->tangent2);
+					wcm->tangentMassXX.SetLane(lane, vcm->tangentMass.x.x);
+					wcm->tangentMassXY.SetLane(lane, vcm->tangentMass.x.y);
+					wcm->tangentMassYX.SetLane(lane, vcm->tangentMass.y.x);
+					wcm->tangentMassYY.SetLane(lane, vcm->tangentMass.y.y);
+					wcm->tangentImpulseX.SetLane(lane, vcm->tangentImpulse.x);
+					wcm->tangentImpulseY.SetLane(lane, vcm->tangentImpulse.y);
+					wcm->motorImpulse.SetLane(lane, vcm->motorImpulse);
+					wcm->motorMass.SetLane(lane, vcm->motorMass);
+
+					for (u32 k = 0; k < vcm->pointCount; ++k)
+					{
+						const b3VelocityConstraintPoint* vcp = vcm->points + k;
+						b3WideVelocityConstraintPoint* wcp = m_widePoints + wcm->pointIndex + k;
+
+						wcp->rA.SetLane(lane, vcp->rA);
+						wcp->rB.SetLane(lane, vcp->rB);
+						wcp->normal.SetLane(lane, vcp->normal);
+						wcp->normalMass.SetLane(lane, vcp->normalMass);
+						wcp->normalImpulse.SetLane(lane, vcp->normalImpulse);
+						wcp->velocityBias.SetLane(lane, vcp->velocityBias);
+					}
+				}
+			}
+		}
+	}
+}
+
+void b3ContactSolver::SolveWideVelocityConstraints(u32 begin, u32 end)
+{
+	B3_ASSERT(begin <= end && end <= m_wideCount);
+
+	const b3FloatW zero(0.0f);
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3WideContactVelocityConstraint* wc = m_wideConstraints + i;
+		
+		const b3ContactVelocityConstraint* vcs = m_velocityConstraints + wc->constraintIndex;
+		u32 laneCount = wc->laneCount;
+
+		b3FloatW mA = wc->invMassA;
+		b3Mat33W iA = wc->invIA;
+		
+		b3FloatW mB = wc->invMassB;
+		b3Mat33W iB = wc->invIB;
+
+		// Gather the body velocities. Unused lanes have zero velocities.
+		float32 velocities[12][B3_SIMD_WIDTH];
+		memset(velocities, 0, sizeof(velocities));
+		for (u32 lane = 0; lane < laneCount; ++lane)
+		{
+			const b3Velocity& velocityA = m_velocities[vcs[lane].indexA];
+			const b3Velocity& velocityB = m_velocities[vcs[lane].indexB];
+			for (u32 k = 0; k < 3; ++k)
+			{
+				velocities[k][lane] = velocityA.v[k];
+				velocities[3 + k][lane] = velocityA.w[k];
+				velocities[6 + k][lane] = velocityB.v[k];
+				velocities[9 + k][lane] = velocityB.w[k];
+			}
+		}
+
+		b3Vec3W vA, wA, vB, wB;
+		b3FloatW* components[12] = { &vA.x, &vA.y, &vA.z, &wA.x, &wA.y, &wA.z, &vB.x, &vB.y, &vB.z, &wB.x, &wB.y, &wB.z };
+		for (u32 k = 0; k < 12; ++k)
+		{
+			components[k]->Load(velocities[k]);
+		}
+
+		for (u32 j = 0; j < wc->manifoldCount; ++j)
+		{
+			b3WideVelocityConstraintManifold* wcm = m_wideManifolds + wc->manifoldIndex + j;
+			u32 pointCount = wcm->pointCount;
+
+			b3FloatW normalImpulse = zero;
+			for (u32 k = 0; k < pointCount; ++k)
+			{
+				b3WideVelocityConstraintPoint* wcp = m_widePoints + wcm->pointIndex + k;
+
+				// Solve normal constraints.
+				{
+					b3Vec3W dv = vB + b3Cross(wB, wcp->rB) - vA - b3Cross(wA, wcp->rA);
+					b3FloatW Cdot = b3Dot(wcp->normal, dv);
+
+					b3FloatW impulse = -wcp->normalMass * (Cdot - wcp->velocityBias);
+
+					b3FloatW oldImpulse = wcp->normalImpulse;
+					wcp->normalImpulse = b3Max(wcp->normalImpulse + impulse, zero);
+					impulse = wcp->normalImpulse - oldImpulse;
+
+					b3Vec3W P = impulse * wcp->normal;
+
+					vA -= mA * P;
+					wA -= iA * b3Cross(wcp->rA, P);
+
+					vB += mB * P;
+					wB += iB * b3Cross(wcp->rB, P);
+
+					normalImpulse += wcp->normalImpulse;
+				}
+			}
+
+			// Solve tangent constraints.
+			{
+				b3Vec3W dv = vB + b3Cross(wB, wcm->rB) - vA - b3Cross(wA, wcm->rA);
+				
+				b3FloatW CdotX = b3Dot(dv, wcm->tangent1);
+				b3FloatW CdotY = b3Dot(dv, wcm->tangent2);
+
+				b3FloatW impulseX = -(wcm->tangentMassXX * CdotX + wcm->tangentMassYX * CdotY);
+				b3FloatW impulseY = -(wcm->tangentMassXY * CdotX + wcm->tangentMassYY * CdotY);
+				
+				b3FloatW oldImpulseX = wcm->tangentImpulseX;
+				b3FloatW oldImpulseY = wcm->tangentImpulseY;
+				
+				wcm->tangentImpulseX += impulseX;
+				wcm->tangentImpulseY += impulseY;
+
+				// Clamp the impulse to the friction cone. 
+				// If the impulse is clamped then its length is positive.
+				b3FloatW maxImpulse = wc->friction * normalImpulse;
+				b3FloatW lengthSquared = wcm->tangentImpulseX * wcm->tangentImpulseX + wcm->tangentImpulseY * wcm->tangentImpulseY;
+				b3FloatW mask = lengthSquared > maxImpulse * maxImpulse;
+				b3FloatW scale = b3Select(mask, maxImpulse / b3Sqrt(lengthSquared), b3FloatW(1.0f));
+				
+				wcm->tangentImpulseX *= scale;
+				wcm->tangentImpulseY *= scale;
+
+				impulseX = wcm->tangentImpulseX - oldImpulseX;
+				impulseY = wcm->tangentImpulseY - oldImpulseY;
+
+				b3Vec3W P = impulseX * wcm->tangent1 + impulseY * wcm->tangent2;
+
+				vA -= mA * P;
+				wA -= iA * b3Cross(wcm->rA, P);
+
+				vB += mB * P;
+				wB += iB * b3Cross(wcm->rB, P);
+			}
+
+			// Solve motor constraint.
+			{
+				b3FloatW Cdot = b3Dot(wcm->normal, wB - wA);
+				b3FloatW impulse = -wcm->motorMass * Cdot;
+				b3FloatW oldImpulse = wcm->motorImpulse;
+				b3FloatW maxImpulse = wc->friction * normalImpulse;
+				wcm->motorImpulse = b3Clamp(wcm->motorImpulse + impulse, -maxImpulse, maxImpulse);
+				impulse = wcm->motorImpulse - oldImpulse;
+
+				b3Vec3W P = impulse * wcm->normal;
+
+				wA -= iA * P;
+				wB += iB * P;
+			}
+		}
+
+		// Scatter the body velocities.
+		for (u32 k = 0; k < 12; ++k)
+		{
+			components[k]->Store(velocities[k]);
+		}
+
+		for (u32 lane = 0; lane < laneCount; ++lane)
+		{
+			const b3ContactVelocityConstraint* vc = vcs + lane;
+
+			// Only dynamic bodies have positive mass.
+			if (vc->invMassA > 0.0f)
+			{
+				b3Velocity& velocityA = m_velocities[vc->indexA];
+				velocityA.v.Set(velocities[0][lane], velocities[1][lane], velocities[2][lane]);
+				velocityA.w.Set(velocities[3][lane], velocities[4][lane], velocities[5][lane]);
+			}
+
+			if (vc->invMassB > 0.0f)
+			{
+				b3Velocity& velocityB = m_velocities[vc->indexB];
+				velocityB.v.Set(velocities[6][lane], velocities[7][lane], velocities[8][lane]);
+				velocityB.w.Set(velocities[9][lane], velocities[10][lane], velocities[11][lane]);
+			}
+		}
+	}
+}
+
+void b3ContactSolver::UnpackWideConstraints()
+{
+	for (u32 i = 0; i < m_wideCount; ++i)
+	{
+		const b3WideContactVelocityConstraint* wc = m_wideConstraints + i;
+
+		for (u32 lane = 0; lane < wc->laneCount; ++lane)
+		{
+			b3ContactVelocityConstraint* vc = m_velocityConstraints + wc->constraintIndex + lane;
+
+			for (u32 j = 0; j < vc->manifoldCount; ++j)
+			{
+				b3VelocityConstraintManifold* vcm = vc->manifolds + j;
+				const b3WideVelocityConstraintManifold* wcm = m_wideManifolds + wc->manifoldIndex + j;
+
+				vcm->tangentImpulse.x = wcm->tangentImpulseX.GetLane(lane);
+				vcm->tangentImpulse.y = wcm->tangentImpulseY.GetLane(lane);
+				vcm->motorImpulse = wcm->motorImpulse.GetLane(lane);
+
+				for (u32 k = 0; k < vcm->pointCount; ++k)
+				{
+					b3VelocityConstraintPoint* vcp = vcm->points + k;
+					const b3WideVelocityConstraintPoint* wcp = m_widePoints + wcm->pointIndex + k;
+
+					vcp->normalImpulse = wcp->normalImpulse.GetLane(lane);
+				}
+			}
+		}
 	}
 }
 
@@ -477,6 +855,27 @@ void b3ContactSolver::StoreImpulses()
 	}
 }
 
+void b3ContactSolver::ResetImpulses()
+{
+	for (u32 i = 0; i < m_count; ++i)
+	{
+		b3ContactVelocityConstraint* vc = m_velocityConstraints + i;
+
+		for (u32 j = 0; j < vc->manifoldCount; ++j)
+		{
+			b3VelocityConstraintManifold* vcm = vc->manifolds + j;
+			vcm->tangentImpulse.SetZero();
+			vcm->motorImpulse = 0.0f;
+
+			for (u32 k = 0; k < vcm->pointCount; ++k)
+			{
+				b3VelocityConstraintPoint* vcp = vcm->points + k;
+				vcp->normalImpulse = 0.0f;
+			}
+		}
+	}
+}
+
 struct b3ContactPositionSolverPoint
 {
 	void Initialize(const b3ContactPositionConstraint* pc, const b3PositionConstraintPoint* pcp, const b3Transform& xfA, const b3Transform& xfB)
@@ -581,3 +980,97 @@ bool b3ContactSolver::SolvePositionConstraints()
 
 	return minSeparation >= -3.0f * B3_LINEAR_SLOP;
 }
+
+// The hull cores have no radius, so the time of impact can't be computed 
+// from overlapping shapes. Therefore the bodies of the time of impact 
+// are separated so that their next impact can be found in the same step.
+const float32 b3_toiSeparation = 2.0f * B3_LINEAR_SLOP;
+
+bool b3ContactSolver::SolveTOIPositionConstraints(u32 toiIndexA, u32 toiIndexB)
+{
+	float32 minSeparation = B3_MAX_FLOAT;
+
+	for (u32 i = 0; i < m_count; ++i)
+	{
+		b3ContactPositionConstraint* pc = m_positionConstraints + i;
+
+		u32 indexA = pc->indexA;
+		b3Vec3 localCenterA = pc->localCenterA;
+
+		u32 indexB = pc->indexB;
+		b3Vec3 localCenterB = pc->localCenterB;
+
+		// The bodies that aren't in the time of impact are treated as static.
+		// The bodies in the time of impact are only translated. 
+		// A rotation could push features that aren't in the manifold into the other shape.
+		float32 mA = 0.0f;
+		if (indexA == toiIndexA || indexA == toiIndexB)
+		{
+			mA = pc->invMassA;
+		}
+
+		float32 mB = 0.0f;
+		if (indexB == toiIndexA || indexB == toiIndexB)
+		{
+			mB = pc->invMassB;
+		}
+
+		b3Vec3 cA = m_positions[indexA].x;
+		b3Quat qA = m_positions[indexA].q;
+
+		b3Vec3 cB = m_positions[indexB].x;
+		b3Quat qB = m_positions[indexB].q;
+
+		u32 manifoldCount = pc->manifoldCount;
+
+		for (u32 j = 0; j < manifoldCount; ++j)
+		{
+			b3PositionConstraintManifold* pcm = pc->manifolds + j;
+			u32 pointCount = pcm->pointCount;
+
+			// Solve normal constraints
+			for (u32 k = 0; k < pointCount; ++k)
+			{
+				b3PositionConstraintPoint* pcp = pcm->points + k;
+
+				b3Transform xfA;
+				xfA.rotation = b3QuatMat33(qA);
+				xfA.position = cA - b3Mul(xfA.rotation, localCenterA);
+
+				b3Transform xfB;
+				xfB.rotation = b3QuatMat33(qB);
+				xfB.position = cB - b3Mul(xfB.rotation, localCenterB);
+
+				b3ContactPositionSolverPoint cpcp;
+				cpcp.Initialize(pc, pcp, xfA, xfB);
+
+				b3Vec3 normal = cpcp.normal;
+				float32 separation = cpcp.separation;
+
+				// Update max constraint error.
+				minSeparation = b3Min(minSeparation, separation);
+
+				// Separate the shapes by the slop and prevent large corrections.
+				float32 C = b3Clamp(B3_TOI_BAUMGARTE * (separation - b3_toiSeparation), -B3_MAX_LINEAR_CORRECTION, 0.0f);
+
+				// Compute effective mass.
+				float32 K = mA + mB;
+
+				// Compute normal impulse.
+				float32 impulse = K > 0.0f ? -C / K : 0.0f;
+				b3Vec3 P = impulse * normal;
+
+				cA -= mA * P;
+				cB += mB * P;
+			}
+		}
+
+		m_positions[indexA].x = cA;
+		m_positions[indexA].q = qA;
+
+		m_positions[indexB].x = cB;
+		m_positions[indexB].q = qB;
+	}
+
+	return minSeparation >= 0.5f * b3_toiSeparation;
+}
\ No newline at end of file
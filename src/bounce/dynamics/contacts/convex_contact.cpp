@@ -47,8 +47,10 @@ bool b3ConvexContact::TestOverlap()
 	return b3TestOverlap(xfA, 0, shapeA, xfB, 0, shapeB, &m_cache);
 }
 
-void b3ConvexContact::Collide()
+void b3ConvexContact::Collide(b3StackAllocator* allocator)
 {
+	B3_NOT_USED(allocator);
+
 	b3Shape* shapeA = GetShapeA();
 	b3Body* bodyA = shapeA->GetBody();
 	b3Transform xfA = bodyA->GetTransform();
@@ -60,4 +62,24 @@ void b3ConvexContact::Collide()
 	B3_ASSERT(m_manifoldCount == 0);
 	b3CollideShapeAndShape(m_stackManifold, xfA, shapeA, xfB, shapeB, &m_cache);
 	m_manifoldCount = 1;
-}
\ No newline at end of file
+}
+
+float32 b3ConvexContact::ComputeTOI()
+{
+	b3Shape* shapeA = GetShapeA();
+	const b3Sweep& sweepA = shapeA->GetBody()->GetSweep();
+
+	b3Shape* shapeB = GetShapeB();
+	const b3Sweep& sweepB = shapeB->GetBody()->GetSweep();
+
+	b3ShapeGJKProxy proxyA(shapeA, 0);
+	b3ShapeGJKProxy proxyB(shapeB, 0);
+
+	b3GJKTOIOutput output;
+	if (b3GJKTimeOfImpact(&output, sweepA, proxyA, sweepB, proxyB, 1.0f))
+	{
+		return output.t;
+	}
+
+	return 1.0f;
+}
@@ -48,6 +48,17 @@ b3MeshContact::b3MeshContact(b3Shape* shapeA, b3Shape* shapeB)
 	m_aabbA = fatAABB;
 	m_aabbMoved = true;
 
+	m_xfA = xf;
+	m_radiusA = 0.0f;
+	if (shapeA->GetType() == e_meshShape)
+	{
+		const b3Mesh* meshA = ((b3MeshShape*)shapeA)->m_mesh;
+		for (u32 i = 0; i < meshA->vertexCount; ++i)
+		{
+			m_radiusA = b3Max(m_radiusA, b3Length(meshA->vertices[i]));
+		}
+	}
+
 	// Pre-allocate some indices
 	m_triangleCapacity = 16;
 	m_triangles = (b3TriangleCache*)b3Alloc(m_triangleCapacity * sizeof(b3TriangleCache));
@@ -80,6 +91,12 @@ void b3MeshContact::SynchronizeShapes()
 
 	// Compute the AABB in the reference frame of shape B.
 	b3Transform xf = b3MulT(xfB, xfA);
+
+	if (shapeA->GetType() == e_meshShape)
+	{
+		m_aabbMoved = MoveMesh(xf);
+		return;
+	}
 	
 	b3AABB3 aabb;
 	shapeA->ComputeAABB(&aabb, xf);
@@ -137,6 +154,26 @@ bool b3MeshContact::MoveAABB(const b3AABB3& aabb, const b3Vec3& displacement)
 	return true;
 }
 
+bool b3MeshContact::MoveMesh(const b3Transform& xf)
+{
+	// Bound the displacement of the vertices of the mesh A.
+	// The rotation difference is bounded by its Frobenius norm.
+	b3Mat33 dR = xf.rotation - m_xfA.rotation;
+	float32 rotationBound = b3Sqrt(b3Dot(dR.x, dR.x) + b3Dot(dR.y, dR.y) + b3Dot(dR.z, dR.z));
+	float32 displacement = b3Length(xf.position - m_xfA.position) + rotationBound * m_radiusA;
+
+	// The triangle pairs were found with the triangles of the mesh A 
+	// extended by the AABB extension, so they are valid until 
+	// any vertex moves farther.
+	if (displacement < B3_AABB_EXTENSION)
+	{
+		return false;
+	}
+
+	m_xfA = xf;
+	return true;
+}
+
 void b3MeshContact::FindNewPairs()
 {
 	// Reuse the overlapping buffer if the AABB didn't move
@@ -153,19 +190,26 @@ void b3MeshContact::FindNewPairs()
 	const b3Mesh* meshB = meshShapeB->m_mesh;
 	const b3StaticTree* tree = &meshB->tree;
 
+	const b3Shape* shapeA = GetShapeA();
+	if (shapeA->GetType() == e_meshShape)
+	{
+		// Walk the two trees simultaneously to find the triangle pairs.
+		const b3MeshShape* meshShapeA = (b3MeshShape*)shapeA;
+		const b3StaticTree* treeA = &meshShapeA->m_mesh->tree;
+
+		float32 radius = meshShapeA->m_radius + meshShapeB->m_radius + B3_AABB_EXTENSION;
+
+		tree->QueryTree(this, *treeA, m_xfA, radius);
+		return;
+	}
+
 	// Query and update the overlapping buffer.
 	tree->QueryAABB(this, m_aabbA);
 }
 
-bool b3MeshContact::Report(u32 proxyId)
+void b3MeshContact::AddPair(u32 indexA, u32 indexB)
 {
-	b3MeshShape* meshShapeB = (b3MeshShape*)GetShapeB();
-	const b3Mesh* meshB = meshShapeB->m_mesh;
-	const b3StaticTree* treeB = &meshB->tree;
-
-	u32 triangleIndex = treeB->GetUserData(proxyId);
-
-	// Add the triangle to the overlapping buffer.
+	// Add the pair to the overlapping buffer.
 	if (m_triangleCount == m_triangleCapacity)
 	{
 		b3TriangleCache* oldElements = m_triangles;
@@ -178,22 +222,47 @@ bool b3MeshContact::Report(u32 proxyId)
 	B3_ASSERT(m_triangleCount  < m_triangleCapacity);
 
 	b3TriangleCache* cache = m_triangles + m_triangleCount;
-	cache->index = triangleIndex;
+	cache->indexA = indexA;
+	cache->index = indexB;
 	cache->cache.simplexCache.count = 0;
 	cache->cache.featureCache.m_featurePair.state = b3SATCacheType::e_empty;
 	
 	++m_triangleCount;
+}
+
+bool b3MeshContact::Report(u32 proxyId)
+{
+	b3MeshShape* meshShapeB = (b3MeshShape*)GetShapeB();
+	const b3Mesh* meshB = meshShapeB->m_mesh;
+	const b3StaticTree* treeB = &meshB->tree;
+
+	u32 triangleIndex = treeB->GetUserData(proxyId);
+
+	AddPair(0, triangleIndex);
 
 	// Keep looking for triangles.
 	return true;
 }
 
+bool b3MeshContact::Report(u32 proxyIdA, u32 proxyIdB)
+{
+	b3MeshShape* meshShapeA = (b3MeshShape*)GetShapeA();
+	b3MeshShape* meshShapeB = (b3MeshShape*)GetShapeB();
+
+	u32 triangleIndexA = meshShapeA->m_mesh->tree.GetUserData(proxyIdA);
+	u32 triangleIndexB = meshShapeB->m_mesh->tree.GetUserData(proxyIdB);
+
+	AddPair(triangleIndexA, triangleIndexB);
+
+	// Keep looking for triangle pairs.
+	return true;
+}
+
 bool b3MeshContact::TestOverlap()
 {
 	b3Shape* shapeA = GetShapeA();
 	b3Body* bodyA = shapeA->GetBody();
 	b3Transform xfA = bodyA->GetTransform();
-	u32 indexA = 0;
 
 	b3Shape* shapeB = GetShapeB();
 	b3Body* bodyB = shapeB->GetBody();
@@ -203,6 +272,7 @@ bool b3MeshContact::TestOverlap()
 	for (u32 i = 0; i < m_triangleCount; ++i)
 	{
 		b3TriangleCache* cache = m_triangles + i;
+		u32 indexA = cache->indexA;
 		u32 indexB = cache->index;
 		bool overlap = b3TestOverlap(xfA, indexA, shapeA, xfB, indexB, shapeB, &cache->cache);
 		if (overlap == true)
@@ -214,7 +284,11 @@ bool b3MeshContact::TestOverlap()
 	return false;
 }
 
-void b3MeshContact::Collide()
+// The contact normal of two triangles can be nearly tangent to a triangle. 
+// This is the cosine tolerance used to decide its side.
+const float32 b3_triangleNormalTolerance = 0.05f;
+
+void b3MeshContact::Collide(b3StackAllocator* allocator)
 {
 	B3_ASSERT(m_manifoldCount == 0);
 
@@ -227,8 +301,19 @@ void b3MeshContact::Collide()
 	b3MeshShape* meshShapeB = (b3MeshShape*)shapeB;
 	b3Transform xfB = bodyB->GetTransform();
 
-	b3World* world = bodyA->GetWorld();
-	b3StackAllocator* allocator = &world->m_stackAllocator;
+	// If the shape A is a mesh then each triangle A is collided as a hull.
+	const b3Mesh* meshA = NULL;
+	if (shapeA->GetType() == e_meshShape)
+	{
+		meshA = ((b3MeshShape*)shapeA)->m_mesh;
+	}
+
+	b3TriangleHull hullA;
+
+	b3HullShape hullShapeA;
+	hullShapeA.m_body = bodyA;
+	hullShapeA.m_hull = &hullA;
+	hullShapeA.m_radius = B3_HULL_RADIUS;
 
 	// Create one manifold per triangle.
 	b3Manifold* tempManifolds = (b3Manifold*)allocator->Allocate(m_triangleCount * sizeof(b3Manifold));
@@ -255,11 +340,51 @@ void b3MeshContact::Collide()
 		b3Manifold* manifold = tempManifolds + tempCount;
 		manifold->Initialize();
 		
-		b3CollideShapeAndShape(*manifold, xfA, shapeA, xfB, &hullShapeB, &triangleCache->cache);
+		u32 triangleKey = triangleIndex;
+
+		if (meshA)
+		{
+			u32 triangleIndexA = triangleCache->indexA;
+			b3Triangle* triangleA = meshA->triangles + triangleIndexA;
+
+			hullA.Set(meshA->vertices[triangleA->v1], meshA->vertices[triangleA->v2], meshA->vertices[triangleA->v3]);
+
+			b3CollideShapeAndShape(*manifold, xfA, &hullShapeA, xfB, &hullShapeB, &triangleCache->cache);
+
+			// Triangles have no volume, so the contact normal of two triangles can point 
+			// to either side. Using the triangle normals given by the mesh winding, 
+			// drop the normal if it points into the triangle A, 
+			// out of the triangle B, or if it is tangent to both triangles.
+			if (manifold->pointCount > 0)
+			{
+				b3Vec3 n = manifold->points[0].localNormal1;
+				b3Vec3 nA = hullA.trianglePlanes[0].normal;
+				b3Vec3 nB = b3MulT(xfA.rotation, b3Mul(xfB.rotation, hullB.trianglePlanes[0].normal));
+
+				float32 cosA = b3Dot(n, nA);
+				float32 cosB = b3Dot(n, nB);
+
+				bool wrongSide = cosA < -b3_triangleNormalTolerance || cosB > b3_triangleNormalTolerance;
+				bool tangent = cosA < b3_triangleNormalTolerance && cosB > -b3_triangleNormalTolerance;
+				
+				if (wrongSide || tangent)
+				{
+					manifold->pointCount = 0;
+				}
+			}
+
+			// Identify the triangle pair. 
+			// The key wraps around for very large meshes, which only affects warm starting.
+			triangleKey = triangleIndexA * meshB->triangleCount + triangleIndex;
+		}
+		else
+		{
+			b3CollideShapeAndShape(*manifold, xfA, shapeA, xfB, &hullShapeB, &triangleCache->cache);
+		}
 		
 		for (u32 j = 0; j < manifold->pointCount; ++j)
 		{
-			manifold->points[j].triangleKey = triangleIndex;
+			manifold->points[j].triangleKey = triangleKey;
 		}
 		
 		++tempCount;
@@ -270,4 +395,71 @@ void b3MeshContact::Collide()
 	m_manifoldCount = b3Clusterize(m_stackManifolds, tempManifolds, tempCount, xfA, shapeA->m_radius, xfB, B3_HULL_RADIUS);
 	
 	allocator->Free(tempManifolds);
+}
+
+// Static tree callback for the time of impact of the triangles.
+struct b3MeshContactTOICallback
+{
+	bool Report(u32 proxyId)
+	{
+		u32 triangleIndex = meshB->m_mesh->tree.GetUserData(proxyId);
+
+		b3ShapeGJKProxy proxyB(meshB, triangleIndex);
+
+		b3GJKTOIOutput output;
+		if (b3GJKTimeOfImpact(&output, *sweepA, *proxyA, *sweepB, proxyB, t))
+		{
+			t = output.t;
+		}
+
+		// Keep looking for earlier impacts.
+		return true;
+	}
+
+	const b3Sweep* sweepA;
+	const b3GJKProxy* proxyA;
+	const b3Sweep* sweepB;
+	const b3MeshShape* meshB;
+	float32 t;
+};
+
+float32 b3MeshContact::ComputeTOI()
+{
+	b3Shape* shapeA = GetShapeA();
+	if (shapeA->GetType() == e_meshShape)
+	{
+		// Continuous collision between meshes isn't supported.
+		return 1.0f;
+	}
+
+	const b3Sweep& sweepA = shapeA->GetBody()->GetSweep();
+
+	b3MeshShape* meshShapeB = (b3MeshShape*)GetShapeB();
+	const b3Sweep& sweepB = meshShapeB->GetBody()->GetSweep();
+
+	// The triangle cache only holds the triangles overlapping the final AABB.
+	// Find the triangles overlapping the AABB swept by the shape A 
+	// in the frame of the shape B.
+	b3Transform xf0 = b3MulT(sweepB.GetTransform(0.0f), sweepA.GetTransform(0.0f));
+	b3Transform xf1 = b3MulT(sweepB.GetTransform(1.0f), sweepA.GetTransform(1.0f));
+
+	b3AABB3 aabb0, aabb1;
+	shapeA->ComputeAABB(&aabb0, xf0);
+	shapeA->ComputeAABB(&aabb1, xf1);
+
+	b3AABB3 aabb = b3Combine(aabb0, aabb1);
+	aabb.Extend(meshShapeB->m_radius + B3_LINEAR_SLOP);
+
+	b3ShapeGJKProxy proxyA(shapeA, 0);
+
+	b3MeshContactTOICallback callback;
+	callback.sweepA = &sweepA;
+	callback.proxyA = &proxyA;
+	callback.sweepB = &sweepB;
+	callback.meshB = meshShapeB;
+	callback.t = 1.0f;
+
+	meshShapeB->m_mesh->tree.QueryAABB(&callback, aabb);
+
+	return callback.t;
 }
\ No newline at end of file
@@ -17,6 +17,7 @@
 */
 
 #include <bounce/dynamics/island.h>
+#include <bounce/dynamics/coloring.h>
 #include <bounce/dynamics/body.h>
 #include <bounce/dynamics/time_step.h>
 #include <bounce/dynamics/joints/joint.h>
@@ -24,62 +25,133 @@
 #include <bounce/dynamics/contacts/contact.h>
 #include <bounce/dynamics/contacts/contact_solver.h>
 #include <bounce/common/memory/stack_allocator.h>
+#include <bounce/common/thread/thread_pool.h>
 
-b3Island::b3Island(b3StackAllocator* allocator, u32 bodyCapacity, u32 contactCapacity, u32 jointCapacity) 
+// The number of constraints of a color solved per task.
+const u32 b3_colorGrainSize = 64;
+
+b3Island::b3Island(b3StackAllocator* allocator, b3ThreadPool* threadPool, 
+	b3Body** bodies, u32 bodyCount, 
+	b3Contact** contacts, u32 contactCount, 
+	b3Joint** joints, u32 jointCount) 
 {
 	m_allocator = allocator;
-	m_bodyCapacity = bodyCapacity;
-	m_contactCapacity = contactCapacity;
-	m_jointCapacity = jointCapacity;
+	m_threadPool = threadPool;
+	
+	m_bodies = bodies;
+	m_bodyCount = bodyCount;
+	
+	m_contacts = contacts;
+	m_contactCount = contactCount;
 	
-	m_bodies = (b3Body**)m_allocator->Allocate(m_bodyCapacity * sizeof(b3Body*));
-	m_velocities = (b3Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b3Velocity));
-	m_positions = (b3Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b3Position));
-	m_contacts = (b3Contact**)m_allocator->Allocate(m_contactCapacity * sizeof(b3Contact*));
-	m_joints = (b3Joint**)m_allocator->Allocate(m_jointCapacity * sizeof(b3Joint*));
-
-	m_bodyCount = 0;
-	m_contactCount = 0;
-	m_jointCount = 0;
+	m_joints = joints;
+	m_jointCount = jointCount;
+
+	m_velocities = (b3Velocity*)m_allocator->Allocate(m_bodyCount * sizeof(b3Velocity));
+	m_positions = (b3Position*)m_allocator->Allocate(m_bodyCount * sizeof(b3Position));
 }
 
 b3Island::~b3Island() 
 {
 	// @note Reverse order of construction.
-	m_allocator->Free(m_joints);
-	m_allocator->Free(m_contacts);
 	m_allocator->Free(m_positions);
 	m_allocator->Free(m_velocities);
-	m_allocator->Free(m_bodies);
 }
 
-void b3Island::Clear() 
+template<class T>
+struct b3Island::b3ConstraintBodies
 {
-	m_bodyCount = 0;
-	m_contactCount = 0;
-	m_jointCount = 0;
-}
+	u32 operator()(T* c, u32* vertices) const
+	{
+		u32 n = 0;
+		if (!shareStatic || bodies[c->m_indexA]->GetType() == e_dynamicBody)
+		{
+			vertices[n++] = c->m_indexA;
+		}
+		if (!shareStatic || bodies[c->m_indexB]->GetType() == e_dynamicBody)
+		{
+			vertices[n++] = c->m_indexB;
+		}
+		return n;
+	}
 
-void b3Island::Add(b3Body* b) 
+	b3Body** bodies;
+	bool shareStatic;
+};
+
+template<class T>
+void b3Island::Color(T** constraints, u32 count, bool shareStatic, u32* offsets)
 {
-	B3_ASSERT(m_bodyCount < m_bodyCapacity);
-	b->m_islandID = m_bodyCount;
-	m_bodies[m_bodyCount] = b;
-	++m_bodyCount;
+	b3ConstraintBodies<T> vertices;
+	vertices.bodies = m_bodies;
+	vertices.shareStatic = shareStatic;
+
+	u32* bodyMasks = (u32*)m_allocator->Allocate(m_bodyCount * sizeof(u32));
+	u8* colors = (u8*)m_allocator->Allocate(count * sizeof(u8));
+	T** sorted = (T**)m_allocator->Allocate(count * sizeof(T*));
+
+	b3ColorConstraints(constraints, count, vertices, bodyMasks, m_bodyCount, colors, sorted, offsets);
+
+	m_allocator->Free(sorted);
+	m_allocator->Free(colors);
+	m_allocator->Free(bodyMasks);
 }
 
-void b3Island::Add(b3Contact* c) 
+// Solves a range of velocity constraints of a color.
+template<class T>
+struct b3SolveColorTask
 {
-	B3_ASSERT(m_contactCount < m_contactCapacity);
-	m_contacts[m_contactCount] = c;
-	++m_contactCount;
-}
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
 
-void b3Island::Add(b3Joint* j) 
+		solver->SolveVelocityConstraints(offset + begin, offset + end);
+	}
+
+	T* solver;
+	u32 offset;
+};
+
+// Solves wide contact velocity constraints.
+struct b3WideContactSolver
 {
-	B3_ASSERT(m_jointCount < m_jointCapacity);
-	m_joints[m_jointCount] = j;
-	++m_jointCount;
+	void SolveVelocityConstraints(u32 begin, u32 end)
+	{
+		solver->SolveWideVelocityConstraints(begin, end);
+	}
+
+	b3ContactSolver* solver;
+};
+
+// Solve the velocity constraints color by color. 
+template<class T>
+static void b3SolveColors(b3ThreadPool* threadPool, T* solver, const u32* offsets)
+{
+	for (u32 i = 0; i < B3_MAX_CONSTRAINT_COLORS; ++i)
+	{
+		u32 begin = offsets[i];
+		u32 count = offsets[i + 1] - begin;
+		if (count == 0)
+		{
+			continue;
+		}
+
+		if (threadPool)
+		{
+			b3SolveColorTask<T> task;
+			task.solver = solver;
+			task.offset = begin;
+			
+			threadPool->ParallelFor(&task, count, b3_colorGrainSize);
+		}
+		else
+		{
+			solver->SolveVelocityConstraints(begin, begin + count);
+		}
+	}
+
+	// The constraints that couldn't be colored are solved last.
+	solver->SolveVelocityConstraints(offsets[B3_MAX_CONSTRAINT_COLORS], offsets[B3_MAX_CONSTRAINT_COLORS + 1]);
 }
 
 // Box2D
@@ -118,9 +190,14 @@ void b3Island::Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations,
 		b3Vec3 x = b->m_sweep.worldCenter;
 		b3Quat q = b->m_sweep.orientation;
 
-		// Remember the positions for CCD
-		b->m_sweep.worldCenter0 = b->m_sweep.worldCenter;
-		b->m_sweep.orientation0 = b->m_sweep.orientation;
+		// Static bodies can be on many islands. Don't write to them.
+		if (b->m_type != e_staticBody)
+		{
+			// Remember the positions for CCD
+			b->m_sweep.worldCenter0 = b->m_sweep.worldCenter;
+			b->m_sweep.orientation0 = b->m_sweep.orientation;
+			b->m_sweep.t0 = 0.0f;
+		}
 
 		if (b->m_type == e_dynamicBody) 
 		{
@@ -173,6 +250,18 @@ void b3Island::Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations,
 		m_positions[i].q = q;
 	}
 
+	// Sort the constraints by color so that each color can be solved in parallel.
+	// Contacts don't write to static and kinematic bodies, so they can share them.
+	bool colored = (flags & e_colorBit) != 0;
+	
+	u32 contactColors[B3_MAX_CONSTRAINT_COLORS + 2];
+	u32 jointColors[B3_MAX_CONSTRAINT_COLORS + 2];
+	if (colored)
+	{
+		Color(m_contacts, m_contactCount, true, contactColors);
+		Color(m_joints, m_jointCount, false, jointColors);
+	}
+
 	b3JointSolverDef jointSolverDef;
 	jointSolverDef.joints = m_joints;
 	jointSolverDef.count = m_jointCount;
@@ -192,7 +281,7 @@ void b3Island::Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations,
 
 	// 2. Initialize constraints
 	{
-		B3_PROFILE("Initialize Constraints");
+		B3_PROFILE_IF((flags & e_profileBit) != 0, "Initialize Constraints");
 		
 		contactSolver.InitializeConstraints();
 
@@ -209,14 +298,40 @@ void b3Island::Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations,
 		}
 	}
 
+	// The contacts of a color don't share dynamic bodies. 
+	// Therefore they can be solved in the lanes of wide constraints.
+	// The contacts that couldn't be colored are solved sequentially.
+	u32 wideContactColors[B3_MAX_CONSTRAINT_COLORS + 2];
+	b3WideContactSolver wideContactSolver;
+	wideContactSolver.solver = &contactSolver;
+	if (colored)
+	{
+		contactSolver.PackWideConstraints(contactColors, B3_MAX_CONSTRAINT_COLORS, wideContactColors);
+		wideContactColors[B3_MAX_CONSTRAINT_COLORS + 1] = wideContactColors[B3_MAX_CONSTRAINT_COLORS];
+	}
+
 	// 3. Solve velocity constraints
 	{
-		B3_PROFILE("Solve Velocity Constraints");
+		B3_PROFILE_IF((flags & e_profileBit) != 0, "Solve Velocity Constraints");
 
 		for (u32 i = 0; i < velocityIterations; ++i)
 		{
-			jointSolver.SolveVelocityConstraints();
-			contactSolver.SolveVelocityConstraints();
+			if (colored)
+			{
+				b3SolveColors(m_threadPool, &jointSolver, jointColors);
+				b3SolveColors(m_threadPool, &wideContactSolver, wideContactColors);
+				contactSolver.SolveVelocityConstraints(contactColors[B3_MAX_CONSTRAINT_COLORS], contactColors[B3_MAX_CONSTRAINT_COLORS + 1]);
+			}
+			else
+			{
+				jointSolver.SolveVelocityConstraints();
+				contactSolver.SolveVelocityConstraints();
+			}
+		}
+
+		if (colored)
+		{
+			contactSolver.UnpackWideConstraints();
 		}
 
 		if (flags & e_warmStartBit)
@@ -260,7 +375,7 @@ void b3Island::Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations,
 
 	// 5. Solve position constraints
 	{
-		B3_PROFILE("Solve Position Constraints");
+		B3_PROFILE_IF((flags & e_profileBit) != 0, "Solve Position Constraints");
 		
 		bool positionsSolved = false;
 		for (u32 i = 0; i < positionIterations; ++i) 
@@ -280,6 +395,11 @@ void b3Island::Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations,
 	for (u32 i = 0; i < m_bodyCount; ++i) 
 	{
 		b3Body* b = m_bodies[i];
+		if (b->m_type == e_staticBody)
+		{
+			continue;
+		}
+
 		b->m_sweep.worldCenter = m_positions[i].x;
 		b->m_sweep.orientation = m_positions[i].q;
 		b->m_sweep.orientation.Normalize();
@@ -324,8 +444,123 @@ void b3Island::Solve(const b3Vec3& gravity, float32 dt, u32 velocityIterations,
 		{
 			for (u32 i = 0; i < m_bodyCount; ++i) 
 			{
-				m_bodies[i]->SetAwake(false);
+				b3Body* b = m_bodies[i];
+				if (b->m_type == e_staticBody)
+				{
+					continue;
+				}
+
+				b->SetAwake(false);
 			}
 		}
 	}
 }
+
+void b3Island::SolveTOI(float32 dt, u32 velocityIterations, u32 positionIterations, u32 toiIndexA, u32 toiIndexB)
+{
+	B3_ASSERT(toiIndexA < m_bodyCount);
+	B3_ASSERT(toiIndexB < m_bodyCount);
+
+	float32 h = dt;
+
+	// 1. Copy the body states at the time of impact. 
+	// No forces are integrated because they were applied in the discrete step.
+	for (u32 i = 0; i < m_bodyCount; ++i)
+	{
+		b3Body* b = m_bodies[i];
+		m_positions[i].x = b->m_sweep.worldCenter;
+		m_positions[i].q = b->m_sweep.orientation;
+		m_velocities[i].v = b->m_linearVelocity;
+		m_velocities[i].w = b->m_angularVelocity;
+	}
+
+	b3ContactSolverDef contactSolverDef;
+	contactSolverDef.allocator = m_allocator;
+	contactSolverDef.contacts = m_contacts;
+	contactSolverDef.count = m_contactCount;
+	contactSolverDef.positions = m_positions;
+	contactSolverDef.velocities = m_velocities;
+	contactSolverDef.dt = h;
+	b3ContactSolver contactSolver(&contactSolverDef);
+
+	contactSolver.InitializeConstraints();
+
+	// 2. Solve position constraints
+	for (u32 i = 0; i < positionIterations; ++i)
+	{
+		if (contactSolver.SolveTOIPositionConstraints(toiIndexA, toiIndexB))
+		{
+			break;
+		}
+	}
+
+	// The bodies of the time of impact start the sub-step from the solved positions.
+	m_bodies[toiIndexA]->m_sweep.worldCenter0 = m_positions[toiIndexA].x;
+	m_bodies[toiIndexA]->m_sweep.orientation0 = m_positions[toiIndexA].q;
+	m_bodies[toiIndexB]->m_sweep.worldCenter0 = m_positions[toiIndexB].x;
+	m_bodies[toiIndexB]->m_sweep.orientation0 = m_positions[toiIndexB].q;
+
+	// 3. Solve velocity constraints
+	// The constraints are initialized again at the solved positions.
+	// They aren't warm started because the impulses were already 
+	// applied in the discrete step. The impulses aren't stored.
+	contactSolver.InitializeConstraints();
+	contactSolver.ResetImpulses();
+
+	for (u32 i = 0; i < velocityIterations; ++i)
+	{
+		contactSolver.SolveVelocityConstraints();
+	}
+
+	// 4. Integrate positions
+	for (u32 i = 0; i < m_bodyCount; ++i) 
+	{
+		b3Vec3 x = m_positions[i].x;
+		b3Quat q = m_positions[i].q;
+		b3Vec3 v = m_velocities[i].v;
+		b3Vec3 w = m_velocities[i].w;
+
+		// Prevent numerical instability due to large velocity changes.		
+		b3Vec3 translation = h * v;
+		if (b3Dot(translation, translation) > B3_MAX_TRANSLATION_SQUARED)
+		{
+			float32 ratio = B3_MAX_TRANSLATION / b3Length(translation);
+			v *= ratio;
+		}
+
+		b3Vec3 rotation = h * w;
+		if (b3Dot(rotation, rotation) > B3_MAX_ROTATION_SQUARED)
+		{
+			float32 ratio = B3_MAX_ROTATION / b3Length(rotation);
+			w *= ratio;
+		}
+
+		// Integrate
+		x += h * v;
+		q = b3Integrate(q, w, h);
+
+		m_positions[i].x = x;
+		m_positions[i].q = q;
+		m_velocities[i].v = v;
+		m_velocities[i].w = w;
+	}
+
+	// 5. Copy state buffers back to the bodies
+	for (u32 i = 0; i < m_bodyCount; ++i) 
+	{
+		b3Body* b = m_bodies[i];
+		if (b->m_type == e_staticBody)
+		{
+			continue;
+		}
+
+		b->m_sweep.worldCenter = m_positions[i].x;
+		b->m_sweep.orientation = m_positions[i].q;
+		b->m_sweep.orientation.Normalize();
+		b->m_linearVelocity = m_velocities[i].v;
+		b->m_angularVelocity = m_velocities[i].w;	
+		b->SynchronizeTransform();
+		// Transform body inertia to world inertia
+		b->m_worldInvI = b3RotateToFrame(b->m_invI, b->m_xf.rotation);
+	}
+}
\ No newline at end of file
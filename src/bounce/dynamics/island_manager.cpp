@@ -0,0 +1,419 @@
+/*
+* Copyright (c) 2016-2016 Irlan Robson http://www.irlan.net
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce/dynamics/island_manager.h>
+#include <bounce/dynamics/body.h>
+#include <bounce/dynamics/shapes/shape.h>
+#include <bounce/dynamics/contacts/contact.h>
+#include <bounce/dynamics/joints/joint.h>
+#include <bounce/common/memory/stack_allocator.h>
+
+b3IslandManager::b3IslandManager() : m_islandBlocks(sizeof(b3PersistentIsland))
+{
+}
+
+b3IslandManager::~b3IslandManager()
+{
+}
+
+b3PersistentIsland* b3IslandManager::CreateIsland(bool awake)
+{
+	void* mem = m_islandBlocks.Allocate();
+	b3PersistentIsland* island = new (mem) b3PersistentIsland();
+	island->m_constraintRemoveCount = 0;
+	island->m_awake = awake;
+	if (awake)
+	{
+		m_awakeList.PushFront(island);
+	}
+	else
+	{
+		m_sleepingList.PushFront(island);
+	}
+	return island;
+}
+
+void b3IslandManager::DestroyIsland(b3PersistentIsland* island)
+{
+	if (island->m_awake)
+	{
+		m_awakeList.Remove(island);
+	}
+	else
+	{
+		m_sleepingList.Remove(island);
+	}
+	island->~b3PersistentIsland();
+	m_islandBlocks.Free(island);
+}
+
+void b3IslandManager::WakeIsland(b3PersistentIsland* island)
+{
+	if (island->m_awake == false)
+	{
+		m_sleepingList.Remove(island);
+		m_awakeList.PushFront(island);
+		island->m_awake = true;
+	}
+}
+
+void b3IslandManager::SleepIsland(b3PersistentIsland* island)
+{
+	if (island->m_awake == true)
+	{
+		m_awakeList.Remove(island);
+		m_sleepingList.PushFront(island);
+		island->m_awake = false;
+	}
+}
+
+void b3IslandManager::AddBody(b3Body* b)
+{
+	B3_ASSERT(b->m_type != e_staticBody);
+	B3_ASSERT(b->m_island == NULL);
+
+	b3PersistentIsland* island = CreateIsland(b->IsAwake());
+	b->m_island = island;
+	b->m_islandLink.m_item = b;
+	island->m_bodies.PushFront(&b->m_islandLink);
+}
+
+void b3IslandManager::RemoveBody(b3Body* b)
+{
+	b3PersistentIsland* island = b->m_island;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	island->m_bodies.Remove(&b->m_islandLink);
+	b->m_island = NULL;
+	b->m_flags &= ~b3Body::e_islandFlag;
+
+	if (island->m_bodies.m_count == 0)
+	{
+		// The island doesn't have constraints without bodies.
+		B3_ASSERT(island->m_contacts.m_count == 0);
+		B3_ASSERT(island->m_joints.m_count == 0);
+		DestroyIsland(island);
+	}
+	else
+	{
+		// Removing a body which is connected to others requires removing 
+		// a constraint first, so the island is already marked for splitting.
+		B3_ASSERT(island->m_constraintRemoveCount > 0);
+	}
+}
+
+void b3IslandManager::Merge(b3PersistentIsland* dst, b3PersistentIsland* src)
+{
+	while (src->m_bodies.m_head)
+	{
+		b3IslandLink<b3Body>* link = src->m_bodies.m_head;
+		src->m_bodies.Remove(link);
+		dst->m_bodies.PushFront(link);
+		link->m_item->m_island = dst;
+	}
+
+	while (src->m_contacts.m_head)
+	{
+		b3IslandLink<b3Contact>* link = src->m_contacts.m_head;
+		src->m_contacts.Remove(link);
+		dst->m_contacts.PushFront(link);
+		link->m_item->m_island = dst;
+	}
+
+	while (src->m_joints.m_head)
+	{
+		b3IslandLink<b3Joint>* link = src->m_joints.m_head;
+		src->m_joints.Remove(link);
+		dst->m_joints.PushFront(link);
+		link->m_item->m_island = dst;
+	}
+
+	dst->m_constraintRemoveCount += src->m_constraintRemoveCount;
+	
+	if (src->m_awake)
+	{
+		WakeIsland(dst);
+	}
+
+	DestroyIsland(src);
+}
+
+b3PersistentIsland* b3IslandManager::Link(b3Body* bodyA, b3Body* bodyB)
+{
+	// Static bodies don't have islands.
+	b3PersistentIsland* islandA = bodyA->m_island;
+	b3PersistentIsland* islandB = bodyB->m_island;
+
+	if (islandA == NULL)
+	{
+		return islandB;
+	}
+
+	if (islandB == NULL || islandA == islandB)
+	{
+		return islandA;
+	}
+
+	// Move the elements of the smaller island into the larger one.
+	u32 sizeA = islandA->m_bodies.m_count + islandA->m_contacts.m_count + islandA->m_joints.m_count;
+	u32 sizeB = islandB->m_bodies.m_count + islandB->m_contacts.m_count + islandB->m_joints.m_count;
+	if (sizeA < sizeB)
+	{
+		Merge(islandB, islandA);
+		return islandB;
+	}
+
+	Merge(islandA, islandB);
+	return islandA;
+}
+
+void b3IslandManager::AddContact(b3Contact* c)
+{
+	B3_ASSERT(c->m_island == NULL);
+
+	b3PersistentIsland* island = Link(c->GetShapeA()->GetBody(), c->GetShapeB()->GetBody());
+	if (island == NULL)
+	{
+		return;
+	}
+
+	c->m_island = island;
+	c->m_islandLink.m_item = c;
+	island->m_contacts.PushFront(&c->m_islandLink);
+}
+
+void b3IslandManager::RemoveContact(b3Contact* c)
+{
+	b3PersistentIsland* island = c->m_island;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	island->m_contacts.Remove(&c->m_islandLink);
+	++island->m_constraintRemoveCount;
+	c->m_island = NULL;
+}
+
+void b3IslandManager::AddJoint(b3Joint* j)
+{
+	B3_ASSERT(j->m_island == NULL);
+
+	b3PersistentIsland* island = Link(j->GetBodyA(), j->GetBodyB());
+	if (island == NULL)
+	{
+		return;
+	}
+
+	j->m_island = island;
+	j->m_islandLink.m_item = j;
+	island->m_joints.PushFront(&j->m_islandLink);
+}
+
+void b3IslandManager::RemoveJoint(b3Joint* j)
+{
+	b3PersistentIsland* island = j->m_island;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	island->m_joints.Remove(&j->m_islandLink);
+	++island->m_constraintRemoveCount;
+	j->m_island = NULL;
+}
+
+void b3IslandManager::SplitIsland(b3PersistentIsland* root, b3StackAllocator* allocator)
+{
+	B3_ASSERT(root->m_awake);
+
+	u32 bodyCount = root->m_bodies.m_count;
+	b3Body** bodies = (b3Body**)allocator->Allocate(bodyCount * sizeof(b3Body*));
+	b3Body** stack = (b3Body**)allocator->Allocate(bodyCount * sizeof(b3Body*));
+
+	// Clear the visited flags and empty the island.
+	// The island is reused for the first component.
+	u32 count = 0;
+	for (b3IslandLink<b3Body>* link = root->m_bodies.m_head; link; link = link->m_next)
+	{
+		b3Body* b = link->m_item;
+		b->m_flags &= ~b3Body::e_islandFlag;
+		bodies[count++] = b;
+	}
+
+	for (b3IslandLink<b3Contact>* link = root->m_contacts.m_head; link; link = link->m_next)
+	{
+		link->m_item->m_flags &= ~b3Contact::e_islandFlag;
+	}
+
+	for (b3IslandLink<b3Joint>* link = root->m_joints.m_head; link; link = link->m_next)
+	{
+		link->m_item->m_flags &= ~b3Joint::e_islandFlag;
+	}
+
+	root->m_bodies.m_head = NULL;
+	root->m_bodies.m_count = 0;
+	root->m_contacts.m_head = NULL;
+	root->m_contacts.m_count = 0;
+	root->m_joints.m_head = NULL;
+	root->m_joints.m_count = 0;
+	root->m_constraintRemoveCount = 0;
+
+	// Traverse the bodies in their island order to keep the result deterministic.
+	b3PersistentIsland* island = NULL;
+	for (u32 i = count; i > 0; --i)
+	{
+		b3Body* seed = bodies[i - 1];
+
+		// The seed must not be on a component.
+		if (seed->m_flags & b3Body::e_islandFlag)
+		{
+			continue;
+		}
+
+		island = island == NULL ? root : CreateIsland(true);
+
+		bool awake = false;
+
+		// Perform a depth first search on this body constraint graph.
+		u32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b3Body::e_islandFlag;
+
+		while (stackCount > 0)
+		{
+			b3Body* b = stack[--stackCount];
+			b->m_island = island;
+			island->m_bodies.PushFront(&b->m_islandLink);
+
+			if (b->m_flags & b3Body::e_awakeFlag)
+			{
+				awake = true;
+			}
+
+			// Search all touching contacts connected to this body.
+			for (b3Shape* s = b->m_shapeList.m_head; s; s = s->m_next)
+			{
+				for (b3ContactEdge* ce = s->m_contactEdges.m_head; ce; ce = ce->m_next)
+				{
+					b3Contact* contact = ce->contact;
+
+					// The contact must be linked and not visited.
+					if (contact->m_island == NULL)
+					{
+						continue;
+					}
+
+					if (contact->m_flags & b3Contact::e_islandFlag)
+					{
+						continue;
+					}
+
+					contact->m_island = island;
+					island->m_contacts.PushFront(&contact->m_islandLink);
+					contact->m_flags |= b3Contact::e_islandFlag;
+
+					// Don't propagate islands across static bodies.
+					b3Body* other = ce->other->GetBody();
+					if (other->m_type == e_staticBody)
+					{
+						continue;
+					}
+
+					if (other->m_flags & b3Body::e_islandFlag)
+					{
+						continue;
+					}
+
+					B3_ASSERT(stackCount < bodyCount);
+					stack[stackCount++] = other;
+					other->m_flags |= b3Body::e_islandFlag;
+				}
+			}
+
+			// Search all joints connected to this body.
+			for (b3JointEdge* je = b->m_jointEdges.m_head; je; je = je->m_next)
+			{
+				b3Joint* joint = je->joint;
+
+				// The joint must be linked and not visited.
+				if (joint->m_island == NULL)
+				{
+					continue;
+				}
+
+				if (joint->m_flags & b3Joint::e_islandFlag)
+				{
+					continue;
+				}
+
+				joint->m_island = island;
+				island->m_joints.PushFront(&joint->m_islandLink);
+				joint->m_flags |= b3Joint::e_islandFlag;
+
+				b3Body* other = je->other;
+				if (other->m_type == e_staticBody)
+				{
+					continue;
+				}
+
+				if (other->m_flags & b3Body::e_islandFlag)
+				{
+					continue;
+				}
+
+				B3_ASSERT(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b3Body::e_islandFlag;
+			}
+		}
+
+		// Components without awake bodies can sleep.
+		if (awake == false)
+		{
+			SleepIsland(island);
+		}
+	}
+
+	// Clear the visited flags so other passes can use them.
+	// Every visited contact and joint is connected to a visited body.
+	for (u32 i = 0; i < count; ++i)
+	{
+		b3Body* b = bodies[i];
+		b->m_flags &= ~b3Body::e_islandFlag;
+
+		for (b3Shape* s = b->m_shapeList.m_head; s; s = s->m_next)
+		{
+			for (b3ContactEdge* ce = s->m_contactEdges.m_head; ce; ce = ce->m_next)
+			{
+				ce->contact->m_flags &= ~b3Contact::e_islandFlag;
+			}
+		}
+
+		for (b3JointEdge* je = b->m_jointEdges.m_head; je; je = je->m_next)
+		{
+			je->joint->m_flags &= ~b3Joint::e_islandFlag;
+		}
+	}
+
+	allocator->Free(stack);
+	allocator->Free(bodies);
+}
\ No newline at end of file
@@ -19,6 +19,7 @@
 #include <bounce/dynamics/joint_manager.h>
 #include <bounce/dynamics/joints/joint.h>
 #include <bounce/dynamics/body.h>
+#include <bounce/dynamics/world.h>
 
 b3JointManager::b3JointManager() 
 {
@@ -39,6 +40,7 @@ b3Joint* b3JointManager::Create(const b3JointDef* def)
 	// Allocate the new joint.
 	b3Joint* j = b3Joint::Create(def);
 	j->m_flags = 0;
+	j->m_island = NULL;
 	j->m_collideLinked = def->collideLinked;
 	j->m_userData = def->userData;
 
@@ -57,6 +59,9 @@ b3Joint* b3JointManager::Create(const b3JointDef* def)
 	// Add the joint to the world joint list
 	m_jointList.PushFront(j);
 
+	// Link the islands of the bodies.
+	bodyA->GetWorld()->m_islandMan.AddJoint(j);
+
 	// Creating a joint doesn't awake the bodies.
 
 	return j;
@@ -67,6 +72,9 @@ void b3JointManager::Destroy(b3Joint* j)
 	b3Body* bodyA = j->GetBodyA();
 	b3Body* bodyB = j->GetBodyB();
 
+	// Remove the joint from its island.
+	bodyA->GetWorld()->m_islandMan.RemoveJoint(j);
+
 	// Remove the joint from body A's joint list.
 	bodyA->m_jointEdges.Remove(&j->m_pair.edgeA);
 
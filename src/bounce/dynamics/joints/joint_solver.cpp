@@ -49,7 +49,13 @@ void b3JointSolver::WarmStart()
 
 void b3JointSolver::SolveVelocityConstraints() 
 {
-	for (u32 i = 0; i < m_count; ++i) 
+	SolveVelocityConstraints(0, m_count);
+}
+
+void b3JointSolver::SolveVelocityConstraints(u32 begin, u32 end) 
+{
+	B3_ASSERT(begin <= end && end <= m_count);
+	for (u32 i = begin; i < end; ++i) 
 	{
 		b3Joint* j = m_joints[i];
 		j->SolveVelocityConstraints(&m_solverData);
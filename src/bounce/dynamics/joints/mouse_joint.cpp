@@ -33,7 +33,6 @@ void b3MouseJoint::InitializeConstraints(const b3SolverData* data)
 {
 	b3Body* m_bodyB = GetBodyB();
 
-	m_indexB = m_bodyB->m_islandID;
 	m_mB = m_bodyB->m_invMass;
 	m_iB = m_bodyB->m_worldInvI;
 	m_localCenterB = m_bodyB->m_sweep.localCenter;
@@ -99,9 +99,6 @@ void b3SpringJoint::InitializeConstraints(const b3SolverData* data)
 	b3Body* m_bodyA = GetBodyA();
 	b3Body* m_bodyB = GetBodyB();
 
-	m_indexA = m_bodyA->m_islandID;
-	m_indexB = m_bodyB->m_islandID;
-
 	m_mA = m_bodyA->m_invMass;
 	m_mB = m_bodyB->m_invMass;
 
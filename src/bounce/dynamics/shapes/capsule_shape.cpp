@@ -330,4 +330,40 @@ bool b3CapsuleShape::RayCast(b3RayCastOutput* output, const b3RayCastInput& inpu
 	}
 
 	return false;
-}
\ No newline at end of file
+}
+
+bool b3CapsuleShape::CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const
+{
+	b3Vec3 A = b3Mul(xf, m_centers[0]);
+	b3Vec3 B = b3Mul(xf, m_centers[1]);
+	b3Vec3 P = b3ClosestPointOnSegment(sphere.vertex, A, B);
+
+	float32 radius = m_radius + sphere.radius;
+	b3Vec3 d = sphere.vertex - P;
+	float32 dd = b3Dot(d, d);
+	if (dd > radius * radius)
+	{
+		return false;
+	}
+
+	b3Vec3 n;
+	float32 len = b3Length(d);
+	if (len > B3_EPSILON)
+	{
+		n = d / len;
+	}
+	else
+	{
+		// The sphere center is on the segment.
+		n = b3Perp(B - A);
+		if (b3Dot(n, n) < B3_EPSILON * B3_EPSILON)
+		{
+			n.Set(0.0f, 1.0f, 0.0f);
+		}
+		n.Normalize();
+	}
+
+	manifold->point = P + m_radius * n;
+	manifold->normal = n;
+	return true;
+}
@@ -18,6 +18,8 @@
 
 #include <bounce/dynamics/shapes/hull_shape.h>
 #include <bounce/collision/shapes/hull.h>
+#include <bounce/collision/gjk/gjk.h>
+#include <bounce/collision/gjk/gjk_proxy.h>
 #include <bounce/dynamics/time_step.h>
 
 b3HullShape::b3HullShape()
@@ -246,3 +248,59 @@ bool b3HullShape::RayCast(b3RayCastOutput* output, const b3RayCastInput& input,
 
 	return false;
 }
+
+bool b3HullShape::CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const
+{
+	// Put the sphere center into the hull's frame of reference.
+	b3Vec3 p = b3MulT(xf, sphere.vertex);
+
+	b3GJKProxy proxy1;
+	proxy1.m_buffer[0] = p;
+	proxy1.m_vertices = proxy1.m_buffer;
+	proxy1.m_count = 1;
+
+	b3GJKProxy proxy2;
+	proxy2.m_vertices = m_hull->vertices;
+	proxy2.m_count = m_hull->vertexCount;
+	proxy2.m_hull = m_hull;
+
+	b3Transform xfI;
+	xfI.SetIdentity();
+
+	b3GJKOutput gjk = b3GJK(xfI, proxy1, xfI, proxy2);
+
+	float32 radius = m_radius + sphere.radius;
+	if (gjk.distance > radius)
+	{
+		return false;
+	}
+
+	if (gjk.distance > B3_EPSILON)
+	{
+		b3Vec3 n = (p - gjk.point2) / gjk.distance;
+		
+		manifold->point = b3Mul(xf, gjk.point2 + m_radius * n);
+		manifold->normal = b3Mul(xf.rotation, n);
+		return true;
+	}
+
+	// The sphere center is inside the hull.
+	// Push it out through the face of maximum separation.
+	u32 maxIndex = 0;
+	float32 maxSeparation = b3Distance(p, m_hull->planes[0]);
+	for (u32 i = 1; i < m_hull->faceCount; ++i)
+	{
+		float32 separation = b3Distance(p, m_hull->planes[i]);
+		if (separation > maxSeparation)
+		{
+			maxIndex = i;
+			maxSeparation = separation;
+		}
+	}
+
+	b3Vec3 n = m_hull->planes[maxIndex].normal;
+
+	manifold->point = b3Mul(xf, p - (maxSeparation - m_radius) * n);
+	manifold->normal = b3Mul(xf.rotation, n);
+	return true;
+}
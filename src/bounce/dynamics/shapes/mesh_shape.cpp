@@ -166,8 +166,6 @@ struct b3MeshRayCastCallback
 {
 	float32 Report(const b3RayCastInput& subInput, u32 proxyId)
 	{
-		B3_NOT_USED(subInput);
-
 		u32 childIndex = mesh->m_mesh->tree.GetUserData(proxyId);
 		
 		b3RayCastOutput childOutput;
@@ -178,10 +176,16 @@ struct b3MeshRayCastCallback
 			{
 				hit = true;
 				output = childOutput;
+
+				// Clip the segment so farther triangles are skipped.
+				if (output.fraction > 0.0f)
+				{
+					return output.fraction;
+				}
 			}
 		}
 		
-		return 1.0f;
+		return subInput.maxFraction;
 	}
 
 	b3RayCastInput input;
@@ -211,4 +215,75 @@ bool b3MeshShape::RayCast(b3RayCastOutput* output, const b3RayCastInput& input,
 	output->normal = callback.output.normal;
 
 	return callback.hit;
-}
\ No newline at end of file
+}
+
+struct b3MeshCollideSphereCallback
+{
+	bool Report(u32 proxyId)
+	{
+		u32 index = mesh->m_mesh->tree.GetUserData(proxyId);
+		
+		const b3Mesh* m = mesh->m_mesh;
+		const b3Triangle* triangle = m->triangles + index;
+		b3Vec3 A = m->vertices[triangle->v1];
+		b3Vec3 B = m->vertices[triangle->v2];
+		b3Vec3 C = m->vertices[triangle->v3];
+
+		b3Vec3 Q = b3ClosestPointOnTriangle(center, A, B, C);
+		
+		float32 dd = b3DistanceSquared(center, Q);
+		if (dd < minDistanceSquared)
+		{
+			hit = true;
+			minDistanceSquared = dd;
+			point = Q;
+			
+			float32 d = b3Sqrt(dd);
+			if (d > B3_EPSILON)
+			{
+				normal = (center - Q) / d;
+			}
+			else
+			{
+				// The sphere center is on the triangle.
+				normal = b3Cross(B - A, C - A);
+				normal.Normalize();
+			}
+		}
+
+		return true;
+	}
+
+	const b3MeshShape* mesh;
+	b3Vec3 center;
+	
+	bool hit;
+	float32 minDistanceSquared;
+	b3Vec3 point;
+	b3Vec3 normal;
+};
+
+bool b3MeshShape::CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const
+{
+	float32 radius = m_radius + sphere.radius;
+
+	b3MeshCollideSphereCallback callback;
+	callback.mesh = this;
+	callback.center = b3MulT(xf, sphere.vertex);
+	callback.hit = false;
+	callback.minDistanceSquared = radius * radius;
+
+	b3AABB3 aabb;
+	aabb.m_lower = aabb.m_upper = callback.center;
+	aabb.Extend(radius);
+	m_mesh->tree.QueryAABB(&callback, aabb);
+
+	if (callback.hit == false)
+	{
+		return false;
+	}
+
+	manifold->point = b3Mul(xf, callback.point + m_radius * callback.normal);
+	manifold->normal = b3Mul(xf.rotation, callback.normal);
+	return true;
+}
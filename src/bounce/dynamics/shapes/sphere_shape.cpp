@@ -120,4 +120,27 @@ bool b3SphereShape::RayCast(b3RayCastOutput* output, const b3RayCastInput& input
 	}
 	
 	return false;
-}
\ No newline at end of file
+}
+
+bool b3SphereShape::CollideSphere(b3SphereManifold* manifold, const b3Sphere& sphere, const b3Transform& xf) const
+{
+	b3Vec3 center = b3Mul(xf, m_center);
+	float32 radius = m_radius + sphere.radius;
+	b3Vec3 d = sphere.vertex - center;
+	float32 dd = b3Dot(d, d);
+	if (dd > radius * radius)
+	{
+		return false;
+	}
+
+	b3Vec3 n(0.0f, 1.0f, 0.0f);
+	float32 len = b3Length(d);
+	if (len > B3_EPSILON)
+	{
+		n = d / len;
+	}
+
+	manifold->point = center + m_radius * n;
+	manifold->normal = n;
+	return true;
+}
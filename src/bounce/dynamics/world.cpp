@@ -21,12 +21,18 @@
 #include <bounce/dynamics/island.h>
 #include <bounce/dynamics/world_listeners.h>
 #include <bounce/dynamics/shapes/shape.h>
+#include <bounce/dynamics/shapes/mesh_shape.h>
+#include <bounce/collision/shapes/mesh.h>
+#include <bounce/dynamics/contacts/collide/collide.h>
 #include <bounce/dynamics/contacts/contact.h>
+#include <bounce/dynamics/contacts/mesh_contact.h>
 #include <bounce/dynamics/joints/joint.h>
 #include <bounce/dynamics/time_step.h>
+#include <bounce/common/sort.h>
+#include <bounce/common/thread/atomic.h>
 
-extern u32 b3_allocCalls;
-extern u32 b3_maxAllocCalls;
+extern b3Counter b3_allocCalls;
+extern b3Counter b3_maxAllocCalls;
 
 b3World::b3World() : m_bodyBlocks(sizeof(b3Body))
 {
@@ -37,7 +43,11 @@ b3World::b3World() : m_bodyBlocks(sizeof(b3Body))
 	m_flags = e_clearForcesFlag;
 	m_sleeping = false;
 	m_warmStarting = true;
+	m_constraintColoring = false;
+	m_continuousPhysics = true;
 	m_gravity.Set(0.0f, -9.8f, 0.0f);
+	m_threadAllocators = NULL;
+	m_awakeBulletCount = 0;
 }
 
 b3World::~b3World()
@@ -50,6 +60,7 @@ b3World::~b3World()
 		b->DestroyJoints();
 		b = b->m_next;
 	}
+	SetThreadCount(1);
 	b3_allocCalls = 0;
 	b3_maxAllocCalls = 0;
 }
@@ -66,11 +77,84 @@ void b3World::SetSleeping(bool flag)
 	}
 }
 
+void b3World::SetBroadPhaseType(b3BroadPhaseType type)
+{
+	b3BroadPhase* broadPhase = &m_contactMan.m_broadPhase;
+	if (type == broadPhase->GetType())
+	{
+		return;
+	}
+
+	// Remove the proxies from the old broad-phase.
+	for (b3Body* b = m_bodyList.m_head; b; b = b->m_next)
+	{
+		for (b3Shape* s = b->m_shapeList.m_head; s; s = s->m_next)
+		{
+			broadPhase->DestroyProxy(s->m_broadPhaseID);
+		}
+	}
+
+	broadPhase->SetType(type);
+
+	// Insert the proxies into the new broad-phase.
+	// The existing contacts are kept.
+	for (b3Body* b = m_bodyList.m_head; b; b = b->m_next)
+	{
+		for (b3Shape* s = b->m_shapeList.m_head; s; s = s->m_next)
+		{
+			b3AABB3 aabb;
+			s->ComputeAABB(&aabb, b->m_xf);
+			s->m_broadPhaseID = broadPhase->CreateProxy(aabb, s);
+		}
+	}
+}
+
+void b3World::SetThreadCount(u32 count)
+{
+	B3_ASSERT(count > 0);
+	count = b3Min(count, b3_maxThreads);
+	
+	u32 oldCount = m_threadPool.GetThreadCount();
+	if (count == oldCount)
+	{
+		return;
+	}
+
+	// Destroy the old thread allocators.
+	if (m_threadAllocators)
+	{
+		for (u32 i = 0; i < oldCount - 1; ++i)
+		{
+			m_threadAllocators[i].~b3StackAllocator();
+		}
+		b3Free(m_threadAllocators);
+		m_threadAllocators = NULL;
+	}
+
+	m_threadPool.SetThreadCount(count);
+
+	// Create a stack allocator for each worker thread.
+	if (count > 1)
+	{
+		m_threadAllocators = (b3StackAllocator*)b3Alloc((count - 1) * sizeof(b3StackAllocator));
+		for (u32 i = 0; i < count - 1; ++i)
+		{
+			new (m_threadAllocators + i) b3StackAllocator();
+		}
+	}
+}
+
 b3Body* b3World::CreateBody(const b3BodyDef& def)
 {
 	void* mem = m_bodyBlocks.Allocate();
 	b3Body* b = new(mem) b3Body(def, this);
 	m_bodyList.PushFront(b);	
+	
+	if (b->m_type != e_staticBody)
+	{
+		m_islandMan.AddBody(b);
+	}
+
 	return b;
 }
 
@@ -79,6 +163,8 @@ void b3World::DestroyBody(b3Body* b)
 	b->DestroyShapes();
 	b->DestroyJoints();
 	b->DestroyContacts();
+	b->SetBullet(false);
+	m_islandMan.RemoveBody(b);
 	
 	m_bodyList.Remove(b);
 	b->~b3Body();
@@ -102,12 +188,12 @@ void b3World::Step(float32 dt, u32 velocityIterations, u32 positionIterations)
 	if (m_flags & e_shapeAddedFlag)
 	{
 		// If new shapes were added new contacts might be created.
-		m_contactMan.FindNewContacts();
+		m_contactMan.FindNewContacts(&m_threadPool);
 		m_flags &= ~e_shapeAddedFlag;
 	}
 
 	// Update contacts. This is where some contacts might be destroyed.
-	m_contactMan.UpdateContacts();
+	m_contactMan.UpdateContacts(&m_stackAllocator, &m_threadPool, m_threadAllocators);
 
 	// Integrate velocities, clear forces and torques, solve constraints, integrate positions.
 	if (dt > 0.0f)
@@ -115,27 +201,91 @@ void b3World::Step(float32 dt, u32 velocityIterations, u32 positionIterations)
 		Solve(dt, velocityIterations, positionIterations);
 	}
 
-	//SolveTOI
+	// Move the bullets to their time of impact and sub-step the rest of the step.
+	if (m_continuousPhysics && dt > 0.0f)
+	{
+		SolveTOI(dt, velocityIterations);
+	}
 }
 
+// A range of an island in the world island arrays.
+struct b3IslandRange
+{
+	u32 bodyIndex, bodyCount;
+	u32 contactIndex, contactCount;
+	u32 jointIndex, jointCount;
+};
+
+// Solves a range of islands on a thread.
+struct b3SolveIslandsTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		// Each thread uses its own stack allocator.
+		b3StackAllocator* allocator = threadIndex == 0 ? mainAllocator : threadAllocators + threadIndex - 1;
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			const b3IslandRange* range = ranges + i;
+
+			b3Island island(allocator, NULL, 
+				bodies + range->bodyIndex, range->bodyCount, 
+				contacts + range->contactIndex, range->contactCount, 
+				joints + range->jointIndex, range->jointCount);
+
+			island.Solve(externalForce, dt, velocityIterations, positionIterations, flags);
+		}
+	}
+
+	b3StackAllocator* mainAllocator;
+	b3StackAllocator* threadAllocators;
+	const b3IslandRange* ranges;
+	b3Body** bodies;
+	b3Contact** contacts;
+	b3Joint** joints;
+	b3Vec3 externalForce;
+	float32 dt;
+	u32 velocityIterations;
+	u32 positionIterations;
+	u32 flags;
+};
+
 void b3World::Solve(float32 dt, u32 velocityIterations, u32 positionIterations)
 {
 	B3_PROFILE("Solve");
 	
-	// Clear all visited flags for the depth first search.
-	for (b3Body* b = m_bodyList.m_head; b; b = b->m_next)
 	{
-		b->m_flags &= ~b3Body::e_islandFlag;
-	}
+		B3_PROFILE("Update Islands");
 
-	for (b3Joint* j = m_jointMan.m_jointList.m_head; j; j = j->m_next)
-	{
-		j->m_flags &= ~b3Joint::e_islandFlag;
-	}
+		// Put islands without awake bodies to sleep and 
+		// split the islands that lost constraints.
+		b3PersistentIsland* persistent = m_islandMan.m_awakeList.m_head;
+		while (persistent)
+		{
+			// Split islands are pushed to the front of the list.
+			b3PersistentIsland* next = persistent->m_next;
 
-	for (b3Contact* c = m_contactMan.m_contactList.m_head; c; c = c->m_next)
-	{
-		c->m_flags &= ~b3Contact::e_islandFlag;
+			bool awake = false;
+			for (b3IslandLink<b3Body>* link = persistent->m_bodies.m_head; link; link = link->m_next)
+			{
+				if (link->m_item->m_flags & b3Body::e_awakeFlag)
+				{
+					awake = true;
+					break;
+				}
+			}
+
+			if (awake == false)
+			{
+				m_islandMan.SleepIsland(persistent);
+			}
+			else if (persistent->m_constraintRemoveCount > 0)
+			{
+				m_islandMan.SplitIsland(persistent, &m_stackAllocator);
+			}
+
+			persistent = next;
+		}
 	}
 
 	u32 islandFlags = 0;
@@ -144,170 +294,595 @@ void b3World::Solve(float32 dt, u32 velocityIterations, u32 positionIterations)
 
 	b3Vec3 externalForce = m_gravity;
 
-	// Create a worst case island.
-	b3Island island(&m_stackAllocator, m_bodyList.m_count, m_contactMan.m_contactList.m_count, m_jointMan.m_jointList.m_count);
+	// If more than one thread is used then all islands are gathered first and 
+	// then solved in parallel. 
+	// Otherwise each island is solved as soon as it is gathered.
+	bool parallel = m_threadPool.GetThreadCount() > 1;
+
+	// Size the island arrays to the awake islands. 
+	// If the islands are solved one by one then the arrays are reused, 
+	// therefore they must hold the largest island only.
+	u32 bodyCapacity = 0;
+	u32 contactCapacity = 0;
+	u32 jointCapacity = 0;
+	u32 islandCapacity = m_islandMan.m_awakeList.m_count;
+	
+	for (b3PersistentIsland* persistent = m_islandMan.m_awakeList.m_head; persistent; persistent = persistent->m_next)
+	{
+		u32 contactCount = persistent->m_contacts.m_count;
+		u32 jointCount = persistent->m_joints.m_count;
+
+		// A static body can be on many islands. 
+		// It is reached through a contact or a joint on each of them.
+		u32 bodyCount = persistent->m_bodies.m_count + contactCount + jointCount;
 
-	// Build and simulate awake islands.
-	u32 stackSize = m_bodyList.m_count;
-	b3Body** stack = (b3Body**)m_stackAllocator.Allocate(stackSize * sizeof(b3Body*));
-	for (b3Body* seed = m_bodyList.m_head; seed; seed = seed->m_next)
+		if (parallel)
+		{
+			bodyCapacity += bodyCount;
+			contactCapacity += contactCount;
+			jointCapacity += jointCount;
+		}
+		else
+		{
+			bodyCapacity = b3Max(bodyCapacity, bodyCount);
+			contactCapacity = b3Max(contactCapacity, contactCount);
+			jointCapacity = b3Max(jointCapacity, jointCount);
+		}
+	}
+
+	// Gather and simulate awake islands.
+	b3Body** bodies = (b3Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b3Body*));
+	b3Contact** contacts = (b3Contact**)m_stackAllocator.Allocate(contactCapacity * sizeof(b3Contact*));
+	b3Joint** joints = (b3Joint**)m_stackAllocator.Allocate(jointCapacity * sizeof(b3Joint*));
+	
+	// The islands that aren't colored are stored at the front.
+	b3IslandRange* ranges = NULL;
+	if (parallel)
 	{
-		// The seed must not be on an island.
-		if (seed->m_flags & b3Body::e_islandFlag)
+		ranges = (b3IslandRange*)m_stackAllocator.Allocate(islandCapacity * sizeof(b3IslandRange));
+	}
+	
+	u32 islandCount = 0;
+	u32 coloredCount = 0;
+	
+	u32 islandBodyCount = 0;
+	u32 islandContactCount = 0;
+	u32 islandJointCount = 0;
+
+	for (b3PersistentIsland* persistent = m_islandMan.m_awakeList.m_head; persistent; persistent = persistent->m_next)
+	{
+		u32 bodyIndex = islandBodyCount;
+		u32 contactIndex = islandContactCount;
+		u32 jointIndex = islandJointCount;
+
+		for (b3IslandLink<b3Body>* link = persistent->m_bodies.m_head; link; link = link->m_next)
 		{
-			continue;
+			b3Body* b = link->m_item;
+			B3_ASSERT(islandBodyCount < bodyCapacity);
+			b->m_islandID = islandBodyCount - bodyIndex;
+			bodies[islandBodyCount++] = b;
+
+			// This body must be awake.
+			b->SetAwake(true);
 		}
 
-		// Bodies that are sleeping are not solved for performance.
-		if (!(seed->m_flags & b3Body::e_awakeFlag))
+		// Static bodies aren't stored on islands. 
+		// They are added once when reached through a constraint.
+		for (b3IslandLink<b3Contact>* link = persistent->m_contacts.m_head; link; link = link->m_next)
 		{
-			continue;
+			b3Contact* c = link->m_item;
+			B3_ASSERT(islandContactCount < contactCapacity);
+			contacts[islandContactCount++] = c;
+
+			b3Body* bodyA = c->GetShapeA()->GetBody();
+			b3Body* bodyB = c->GetShapeB()->GetBody();
+
+			if (bodyA->m_type == e_staticBody && (bodyA->m_flags & b3Body::e_islandFlag) == 0)
+			{
+				B3_ASSERT(islandBodyCount < bodyCapacity);
+				bodyA->m_islandID = islandBodyCount - bodyIndex;
+				bodies[islandBodyCount++] = bodyA;
+				bodyA->m_flags |= b3Body::e_islandFlag;
+			}
+
+			if (bodyB->m_type == e_staticBody && (bodyB->m_flags & b3Body::e_islandFlag) == 0)
+			{
+				B3_ASSERT(islandBodyCount < bodyCapacity);
+				bodyB->m_islandID = islandBodyCount - bodyIndex;
+				bodies[islandBodyCount++] = bodyB;
+				bodyB->m_flags |= b3Body::e_islandFlag;
+			}
+
+			c->m_indexA = bodyA->m_islandID;
+			c->m_indexB = bodyB->m_islandID;
 		}
 
-		// The seed must be dynamic or kinematic.
-		if (seed->m_type == e_staticBody)
+		for (b3IslandLink<b3Joint>* link = persistent->m_joints.m_head; link; link = link->m_next)
 		{
-			continue;
+			b3Joint* j = link->m_item;
+			B3_ASSERT(islandJointCount < jointCapacity);
+			joints[islandJointCount++] = j;
+
+			b3Body* bodyA = j->GetBodyA();
+			b3Body* bodyB = j->GetBodyB();
+
+			if (bodyA->m_type == e_staticBody && (bodyA->m_flags & b3Body::e_islandFlag) == 0)
+			{
+				B3_ASSERT(islandBodyCount < bodyCapacity);
+				bodyA->m_islandID = islandBodyCount - bodyIndex;
+				bodies[islandBodyCount++] = bodyA;
+				bodyA->m_flags |= b3Body::e_islandFlag;
+			}
+
+			if (bodyB->m_type == e_staticBody && (bodyB->m_flags & b3Body::e_islandFlag) == 0)
+			{
+				B3_ASSERT(islandBodyCount < bodyCapacity);
+				bodyB->m_islandID = islandBodyCount - bodyIndex;
+				bodies[islandBodyCount++] = bodyB;
+				bodyB->m_flags |= b3Body::e_islandFlag;
+			}
+
+			j->m_indexA = bodyA->m_islandID;
+			j->m_indexB = bodyB->m_islandID;
 		}
 
-		// Perform a depth first search on this body constraint graph.
-		island.Clear();
-		u32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b3Body::e_islandFlag;
+		// Allow static bodies to participate in other islands.
+		for (u32 i = bodyIndex + persistent->m_bodies.m_count; i < islandBodyCount; ++i)
+		{
+			b3Body* b = bodies[i];
+			B3_ASSERT(b->m_type == e_staticBody);
+			b->m_flags &= ~b3Body::e_islandFlag;
+		}
+
+		// Large islands are colored so their constraints can be solved in parallel.
+		bool colored = false;
+		if (m_constraintColoring)
+		{
+			u32 constraintCount = (islandContactCount - contactIndex) + (islandJointCount - jointIndex);
+			colored = constraintCount >= B3_MIN_COLORED_CONSTRAINTS;
+		}
 
-		while (stackCount > 0)
+		if (parallel)
 		{
-			// Add this body to the island.
-			b3Body* b = stack[--stackCount];
-			island.Add(b);
+			// Defer the island.
+			// Colored islands use the thread pool by themselves, therefore 
+			// they are stored at the back and solved one by one.
+			b3IslandRange* range;
+			if (colored)
+			{
+				++coloredCount;
+				range = ranges + islandCapacity - coloredCount;
+			}
+			else
+			{
+				range = ranges + islandCount;
+				++islandCount;
+			}
 			
-			// This body must be awake.
-			b->m_flags |= b3Body::e_awakeFlag;
+			range->bodyIndex = bodyIndex;
+			range->bodyCount = islandBodyCount - bodyIndex;
+			range->contactIndex = contactIndex;
+			range->contactCount = islandContactCount - contactIndex;
+			range->jointIndex = jointIndex;
+			range->jointCount = islandJointCount - jointIndex;
+		}
+		else
+		{
+			u32 flags = islandFlags | b3Island::e_profileBit;
+			if (colored)
+			{
+				flags |= b3Island::e_colorBit;
+			}
+
+			// Integrate velocities, clear forces and torques, solve constraints, integrate positions.
+			b3Island island(&m_stackAllocator, &m_threadPool, 
+				bodies, islandBodyCount, 
+				contacts, islandContactCount, 
+				joints, islandJointCount);
+
+			island.Solve(externalForce, dt, velocityIterations, positionIterations, flags);
+
+			// Reuse the island arrays.
+			islandBodyCount = 0;
+			islandContactCount = 0;
+			islandJointCount = 0;
+		}
+	}
+
+	if (parallel)
+	{
+		B3_PROFILE("Solve Islands");
+
+		// The profiler isn't called from islands solved on worker threads 
+		// because it might not be thread-safe.
+		b3SolveIslandsTask task;
+		task.mainAllocator = &m_stackAllocator;
+		task.threadAllocators = m_threadAllocators;
+		task.ranges = ranges;
+		task.bodies = bodies;
+		task.contacts = contacts;
+		task.joints = joints;
+		task.externalForce = externalForce;
+		task.dt = dt;
+		task.velocityIterations = velocityIterations;
+		task.positionIterations = positionIterations;
+		task.flags = islandFlags;
+
+		m_threadPool.ParallelFor(&task, islandCount, 1);
+
+		for (u32 i = 0; i < coloredCount; ++i)
+		{
+			const b3IslandRange* range = ranges + islandCapacity - 1 - i;
+
+			b3Island island(&m_stackAllocator, &m_threadPool, 
+				bodies + range->bodyIndex, range->bodyCount, 
+				contacts + range->contactIndex, range->contactCount, 
+				joints + range->jointIndex, range->jointCount);
+
+			island.Solve(externalForce, dt, velocityIterations, positionIterations, islandFlags | b3Island::e_colorBit | b3Island::e_profileBit);
+		}
+
+		m_stackAllocator.Free(ranges);
+	}
+
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(bodies);
+
+	{
+		B3_PROFILE("Find New Pairs");
+
+		// Only bodies on awake islands might have moved.
+		for (b3PersistentIsland* persistent = m_islandMan.m_awakeList.m_head; persistent; persistent = persistent->m_next)
+		{
+			for (b3IslandLink<b3Body>* link = persistent->m_bodies.m_head; link; link = link->m_next)
+			{
+				// Update shapes for broad-phase.
+				link->m_item->SynchronizeShapes();
+			}
+		}
+
+		// Notify the contacts the AABBs may have been moved.
+		m_contactMan.SynchronizeShapes();
+
+		// Find new contacts.
+		m_contactMan.FindNewContacts(&m_threadPool);
+	}
+}
 
-			// Don't propagate islands across static bodies to keep them small.
-			if (b->m_type == e_staticBody)
+void b3World::UpdateTOIContact(b3Contact* c)
+{
+	if (c->GetType() == e_meshContact)
+	{
+		// The triangles overlapping the new position might not be cached.
+		b3MeshContact* mc = (b3MeshContact*)c;
+		mc->SynchronizeShapes();
+		mc->FindNewPairs();
+	}
+
+	c->UpdateManifolds(&m_stackAllocator);
+	c->UpdateState(m_contactMan.m_contactListener);
+}
+
+void b3World::SolveTOI(float32 dt, u32 velocityIterations)
+{
+	B3_PROFILE("Solve TOI");
+
+	// Only the contacts of awake bullets use continuous collision.
+	if (m_awakeBulletCount == 0)
+	{
+		return;
+	}
+
+	u32 bulletCapacity = m_awakeBulletCount;
+	b3Body** bullets = (b3Body**)m_stackAllocator.Allocate(bulletCapacity * sizeof(b3Body*));
+	u32 bulletCount = 0;
+
+	for (b3IslandLink<b3Body>* link = m_bulletList.m_head; link; link = link->m_next)
+	{
+		b3Body* b = link->m_item;
+		if (b->IsAwake() == false || b->m_type == e_staticBody)
+		{
+			continue;
+		}
+
+		B3_ASSERT(bulletCount < bulletCapacity);
+		bullets[bulletCount++] = b;
+
+		for (b3Shape* s = b->m_shapeList.m_head; s; s = s->m_next)
+		{
+			for (b3ContactEdge* ce = s->m_contactEdges.m_head; ce; ce = ce->m_next)
+			{
+				b3Contact* c = ce->contact;
+				c->m_flags &= ~b3Contact::e_toiFlag;
+				c->m_toi.t = 1.0f;
+				c->m_toi.count = 0;
+
+				// The island solver starts the sweeps of the other bodies 
+				// at the beginning of the step, but it doesn't write to static bodies.
+				ce->other->GetBody()->m_sweep.t0 = 0.0f;
+			}
+		}
+	}
+
+	// A sub-step island holds the contacts touching the two bodies of the time of impact.
+	// Each contact adds at most one body.
+	u32 bodyCapacity = B3_MAX_TOI_CONTACTS + 1;
+	u32 contactCapacity = B3_MAX_TOI_CONTACTS;
+	b3Body** bodies = (b3Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b3Body*));
+	b3Contact** contacts = (b3Contact**)m_stackAllocator.Allocate(contactCapacity * sizeof(b3Contact*));
+
+	bool moved = false;
+	for (;;)
+	{
+		// Find the first time of impact.
+		b3Contact* minContact = NULL;
+		float32 minAlpha = 1.0f;
+
+		for (u32 i = 0; i < bulletCount; ++i)
+		{
+			for (b3Shape* s = bullets[i]->m_shapeList.m_head; s; s = s->m_next)
+			{
+				for (b3ContactEdge* ce = s->m_contactEdges.m_head; ce; ce = ce->m_next)
+				{
+					b3Contact* c = ce->contact;
+
+					// Prevent excessive sub-stepping.
+					if (c->m_toi.count > B3_MAX_SUB_STEPS)
+					{
+						continue;
+					}
+
+					float32 alpha = 1.0f;
+					if (c->m_flags & b3Contact::e_toiFlag)
+					{
+						// This contact has a valid cached time of impact.
+						alpha = c->m_toi.t;
+					}
+					else
+					{
+						b3Shape* shapeA = c->GetShapeA();
+						b3Shape* shapeB = c->GetShapeB();
+
+						// Sensors don't stop the bodies.
+						if (shapeA->IsSensor() || shapeB->IsSensor())
+						{
+							continue;
+						}
+
+						b3Body* bodyA = shapeA->GetBody();
+						b3Body* bodyB = shapeB->GetBody();
+
+						// Put the sweeps onto the same time interval.
+						float32 alpha0 = bodyA->m_sweep.t0;
+
+						if (bodyA->m_sweep.t0 < bodyB->m_sweep.t0)
+						{
+							alpha0 = bodyB->m_sweep.t0;
+							bodyA->m_sweep.Advance(alpha0);
+						}
+						else if (bodyB->m_sweep.t0 < bodyA->m_sweep.t0)
+						{
+							alpha0 = bodyA->m_sweep.t0;
+							bodyB->m_sweep.Advance(alpha0);
+						}
+
+						B3_ASSERT(alpha0 < 1.0f);
+
+						// The time of impact is relative to the advanced sweeps.
+						float32 beta = c->ComputeTOI();
+						alpha = b3Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
+
+						c->m_toi.t = alpha;
+						c->m_flags |= b3Contact::e_toiFlag;
+					}
+
+					if (alpha < minAlpha)
+					{
+						// This is the earliest time of impact so far.
+						minContact = c;
+						minAlpha = alpha;
+					}
+				}
+			}
+		}
+
+		if (minContact == NULL || 1.0f - 10.0f * B3_EPSILON < minAlpha)
+		{
+			// No more time of impacts in this step.
+			break;
+		}
+
+		moved = true;
+
+		// Advance the bodies to the time of impact.
+		b3Body* bodyA = minContact->GetShapeA()->GetBody();
+		b3Body* bodyB = minContact->GetShapeB()->GetBody();
+
+		b3Sweep backupA = bodyA->m_sweep;
+		b3Sweep backupB = bodyB->m_sweep;
+
+		bodyA->Advance(minAlpha);
+		bodyB->Advance(minAlpha);
+
+		// The contact likely has new contact points.
+		UpdateTOIContact(minContact);
+		minContact->m_flags &= ~b3Contact::e_toiFlag;
+		++minContact->m_toi.count;
+
+		if (minContact->IsOverlapping() == false)
+		{
+			// The shapes didn't touch at the time of impact. 
+			// Restore the sweeps.
+			bodyA->m_sweep = backupA;
+			bodyB->m_sweep = backupB;
+			bodyA->SynchronizeTransform();
+			bodyB->SynchronizeTransform();
+			continue;
+		}
+
+		bodyA->SetAwake(true);
+		bodyB->SetAwake(true);
+
+		// Build the sub-step island.
+		u32 bodyCount = 0;
+		u32 contactCount = 0;
+
+		bodyA->m_islandID = bodyCount;
+		bodies[bodyCount++] = bodyA;
+		bodyA->m_flags |= b3Body::e_islandFlag;
+
+		bodyB->m_islandID = bodyCount;
+		bodies[bodyCount++] = bodyB;
+		bodyB->m_flags |= b3Body::e_islandFlag;
+
+		contacts[contactCount++] = minContact;
+		minContact->m_flags |= b3Contact::e_islandFlag;
+
+		// Add the contacts touching the bodies of the time of impact.
+		b3Body* toiBodies[2] = { bodyA, bodyB };
+		for (u32 i = 0; i < 2; ++i)
+		{
+			b3Body* body = toiBodies[i];
+			if (body->m_type != e_dynamicBody)
 			{
 				continue;
 			}
 
-			// Search all contacts connected to this body.
-			for (b3Shape* s = b->m_shapeList.m_head; s; s = s->m_next)
+			for (b3Shape* s = body->m_shapeList.m_head; s; s = s->m_next)
 			{
 				for (b3ContactEdge* ce = s->m_contactEdges.m_head; ce; ce = ce->m_next)
 				{
+					if (contactCount == contactCapacity)
+					{
+						break;
+					}
+
 					b3Contact* contact = ce->contact;
 
-					// The contact must not be on an island.
+					// Has this contact already been added to the island?
 					if (contact->m_flags & b3Contact::e_islandFlag)
 					{
 						continue;
 					}
 
-					// The contact must be overlapping.
-					if (!(contact->m_flags & b3Contact::e_overlapFlag))
+					b3Shape* otherShape = ce->other;
+					b3Body* other = otherShape->GetBody();
+
+					// Only add static, kinematic, or bullet bodies.
+					if (other->m_type == e_dynamicBody && body->IsBullet() == false && other->IsBullet() == false)
 					{
 						continue;
 					}
 
-					// A sensor can't respond to contacts. 
-					bool sensorA = contact->GetShapeA()->m_isSensor;
-					bool sensorB = contact->GetShapeB()->m_isSensor;
-					if (sensorA || sensorB)
+					// Skip sensors.
+					if (s->IsSensor() || otherShape->IsSensor())
 					{
 						continue;
 					}
 
-					// Add contact to the island and mark it.
-					island.Add(contact);
-					contact->m_flags |= b3Contact::e_islandFlag;
+					// Tentatively advance the other body to the time of impact.
+					b3Sweep backup = other->m_sweep;
+					if ((other->m_flags & b3Body::e_islandFlag) == 0)
+					{
+						other->Advance(minAlpha);
+					}
 
-					b3Body* other = ce->other->GetBody();
+					UpdateTOIContact(contact);
 
-					// Skip adjacent vertex if it was visited.
-					if (other->m_flags & b3Body::e_islandFlag)
+					if (contact->IsOverlapping() == false)
 					{
+						// The shapes don't touch. Restore the other body.
+						other->m_sweep = backup;
+						other->SynchronizeTransform();
 						continue;
 					}
 
-					// Add the other body to the island and propagate through it.
-					B3_ASSERT(stackCount < stackSize);
-					stack[stackCount++] = other;
-					other->m_flags |= b3Body::e_islandFlag;
-				}
-			}
-
-			// Search all joints connected to this body.
-			for (b3JointEdge* je = b->m_jointEdges.m_head; je; je = je->m_next)
-			{
-				b3Joint* joint = je->joint;
+					// Add the contact to the island.
+					contacts[contactCount++] = contact;
+					contact->m_flags |= b3Contact::e_islandFlag;
 
-				// The joint must not be on an island.
-				if (joint->m_flags & b3Joint::e_islandFlag)
-				{
-					continue;
-				}
+					// Has the other body already been added to the island?
+					if (other->m_flags & b3Body::e_islandFlag)
+					{
+						continue;
+					}
 
-				// Add joint to the island and mark it.
-				island.Add(joint);
-				joint->m_flags |= b3Joint::e_islandFlag;
+					// Add the other body to the island.
+					other->m_flags |= b3Body::e_islandFlag;
 
-				b3Body* other = je->other;
+					if (other->m_type != e_staticBody)
+					{
+						other->SetAwake(true);
+					}
 
-				// The other body must not be on an island.
-				if (other->m_flags & b3Body::e_islandFlag)
-				{
-					continue;
+					B3_ASSERT(bodyCount < bodyCapacity);
+					other->m_islandID = bodyCount;
+					bodies[bodyCount++] = other;
 				}
-
-				// Push the other body onto the stack and mark it.
-				B3_ASSERT(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b3Body::e_islandFlag;
 			}
 		}
 
-		// Integrate velocities, clear forces and torques, solve constraints, integrate positions.
-		island.Solve(externalForce, dt, velocityIterations, positionIterations, islandFlags);
-		
-		// Allow static bodies to participate in other islands.
-		for (u32 i = 0; i < island.m_bodyCount; ++i)
+		for (u32 i = 0; i < contactCount; ++i)
 		{
-			b3Body* b = island.m_bodies[i];
-			if (b->m_type == e_staticBody)
-			{
-				b->m_flags &= ~b3Body::e_islandFlag;
-			}
+			b3Contact* c = contacts[i];
+			c->m_indexA = c->GetShapeA()->GetBody()->m_islandID;
+			c->m_indexB = c->GetShapeB()->GetBody()->m_islandID;
 		}
-	}
 
-	m_stackAllocator.Free(stack);
+		// Solve the rest of the step.
+		{
+			float32 subDt = (1.0f - minAlpha) * dt;
 
-	{
-		B3_PROFILE("Find New Pairs");
+			b3Island island(&m_stackAllocator, NULL, 
+				bodies, bodyCount, 
+				contacts, contactCount, 
+				NULL, 0);
 
-		for (b3Body* b = m_bodyList.m_head; b; b = b->m_next)
+			island.SolveTOI(subDt, velocityIterations, B3_TOI_POSITION_ITERATIONS, bodyA->m_islandID, bodyB->m_islandID);
+		}
+
+		// Reset the island flags and synchronize the broad-phase proxies.
+		for (u32 i = 0; i < bodyCount; ++i)
 		{
-			// If a body didn't participate on a island then it didn't move.
-			if ((b->m_flags & b3Body::e_islandFlag) == 0)
+			b3Body* b = bodies[i];
+			b->m_flags &= ~b3Body::e_islandFlag;
+
+			if (b->m_type != e_dynamicBody)
 			{
 				continue;
 			}
 
-			if (b->m_type == e_staticBody)
+			b->SynchronizeShapes();
+
+			// The times of impact of the contacts of a moved body are invalid.
+			for (b3Shape* s = b->m_shapeList.m_head; s; s = s->m_next)
 			{
-				continue;
+				for (b3ContactEdge* ce = s->m_contactEdges.m_head; ce; ce = ce->m_next)
+				{
+					ce->contact->m_flags &= ~(b3Contact::e_toiFlag | b3Contact::e_islandFlag);
+				}
 			}
+		}
 
-			// Update shapes for broad-phase.
-			b->SynchronizeShapes();
+		for (u32 i = 0; i < contactCount; ++i)
+		{
+			contacts[i]->m_flags &= ~b3Contact::e_islandFlag;
 		}
 
-		// Notify the contacts the AABBs may have been moved.
-		m_contactMan.SynchronizeShapes();
+		// The moved proxies might create new contacts.
+		m_contactMan.FindNewContacts(&m_threadPool);
+	}
 
-		// Find new contacts.
-		m_contactMan.FindNewContacts();
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(bodies);
+	m_stackAllocator.Free(bullets);
+
+	if (moved)
+	{
+		// The mesh contacts might have cached the triangles at a time of impact.
+		m_contactMan.SynchronizeShapes();
+		m_contactMan.FindNewContacts(&m_threadPool);
 	}
 }
 
@@ -379,6 +954,12 @@ struct b3RayCastSingleCallback
 			{
 				shape0 = shape;
 				output0 = output;
+				
+				// Clip the segment so farther shapes are skipped.
+				if (output.fraction > 0.0f)
+				{
+					return output.fraction;
+				}
 			}
 		}
 
@@ -391,20 +972,16 @@ struct b3RayCastSingleCallback
 	const b3BroadPhase* broadPhase;
 };
 
-bool b3World::RayCastSingle(b3RayCastSingleOutput* output, const b3Vec3& p1, const b3Vec3& p2) const
+// Find the closest shape intersected by a segment.
+static bool b3RayCastClosest(b3RayCastSingleOutput* output, const b3BroadPhase* broadPhase, const b3RayCastInput& input)
 {
-	b3RayCastInput input;
-	input.p1 = p1;
-	input.p2 = p2;
-	input.maxFraction = 1.0f;
-
 	b3RayCastSingleCallback callback;
 	callback.shape0 = NULL;
 	callback.output0.fraction = B3_MAX_FLOAT;
-	callback.broadPhase = &m_contactMan.m_broadPhase;
+	callback.broadPhase = broadPhase;
 	
 	// Perform the ray cast.
-	m_contactMan.m_broadPhase.RayCast(&callback, input);
+	broadPhase->RayCast(&callback, input);
 
 	if (callback.shape0)
 	{
@@ -424,6 +1001,288 @@ bool b3World::RayCastSingle(b3RayCastSingleOutput* output, const b3Vec3& p1, con
 	return false;
 }
 
+bool b3World::RayCastSingle(b3RayCastSingleOutput* output, const b3Vec3& p1, const b3Vec3& p2) const
+{
+	b3RayCastInput input;
+	input.p1 = p1;
+	input.p2 = p2;
+	input.maxFraction = 1.0f;
+
+	return b3RayCastClosest(output, &m_contactMan.m_broadPhase, input);
+}
+
+// The number of segments traced per task.
+const u32 b3_rayCastGrainSize = 64;
+
+// Traces a range of sorted segments on a thread.
+struct b3RayCastBatchTask
+{
+	void Execute(u32 begin, u32 end, u32 threadIndex)
+	{
+		B3_NOT_USED(threadIndex);
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			u32 index = u32(keys[i]);
+
+			b3RayCastSingleOutput* output = outputs + index;
+			if (b3RayCastClosest(output, broadPhase, inputs[index]) == false)
+			{
+				output->shape = NULL;
+			}
+		}
+	}
+
+	const b3BroadPhase* broadPhase;
+	const b3RayCastInput* inputs;
+	const u64* keys;
+	b3RayCastSingleOutput* outputs;
+};
+
+void b3World::RayCastBatch(b3RayCastSingleOutput* outputs, const b3RayCastInput* inputs, u32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Compute the bounds of the segment origins.
+	b3AABB3 bounds;
+	bounds.m_lower = bounds.m_upper = inputs[0].p1;
+	for (u32 i = 1; i < count; ++i)
+	{
+		bounds.m_lower = b3Min(bounds.m_lower, inputs[i].p1);
+		bounds.m_upper = b3Max(bounds.m_upper, inputs[i].p1);
+	}
+
+	b3Vec3 extent = bounds.m_upper - bounds.m_lower;
+	b3Vec3 scale;
+	scale.x = extent.x > 0.0f ? 1.0f / extent.x : 0.0f;
+	scale.y = extent.y > 0.0f ? 1.0f / extent.y : 0.0f;
+	scale.z = extent.z > 0.0f ? 1.0f / extent.z : 0.0f;
+
+	// Sort the segments along a Morton curve of their origins so  
+	// segments that visit the same nodes are traced one after the other.
+	u64* keys = (u64*)m_stackAllocator.Allocate(2 * count * sizeof(u64));
+	for (u32 i = 0; i < count; ++i)
+	{
+		b3Vec3 p = inputs[i].p1 - bounds.m_lower;
+		p.x *= scale.x;
+		p.y *= scale.y;
+		p.z *= scale.z;
+		keys[i] = (u64(b3GetMortonCode(p)) << 32) | u64(i);
+	}
+
+	b3SortKeys(keys, keys + count, count);
+
+	b3RayCastBatchTask task;
+	task.broadPhase = &m_contactMan.m_broadPhase;
+	task.inputs = inputs;
+	task.keys = keys;
+	task.outputs = outputs;
+
+	m_threadPool.ParallelFor(&task, count, b3_rayCastGrainSize);
+
+	m_stackAllocator.Free(keys);
+}
+
+// Sweeps a shape against the triangles of a mesh in the mesh space.
+struct b3MeshShapeCastCallback
+{
+	bool Report(u32 proxyId)
+	{
+		u32 triangleIndex = mesh->m_mesh->tree.GetUserData(proxyId);
+		
+		b3ShapeGJKProxy proxy1(mesh, triangleIndex);
+		
+		b3GJKShapeCastOutput output;
+		if (b3GJKShapeCast(&output, xf1, proxy1, xf2, *proxy2, translation2, maxFraction))
+		{
+			if (hit == false || output.t < output0.t)
+			{
+				hit = true;
+				output0 = output;
+				maxFraction = output.t;
+			}
+		}
+
+		return true;
+	}
+
+	const b3MeshShape* mesh;
+	b3Transform xf1;
+	const b3GJKProxy* proxy2;
+	b3Transform xf2;
+	b3Vec3 translation2;
+	float32 maxFraction;
+	
+	bool hit;
+	b3GJKShapeCastOutput output0;
+};
+
+// Find the first time a swept shape touches a shape of the world.
+static bool b3ShapeCast(b3GJKShapeCastOutput* output, const b3Shape* shape, 
+	const b3Shape* castShape, const b3Transform& xf, const b3Vec3& translation, float32 maxFraction)
+{
+	b3Transform xf1 = shape->GetBody()->GetTransform();
+	
+	b3ShapeGJKProxy proxy2(castShape, 0);
+
+	if (shape->GetType() != e_meshShape)
+	{
+		b3ShapeGJKProxy proxy1(shape, 0);
+		return b3GJKShapeCast(output, xf1, proxy1, xf, proxy2, translation, maxFraction);
+	}
+
+	const b3MeshShape* mesh = (b3MeshShape*)shape;
+
+	// Sweep in the mesh space.
+	b3MeshShapeCastCallback callback;
+	callback.mesh = mesh;
+	callback.xf1.SetIdentity();
+	callback.proxy2 = &proxy2;
+	callback.xf2 = b3MulT(xf1, xf);
+	callback.translation2 = b3MulT(xf1.rotation, translation);
+	callback.maxFraction = maxFraction;
+	callback.hit = false;
+
+	// Find the triangles overlapping the swept AABB.
+	b3AABB3 aabb1, aabb2;
+	castShape->ComputeAABB(&aabb1, callback.xf2);
+	aabb2 = aabb1;
+	aabb2.m_lower += maxFraction * callback.translation2;
+	aabb2.m_upper += maxFraction * callback.translation2;
+	b3AABB3 sweptAABB = b3Combine(aabb1, aabb2);
+	
+	// The sweep stops within the slop before touching.
+	sweptAABB.Extend(mesh->m_radius + B3_LINEAR_SLOP);
+
+	mesh->m_mesh->tree.QueryAABB(&callback, sweptAABB);
+
+	if (callback.hit == false)
+	{
+		return false;
+	}
+
+	// Convert the output to world space.
+	*output = callback.output0;
+	output->point = b3Mul(xf1, output->point);
+	output->normal = b3Mul(xf1.rotation, output->normal);
+	return true;
+}
+
+struct b3ShapeCastCallback
+{
+	bool Report(i32 proxyId)
+	{
+		b3Shape* shape = (b3Shape*)broadPhase->GetUserData(proxyId);
+		
+		// Skip the swept shape if it belongs to the world.
+		if (shape == castShape)
+		{
+			return true;
+		}
+
+		b3GJKShapeCastOutput output;
+		if (b3ShapeCast(&output, shape, castShape, xf, translation, maxFraction))
+		{
+			if (listener)
+			{
+				// Report the hit to the user and get the new fraction.
+				float32 fraction = listener->ReportShape(shape, output.point, output.normal, output.t);
+				if (fraction == 0.0f)
+				{
+					// The client has stopped the query.
+					return false;
+				}
+				
+				maxFraction = b3Min(maxFraction, fraction);
+			}
+			else if (shape0 == NULL || output.t < output0.t)
+			{
+				// Track the first hit.
+				shape0 = shape;
+				output0 = output;
+				maxFraction = output.t;
+			}
+		}
+
+		return true;
+	}
+
+	const b3BroadPhase* broadPhase;
+	const b3Shape* castShape;
+	b3Transform xf;
+	b3Vec3 translation;
+	float32 maxFraction;
+	
+	b3ShapeCastListener* listener;
+	
+	b3Shape* shape0;
+	b3GJKShapeCastOutput output0;
+};
+
+// Compute the AABB swept by a shape.
+static b3AABB3 b3ComputeSweptAABB(const b3Shape* shape, const b3Transform& xf, const b3Vec3& translation)
+{
+	b3AABB3 aabb1;
+	shape->ComputeAABB(&aabb1, xf);
+
+	b3AABB3 aabb2 = aabb1;
+	aabb2.m_lower += translation;
+	aabb2.m_upper += translation;
+
+	// The sweep stops within the slop before touching.
+	b3AABB3 aabb = b3Combine(aabb1, aabb2);
+	aabb.Extend(B3_LINEAR_SLOP);
+	return aabb;
+}
+
+bool b3World::ShapeCastSingle(b3ShapeCastSingleOutput* output, const b3Shape* shape, const b3Transform& xf, const b3Vec3& translation) const
+{
+	B3_ASSERT(shape->GetType() != e_meshShape);
+
+	b3ShapeCastCallback callback;
+	callback.broadPhase = &m_contactMan.m_broadPhase;
+	callback.castShape = shape;
+	callback.xf = xf;
+	callback.translation = translation;
+	callback.maxFraction = 1.0f;
+	callback.listener = NULL;
+	callback.shape0 = NULL;
+
+	b3AABB3 aabb = b3ComputeSweptAABB(shape, xf, translation);
+	m_contactMan.m_broadPhase.QueryAABB(&callback, aabb);
+
+	if (callback.shape0)
+	{
+		output->shape = callback.shape0;
+		output->point = callback.output0.point;
+		output->normal = callback.output0.normal;
+		output->fraction = callback.output0.t;
+		return true;
+	}
+
+	return false;
+}
+
+void b3World::ShapeCast(b3ShapeCastListener* listener, const b3Shape* shape, const b3Transform& xf, const b3Vec3& translation) const
+{
+	B3_ASSERT(shape->GetType() != e_meshShape);
+
+	b3ShapeCastCallback callback;
+	callback.broadPhase = &m_contactMan.m_broadPhase;
+	callback.castShape = shape;
+	callback.xf = xf;
+	callback.translation = translation;
+	callback.maxFraction = 1.0f;
+	callback.listener = listener;
+	callback.shape0 = NULL;
+
+	b3AABB3 aabb = b3ComputeSweptAABB(shape, xf, translation);
+	m_contactMan.m_broadPhase.QueryAABB(&callback, aabb);
+}
+
 struct b3QueryAABBCallback
 {
 	bool Report(i32 proxyID)